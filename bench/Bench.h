@@ -0,0 +1,159 @@
+// Shared harness for bench/bench_*.cpp: warmup runs, timed repetitions,
+// summary statistics, a console table and optional JSON output for
+// comparing runs. Options: --reps N, --warmup N, --json DIR (writes
+// DIR/<suite>.json).
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+struct BenchConfig {
+    int warmup = 1;
+    int repetitions = 5;
+    std::string jsonDir; // empty: console only
+};
+
+struct BenchResult {
+    std::string name;
+    std::string unit; // of throughput, e.g. "GB/s"
+    double workPerRep = 0.0; // in units of `unit` x seconds
+    std::vector<double> seconds; // one per timed repetition
+    std::map<std::string, double> extra; // benchmark-specific figures
+
+    double min() const { return *std::min_element(seconds.begin(), seconds.end()); }
+    double max() const { return *std::max_element(seconds.begin(), seconds.end()); }
+    double mean() const { return std::accumulate(seconds.begin(), seconds.end(), 0.0) / seconds.size(); }
+    double median() const {
+        std::vector<double> sorted = seconds;
+        std::sort(sorted.begin(), sorted.end());
+        size_t mid = sorted.size() / 2;
+        return sorted.size() % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2.0;
+    }
+    double stddev() const {
+        const double m = mean();
+        double sq = 0.0;
+        for (double s : seconds) sq += (s - m) * (s - m);
+        return seconds.size() > 1 ? std::sqrt(sq / (seconds.size() - 1)) : 0.0;
+    }
+    // Throughput at the median repetition
+    double throughput() const { return workPerRep / median(); }
+};
+
+class BenchSuite {
+public:
+    BenchSuite(const std::string& suite, int argc, char** argv) : suite(suite), out(std::cout.rdbuf()) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+            if (arg == "--reps") {
+                config.repetitions = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--warmup") {
+                config.warmup = std::max(0, std::atoi(argv[++i]));
+            } else if (arg == "--json") {
+                // Absolute, so it survives enterScratchDirectory()
+                config.jsonDir = argv[++i];
+                char cwd[4096];
+                if (config.jsonDir[0] != '/' && getcwd(cwd, sizeof(cwd))) config.jsonDir = cwd + ("/" + config.jsonDir);
+            } else {
+                throw std::runtime_error("Unknown option " + arg);
+            }
+        }
+        out << std::left << std::setw(40) << suite << std::right << std::setw(12) << "median"
+                  << std::setw(12) << "min" << std::setw(10) << "stddev" << std::setw(14) << "throughput" << "\n";
+    }
+
+    // Runs `body` config.warmup times untimed, then config.repetitions
+    // times timed. `workPerRep` is one call's work in `unit` x seconds
+    // (e.g. bytes / 1e9 for GB/s). The result can take extra figures until
+    // finish().
+    BenchResult& run(const std::string& name, const std::string& unit, double workPerRep,
+                     const std::function<void()>& body) {
+        for (int i = 0; i < config.warmup; ++i) body();
+        BenchResult result;
+        result.name = name;
+        result.unit = unit;
+        result.workPerRep = workPerRep;
+        for (int i = 0; i < config.repetitions; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            result.seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        out << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(10) << result.median() * 1e3 << "ms" << std::setw(10) << result.min() * 1e3 << "ms"
+                  << std::setw(9) << std::setprecision(1) << 100.0 * result.stddev() / result.mean() << "%"
+                  << std::setw(10) << std::setprecision(2) << result.throughput() << " " << unit << std::endl;
+        results.push_back(result);
+        return results.back();
+    }
+
+    // Writes the JSON report if requested; returns main()'s exit code
+    int finish() {
+        for (const BenchResult& r : results) {
+            for (const auto& e : r.extra) {
+                out << "  " << r.name << " " << e.first << ": " << std::setprecision(2) << e.second << "\n";
+            }
+        }
+        out.flush();
+        if (config.jsonDir.empty()) return 0;
+
+        mkdir(config.jsonDir.c_str(), 0755);
+        const std::string path = config.jsonDir + "/" + suite + ".json";
+        std::ofstream json(path, std::ios::trunc);
+        json << std::setprecision(9) << "{\"suite\":\"" << suite << "\",\"warmup\":" << config.warmup
+            << ",\"repetitions\":" << config.repetitions << ",\"results\":[";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            json << (i ? "," : "") << "{\"name\":\"" << r.name << "\",\"unit\":\"" << r.unit
+                << "\",\"throughput\":" << r.throughput() << ",\"median_s\":" << r.median()
+                << ",\"mean_s\":" << r.mean() << ",\"min_s\":" << r.min() << ",\"max_s\":" << r.max()
+                << ",\"stddev_s\":" << r.stddev() << ",\"seconds\":[";
+            for (size_t j = 0; j < r.seconds.size(); ++j) json << (j ? "," : "") << r.seconds[j];
+            json << "]";
+            for (const auto& e : r.extra) json << ",\"" << e.first << "\":" << e.second;
+            json << "}";
+        }
+        json << "]}\n";
+        if (!json.flush()) {
+            std::cerr << "Could not write " << path << std::endl;
+            return 1;
+        }
+        out << "Wrote " << path << "\n";
+        return 0;
+    }
+
+    const BenchConfig& options() const { return config; }
+
+private:
+    std::string suite;
+    BenchConfig config;
+    // The console at construction, so benchmarks may silence std::cout
+    std::ostream out;
+    std::deque<BenchResult> results; // stable references for run()'s callers
+};
+
+// Moves the process into a fresh temporary directory with a checkpoints/
+// subdirectory, so disk benchmarks never touch the repository's files
+inline std::string enterScratchDirectory() {
+    char path[] = "/tmp/bench.XXXXXX";
+    if (!mkdtemp(path) || chdir(path) != 0 || mkdir("checkpoints", 0755) != 0) {
+        throw std::runtime_error("Could not create a scratch directory");
+    }
+    return path;
+}
+
+#endif
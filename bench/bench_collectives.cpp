@@ -0,0 +1,93 @@
+// Collective bandwidth over loopback TCP, one thread per rank.
+// Reports bus bandwidth (the nccl-tests convention), which is comparable
+// across node counts:
+//   allReduce:             size * 2(N-1)/N / time
+//   reduceScatter/allGather: size * (N-1)/N / time
+//   broadcast/reduce (tree): size / time
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "Communicator.h"
+
+namespace {
+
+struct Op {
+    const char* name;
+    std::function<double(int)> busFactor;
+    std::function<void(Communicator&, Tensor&)> run;
+};
+
+// Best time of `reps` runs, taken on rank 0 between barriers (an allReduce
+// of one float) so every rank starts together
+double bestSeconds(int world, int basePort, size_t floats, const Op& op, int reps) {
+    double best = 1e30;
+    std::vector<std::thread> ranks;
+    for (int r = 0; r < world; ++r) {
+        ranks.emplace_back([&, r] {
+            Communicator comm(r, world, basePort);
+            comm.connect();
+            Tensor data({floats});
+            Tensor barrier({1});
+            op.run(comm, data); // warm up connections and buffers
+            for (int i = 0; i < reps; ++i) {
+                comm.allReduce(barrier);
+                auto start = std::chrono::steady_clock::now();
+                op.run(comm, data);
+                comm.allReduce(barrier);
+                double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (r == 0) best = std::min(best, secs);
+            }
+        });
+    }
+    for (auto& t : ranks) t.join();
+    return best;
+}
+
+} // namespace
+
+int main() {
+    const Op ops[] = {
+        {"allReduce", [](int n) { return 2.0 * (n - 1) / n; }, [](Communicator& c, Tensor& t) { c.allReduce(t); }},
+        {"reduceScatter", [](int n) { return double(n - 1) / n; },
+         [](Communicator& c, Tensor& t) { c.reduceScatter(t); }},
+        {"allGather", [](int n) { return double(n - 1) / n; },
+         [](Communicator& c, Tensor& t) {
+             // Gather segments that add up to the full tensor size
+             auto range = c.segment(t.size(), 0);
+             c.allGather(Tensor({range.second - range.first}));
+         }},
+        {"broadcast", [](int) { return 1.0; }, [](Communicator& c, Tensor& t) { c.broadcast(t, 0); }},
+        {"reduce", [](int) { return 1.0; }, [](Communicator& c, Tensor& t) { c.reduce(t, 0); }},
+    };
+    const size_t sizes[] = {size_t(1) << 16, size_t(1) << 20, size_t(1) << 24}; // floats
+    const int worlds[] = {2, 4, 8};
+
+    // Below the usual ephemeral range (32768+) so outgoing sockets never hold them
+    int basePort = 10000 + (getpid() % 500) * 40;
+    std::cout << "Bus bandwidth in GB/s over loopback TCP, " << std::thread::hardware_concurrency()
+              << " hardware threads\n";
+    std::cout << std::left << std::setw(16) << "op" << std::setw(12) << "bytes";
+    for (int n : worlds) std::cout << std::right << std::setw(10) << (std::to_string(n) + " nodes");
+    std::cout << "\n";
+
+    for (const Op& op : ops) {
+        for (size_t floats : sizes) {
+            const double bytes = double(floats) * sizeof(float);
+            std::cout << std::left << std::setw(16) << op.name << std::setw(12) << size_t(bytes) << std::right;
+            for (int n : worlds) {
+                basePort += n;
+                const int reps = floats >= (size_t(1) << 24) ? 3 : 10;
+                double secs = bestSeconds(n, basePort, floats, op, reps);
+                std::cout << std::fixed << std::setprecision(2) << std::setw(10)
+                          << bytes * op.busFactor(n) / secs * 1e-9;
+            }
+            std::cout << "\n";
+        }
+    }
+    return 0;
+}
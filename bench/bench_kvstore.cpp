@@ -0,0 +1,146 @@
+// KVStore put/get under contention (90% get, 10% put over a few hot keys
+// or many keys, at several thread counts), checkpoint save/load, and a
+// many-key store saved key by key versus as one snapshot, and a 64 MiB
+// tensor with one changed chunk saved in full versus incrementally. Runs
+// in a scratch directory.
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Bench.h"
+#include "KVStore.h"
+#include "ThreadPool.h"
+
+namespace {
+
+const size_t OPS_PER_THREAD = 200000;
+
+void mixed(KVStore& store, const std::vector<std::string>& keys, size_t threads) {
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&store, &keys, t] {
+            auto value = std::make_shared<const Tensor>(std::vector<size_t>{16});
+            size_t found = 0;
+            for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+                const std::string& key = keys[(i * 7 + t) % keys.size()];
+                if (i % 10 == 0) {
+                    store.put(key, value);
+                } else if (store.get(key)) {
+                    ++found;
+                }
+            }
+            if (found == 0) std::abort();
+        });
+    }
+    for (std::thread& w : workers) w.join();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchSuite suite("kvstore", argc, argv);
+    const std::string scratch = enterScratchDirectory();
+
+    for (size_t keyCount : {4, 4096}) {
+        KVStore store;
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < keyCount; ++i) {
+            keys.push_back("key" + std::to_string(i));
+            store.put(keys.back(), Tensor({16}));
+        }
+        for (size_t threads : {1, 2, 4, 8}) {
+            std::ostringstream name;
+            name << "get/put " << keyCount << " keys " << threads << "t";
+            suite.run(name.str(), "Mops/s", threads * OPS_PER_THREAD / 1e6, [&] { mixed(store, keys, threads); });
+        }
+    }
+
+    // loadFromDisk logs each load; keep the table readable
+    std::streambuf* console = std::cout.rdbuf();
+    std::ostringstream discarded;
+    for (size_t bytes : {size_t(1) << 20, size_t(64) << 20}) {
+        KVStore store;
+        Tensor t({bytes / sizeof(float)});
+        float* data = t.dataPtr();
+        for (size_t i = 0; i < t.size(); ++i) data[i] = static_cast<float>(i);
+        store.put("bench", t);
+        const std::string size = std::to_string(bytes >> 20) + "MiB";
+        const double gigabytes = bytes / 1e9;
+
+        suite.run("saveToDisk " + size, "GB/s", gigabytes, [&] { store.saveToDisk("bench", Durability::NONE); });
+        suite.run("saveToDisk fsync " + size, "GB/s", gigabytes, [&] { store.saveToDisk("bench", Durability::FILE); });
+        for (LoadMode mode : {LoadMode::READ, LoadMode::MMAP}) {
+            const std::string label = mode == LoadMode::READ ? "loadFromDisk read " : "loadFromDisk mmap ";
+            suite.run(label + size, "GB/s", gigabytes, [&] {
+                std::cout.rdbuf(discarded.rdbuf());
+                store.loadFromDisk("bench", mode);
+                std::cout.rdbuf(console);
+                // Touch the data so mmap loads pay for their page faults
+                store.get("bench")->sum();
+            });
+            discarded.str("");
+        }
+    }
+
+    // 2000 tensors of 64 KiB: one file per key versus one snapshot
+    {
+        KVStore store;
+        ThreadPool pool(4);
+        const size_t keys = 2000, floats = 16384;
+        for (size_t i = 0; i < keys; ++i) store.put("many" + std::to_string(i), Tensor({floats}));
+        const double gigabytes = keys * floats * sizeof(float) / 1e9;
+        suite.run("saveToDisk x2000 64KiB", "GB/s", gigabytes, [&] {
+            for (size_t i = 0; i < keys; ++i) store.saveToDisk("many" + std::to_string(i), Durability::NONE);
+        });
+        suite.run("saveSnapshot 2000x64KiB", "GB/s", gigabytes,
+                  [&] { store.saveSnapshot("checkpoints/bench.snap", &pool, Durability::NONE); });
+        suite.run("loadSnapshot read 2000x64KiB", "GB/s", gigabytes, [&] {
+            std::cout.rdbuf(discarded.rdbuf());
+            KVStore restored;
+            restored.loadSnapshot("checkpoints/bench.snap", LoadMode::READ, &pool);
+            std::cout.rdbuf(console);
+        });
+        for (size_t i = 0; i < keys; ++i) std::remove(("checkpoints/many" + std::to_string(i) + ".chk").c_str());
+        std::remove("checkpoints/bench.snap");
+    }
+
+    // 64 MiB tensor, one 1 MiB chunk changed between saves. The full base
+    // is written before timing and every repetition stays below
+    // DeltaConfig::maxDeltas, so each writes one delta.
+    {
+        KVStore store;
+        Tensor t({(size_t(64) << 20) / sizeof(float)});
+        store.put("delta", t);
+        DeltaConfig config;
+        config.maxDeltas = 1000;
+        store.saveIncremental("delta", config);
+        float step = 0.0f;
+        auto touch = [&] {
+            t[(size_t(step) * 262144) % t.size()] = step;
+            step += 1.0f;
+            store.put("delta", t);
+        };
+        BenchResult& full = suite.run("saveToDisk 64MiB, 1MiB changed", "GB/s", (64 << 20) / 1e9, [&] {
+            touch();
+            store.saveToDisk("delta", Durability::NONE);
+        });
+        store.saveIncremental("delta", config); // saveToDisk reset the delta state
+        BenchResult& delta = suite.run("saveIncremental 64MiB, 1MiB changed", "GB/s", (64 << 20) / 1e9, [&] {
+            touch();
+            store.saveIncremental("delta", config, Durability::NONE);
+        });
+        delta.extra["speedup"] = full.median() / delta.median();
+        std::remove("checkpoints/delta.chk");
+        std::remove("checkpoints/delta.manifest");
+        for (size_t seq = 0; seq <= size_t(step); ++seq) {
+            std::remove(("checkpoints/delta.delta." + std::to_string(seq)).c_str());
+        }
+    }
+
+    std::remove("checkpoints/bench.chk");
+    rmdir("checkpoints");
+    rmdir(scratch.c_str());
+    return suite.finish();
+}
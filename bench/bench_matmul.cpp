@@ -0,0 +1,68 @@
+// GEMM throughput across shapes, single-threaded and on a ThreadPool.
+// Reports the best of several runs in GFLOP/s (2*M*N*K flops per product).
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "Kernels.h"
+#include "Tensor.h"
+#include "ThreadPool.h"
+
+namespace {
+
+struct Shape {
+    size_t batch, M, N, K;
+};
+
+double bestSeconds(const Tensor& a, const Tensor& b, ThreadPool* pool, int reps) {
+    a.matmul(b, pool); // warm up caches and packing buffers
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        Tensor c = a.matmul(b, pool);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, secs);
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool pool(threads > 1 ? threads - 1 : 1);
+
+    std::cout << "SIMD level: " << kernels::simdLevelName(kernels::activeSimdLevel())
+              << ", threads: " << threads << "\n";
+    std::cout << std::left << std::setw(22) << "shape (BxMxNxK)"
+              << std::right << std::setw(14) << "1 thread" << std::setw(14) << "pool" << "\n";
+
+    const Shape shapes[] = {
+        {1, 64, 64, 64},     {1, 128, 128, 128},  {1, 256, 256, 256},  {1, 512, 512, 512},
+        {1, 1024, 1024, 1024}, {1, 1024, 64, 1024}, {1, 64, 1024, 1024}, {1, 2048, 256, 512},
+        {8, 128, 128, 128},  {16, 256, 256, 64},
+    };
+
+    for (const Shape& s : shapes) {
+        Tensor a = s.batch > 1 ? Tensor({s.batch, s.M, s.K}) : Tensor({s.M, s.K});
+        Tensor b = s.batch > 1 ? Tensor({s.batch, s.K, s.N}) : Tensor({s.K, s.N});
+        float* pa = a.dataPtr();
+        float* pb = b.dataPtr();
+        for (size_t i = 0; i < a.size(); ++i) pa[i] = static_cast<float>(i % 7) * 0.5f;
+        for (size_t i = 0; i < b.size(); ++i) pb[i] = static_cast<float>(i % 5) * 0.25f;
+
+        const double flops = 2.0 * s.batch * s.M * s.N * s.K;
+        const int reps = flops > 1e9 ? 3 : 10;
+        const double serial = flops / bestSeconds(a, b, nullptr, reps) * 1e-9;
+        const double parallel = flops / bestSeconds(a, b, &pool, reps) * 1e-9;
+
+        std::ostringstream label;
+        label << s.batch << "x" << s.M << "x" << s.N << "x" << s.K;
+        std::cout << std::left << std::setw(22) << label.str() << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(14) << serial << std::setw(14) << parallel << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Loopback send/receive through a Node: one client streams tensors to a
+// Node's Reactor and each repetition ends once the Node has received them
+// all (its node.tensors_received counter). Runs in a scratch directory so
+// the Node's checkpoints stay out of the repository.
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Bench.h"
+#include "Node.h"
+#include "TensorWire.h"
+
+namespace {
+
+const int PORT = 5990;
+
+int connectLoopback(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sock < 0 || connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        if (sock >= 0) close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchSuite suite("node", argc, argv);
+    const std::string scratch = enterScratchDirectory();
+    const size_t BYTES_PER_REP = size_t(64) << 20;
+
+    // Node logs its startup; only the table should reach the console
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+    int status = 0;
+    {
+        Node node(PORT, 4);
+        node.startServer();
+        Counter& received = node.metrics().counter("node.tensors_received");
+        int sock = connectLoopback(PORT);
+        if (sock < 0) {
+            std::cerr << "Could not connect to the Node on port " << PORT << std::endl;
+            status = 1;
+        }
+
+        for (size_t bytes : {size_t(4) << 10, size_t(256) << 10, size_t(4) << 20}) {
+            if (sock < 0) break;
+            Tensor t({bytes / sizeof(float)});
+            std::fill(t.dataPtr(), t.dataPtr() + t.size(), 1.0f);
+            const WireHeader header = encodeWireHeader(t);
+            const size_t count = BYTES_PER_REP / bytes;
+            const std::string size = bytes >= (size_t(1) << 20) ? std::to_string(bytes >> 20) + "MiB"
+                                                                 : std::to_string(bytes >> 10) + "KiB";
+
+            BenchResult& r = suite.run("send/receive " + size, "GB/s", double(bytes) * count / 1e9, [&] {
+                const uint64_t target = received.value() + count;
+                for (size_t i = 0; i < count; ++i) {
+                    if (!sendTensor(sock, header, t)) throw std::runtime_error("send failed");
+                }
+                while (received.value() < target) std::this_thread::sleep_for(std::chrono::microseconds(50));
+            });
+            r.extra["tensors_per_s"] = count / r.median();
+        }
+        if (sock >= 0) close(sock);
+    }
+    std::cout.rdbuf(console);
+
+    // Every tensor sent has the same contents per size, so the incremental
+    // writer leaves a base and manifest but no deltas
+    std::remove("checkpoints/latest_tensor.chk");
+    std::remove("checkpoints/latest_tensor.manifest");
+    rmdir("checkpoints");
+    rmdir(scratch.c_str());
+    int reported = suite.finish();
+    return status ? status : reported;
+}
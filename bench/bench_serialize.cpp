@@ -0,0 +1,33 @@
+// Tensor::serializeBinary / deserializeBinary in GB/s of tensor data,
+// across sizes from a few KiB to 64 MiB. Small sizes loop inside each
+// repetition so every timing covers at least ~64 MiB.
+#include <string>
+#include <vector>
+#include "Bench.h"
+#include "Tensor.h"
+
+int main(int argc, char** argv) {
+    BenchSuite suite("serialize", argc, argv);
+    const size_t MIN_BYTES_PER_REP = size_t(64) << 20;
+
+    for (size_t bytes : {size_t(4) << 10, size_t(64) << 10, size_t(1) << 20, size_t(16) << 20, size_t(64) << 20}) {
+        Tensor t({bytes / sizeof(float)});
+        float* data = t.dataPtr();
+        for (size_t i = 0; i < t.size(); ++i) data[i] = static_cast<float>(i % 1000) * 0.5f;
+        const size_t loops = std::max<size_t>(1, MIN_BYTES_PER_REP / bytes);
+        const double gigabytes = double(bytes) * loops / 1e9;
+        const std::string size = bytes >= (size_t(1) << 20) ? std::to_string(bytes >> 20) + "MiB"
+                                                             : std::to_string(bytes >> 10) + "KiB";
+
+        size_t sink = 0;
+        suite.run("serializeBinary " + size, "GB/s", gigabytes, [&] {
+            for (size_t i = 0; i < loops; ++i) sink += t.serializeBinary().size();
+        });
+        const std::vector<char> wire = t.serializeBinary();
+        suite.run("deserializeBinary " + size, "GB/s", gigabytes, [&] {
+            for (size_t i = 0; i < loops; ++i) sink += Tensor::deserializeBinary(wire).size();
+        });
+        if (sink == 0) return 1; // keeps the loops from being optimized out
+    }
+    return suite.finish();
+}
@@ -0,0 +1,60 @@
+// ThreadPool::enqueue throughput (a burst of empty tasks, enqueued and
+// drained) and dispatch latency (enqueue to task start, one task in flight)
+// at several thread counts, for both pool modes.
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include "Bench.h"
+#include "Metrics.h"
+#include "ThreadPool.h"
+
+namespace {
+
+const size_t BURST = 200000;
+const size_t PINGS = 2000;
+
+void burst(ThreadPool& pool) {
+    std::atomic<size_t> done{0};
+    for (size_t i = 0; i < BURST; ++i) {
+        pool.enqueue([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while (done.load(std::memory_order_relaxed) < BURST) std::this_thread::yield();
+}
+
+// Enqueue to start of execution, one task at a time so nothing queues
+void pings(ThreadPool& pool, Histogram& latency) {
+    for (size_t i = 0; i < PINGS; ++i) {
+        std::promise<void> ran;
+        std::future<void> wait = ran.get_future();
+        auto start = std::chrono::steady_clock::now();
+        pool.enqueue([&ran, &latency, start] {
+            latency.recordSince(start);
+            ran.set_value();
+        });
+        wait.wait();
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchSuite suite("threadpool", argc, argv);
+    for (PoolMode mode : {PoolMode::SHARED_QUEUE, PoolMode::WORK_STEALING}) {
+        const std::string modeName = mode == PoolMode::SHARED_QUEUE ? "shared" : "stealing";
+        for (size_t threads : {1, 2, 4, 8}) {
+            ThreadPool pool(threads, mode);
+            const std::string label = modeName + "/" + std::to_string(threads) + "t";
+            suite.run("enqueue " + label, "Mtasks/s", BURST / 1e6, [&] { burst(pool); });
+
+            Histogram latency;
+            BenchResult& r = suite.run("dispatch " + label, "Ktasks/s", PINGS / 1e3, [&] { pings(pool, latency); });
+            HistogramSummary s = latency.summary();
+            r.extra["p50_us"] = s.p50 / 1e3;
+            r.extra["p99_us"] = s.p99 / 1e3;
+            r.extra["p999_us"] = s.p999 / 1e3;
+        }
+    }
+    return suite.finish();
+}
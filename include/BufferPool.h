@@ -0,0 +1,72 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct BufferPoolStats {
+    uint64_t hits = 0;       // allocations served from an idle buffer
+    uint64_t misses = 0;     // allocations that went to the system allocator
+    uint64_t bytesHeld = 0;  // idle buffers waiting for reuse
+    uint64_t bytesInUse = 0; // buffers handed out and not yet released
+};
+
+// Process-wide pool of 64-byte-aligned buffers for tensor storage.
+// Requests are rounded up to a size class (multiples of 64 bytes up to
+// 1 KiB, then four classes per power of two, so at most 25% is wasted) and
+// released buffers are kept for the next request of the same class instead
+// of going back to the system. Buffers up to 256 KiB are recycled through a
+// small per-thread cache first, so the common case takes no lock; larger
+// ones go through shared per-class lists that any thread can reuse.
+// Buffers over 1 GiB, and releases that would push the idle total past
+// maxHeldBytes, bypass the pool.
+class BufferPool {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    static BufferPool& instance();
+
+    // Uninitialized, ALIGNMENT-aligned; throws std::bad_alloc. Zero bytes
+    // gives nullptr.
+    void* allocate(size_t bytes);
+    // `bytes` must be the size passed to allocate()
+    void release(void* ptr, size_t bytes);
+
+    BufferPoolStats stats() const;
+    // Cap on idle bytes kept for reuse (default 512 MiB); 0 disables pooling
+    void setMaxHeldBytes(size_t bytes);
+    // Frees every idle buffer in the shared lists and the calling thread's
+    // cache. Other threads free their caches on their next allocate or
+    // release (or at exit); a thread that never touches the pool again
+    // keeps up to 8 buffers per class of at most 256 KiB until it exits.
+    void trim();
+
+    // Bytes actually reserved for a request of `bytes`
+    static size_t classBytes(size_t bytes);
+
+private:
+    struct ThreadCache;
+    static constexpr size_t NUM_CLASSES = 96;
+
+    BufferPool() = default;
+    // The calling thread's cache, emptied first if trim() ran since it was
+    // last used
+    ThreadCache& threadCache();
+    void releaseShared(void* ptr, size_t index);
+    void freeIdle(std::vector<void*>* lists);
+
+    std::mutex mutex; // guards freeLists
+    std::vector<void*> freeLists[NUM_CLASSES];
+    std::atomic<size_t> maxHeldBytes{size_t(512) << 20};
+    // Bumped by trim(); thread caches from an older generation are stale
+    std::atomic<uint64_t> trimGeneration{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> bytesHeld{0};
+    std::atomic<uint64_t> bytesInUse{0};
+};
+
+#endif
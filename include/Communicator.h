@@ -0,0 +1,89 @@
+#ifndef COMMUNICATOR_H
+#define COMMUNICATOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "Tensor.h"
+
+struct CommOptions {
+    // Granularity of pipelining: a chunk is reduced and forwarded as soon
+    // as it has arrived, while later chunks are still on the wire
+    size_t chunkBytes = 256 * 1024;
+    int socketBufferBytes = 4 << 20;
+    // How long connect() keeps retrying peers that have not started yet
+    std::chrono::milliseconds connectTimeout{10000};
+};
+
+// Collective operations among worldSize ranks on this host. Rank r listens
+// on basePort + r; connect() builds a full mesh of TCP connections, so ring
+// neighbours and tree parents/children are all one hop away.
+//
+// Every rank must call the same collectives in the same order with tensors
+// of the same size. The reduction is elementwise sum. Errors (a peer
+// disconnecting, timeouts) throw std::runtime_error.
+//
+//   allReduce / reduceScatter / allGather: ring algorithms, bandwidth-optimal
+//     for large tensors; each rank sends and receives 2(N-1)/N (allReduce)
+//     or (N-1)/N of the data.
+//   broadcast / reduce: binomial trees, log2(N) rounds, better latency for
+//     small tensors.
+class Communicator {
+public:
+    Communicator(int rank, int worldSize, int basePort, const CommOptions& options = CommOptions());
+    ~Communicator();
+    Communicator(const Communicator&) = delete;
+    Communicator& operator=(const Communicator&) = delete;
+
+    // Blocks until connected to every other rank
+    void connect();
+
+    int rank() const { return myRank; }
+    int size() const { return worldSize; }
+
+    // Sum across ranks, result on every rank
+    void allReduce(Tensor& tensor);
+    // Sum across ranks; returns this rank's segment (see segment()) of the
+    // result as a 1-D tensor
+    Tensor reduceScatter(const Tensor& input);
+    // Concatenates every rank's tensor (all the same size) into a tensor of
+    // shape {worldSize, local.shape...}
+    Tensor allGather(const Tensor& local);
+    // Copies root's tensor to every rank
+    void broadcast(Tensor& tensor, int root);
+    // Sum across ranks, result on root only (other ranks' tensors are left
+    // holding partial sums)
+    void reduce(Tensor& tensor, int root);
+
+    // [begin, end) element range of segment i when n elements are split
+    // across the ranks for reduceScatter/allReduce
+    std::pair<size_t, size_t> segment(size_t n, int i) const;
+
+private:
+    struct Piece {
+        char* data;
+        size_t bytes;
+    };
+
+    int myRank;
+    int worldSize;
+    int basePort;
+    CommOptions options;
+    int listenFd = -1;
+    std::vector<int> peers; // socket per rank, -1 for ourselves
+    std::vector<float> staging;
+
+    void tune(int fd);
+    void ringExchange(const std::vector<Piece>& out, const std::vector<Piece>& in,
+                      size_t initiallyReady, bool reduceIncoming);
+    // segments[i] is rank i's share of the buffer
+    void ringReduceScatter(const std::vector<Piece>& segments);
+    void ringAllGather(const std::vector<Piece>& segments);
+    std::vector<Piece> floatSegments(float* data, size_t n) const;
+    void sendTo(int rank, const char* data, size_t bytes);
+    void recvReduce(int rank, float* data, size_t n);
+    void recvInto(int rank, char* data, size_t bytes);
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef DTYPE_H
+#define DTYPE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Element type of a Tensor. The value is the TENS header's dtype byte and
+// shares that space with WireEncoding (4 is the wire-only QINT8).
+//   FLOAT16/BFLOAT16  stored as raw 16-bit patterns (Kernels.h converts)
+//   INT8/INT32        plain integers; conversions from floating point
+//                     round to nearest and saturate, NaN becomes 0
+enum class DType : uint8_t {
+    FLOAT32 = 1,
+    FLOAT16 = 2,
+    BFLOAT16 = 3,
+    INT8 = 5,
+    INT32 = 6,
+    FLOAT64 = 7
+};
+
+size_t dtypeSize(DType dtype);
+const char* dtypeName(DType dtype);
+// False for dtype bytes that are not a DType
+bool isDType(uint8_t code);
+
+// Converts n elements between any two dtypes; in and out must not overlap.
+// Half-precision types go through the SIMD kernels; FLOAT64 <-> integer
+// conversions are exact where the value fits.
+void convertElements(DType from, const void* in, DType to, void* out, size_t n);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef ELEMENTWISE_H
+#define ELEMENTWISE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Tensor.h"
+
+// One step of an elementwise chain, applied to the running value x:
+// ADD/MUL combine x with the operand tensor at index `operand` (broadcast
+// like Tensor::add), SCALE multiplies x by `scalar` and ADD_SCALAR adds it.
+enum class ElementwiseOp : uint8_t {
+    ADD,
+    MUL,
+    SCALE,
+    ADD_SCALAR,
+    RELU,
+    GELU
+};
+
+struct ElementwiseStep {
+    ElementwiseOp op;
+    float scalar = 0.0f;
+    size_t operand = 0;
+};
+
+// Floats per tile of runElementwise(); a tile and an operand tile stay in L1
+constexpr size_t ELEMENTWISE_TILE = 1024;
+
+// Runs `steps` over `source` in one pass: each tile is read once, pushed
+// through every step with the Kernels.h kernels while it is in cache, and
+// written once, so a chain costs about as much memory traffic as one op.
+// operands[k] is read by steps with operand == k. `out` gets source's shape
+// as float32, reusing its storage when private and large enough; it may be
+// `source` itself to update in place. Other dtypes are cast to float32
+// first. Throws std::runtime_error for a missing or unbroadcastable operand.
+void runElementwise(const std::vector<ElementwiseStep>& steps, const Tensor& source,
+                    const std::vector<const Tensor*>& operands, Tensor& out);
+
+#endif
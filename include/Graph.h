@@ -3,18 +3,89 @@
 
 #include "GraphNode.h"
 #include "ThreadPool.h"
+#include <cstdint>
 #include <vector>
 #include <memory>
+#include <future>
+#include <string>
+
+// Where Graph::planMemory() puts each node's tensor. Planned nodes are
+// intermediates (nodes with an operation read by other nodes of the graph)
+// and in-place nodes that take over an intermediate's buffer. Graph inputs
+// and other outputs keep their own tensors. Per-node vectors are indexed
+// like Graph::nodes.
+struct MemoryPlan {
+    static constexpr size_t NONE = SIZE_MAX;
+
+    std::vector<const GraphNode*> nodes; // the graph the plan was made for
+    std::vector<size_t> order; // schedule the lifetimes refer to
+    std::vector<size_t> firstUse, lastUse; // positions in `order`; lastUse is order.size() for kept tensors
+    std::vector<size_t> buffer; // NONE if not planned
+    std::vector<bool> inPlace; // takes over inputs[0]'s buffer
+    std::vector<std::vector<size_t>> shapes; // tensor shapes and dtypes when planned
+    std::vector<DType> dtypes;
+    // Extra predecessors so a buffer is reused only after its previous
+    // holder's last reader finished
+    std::vector<std::vector<size_t>> waitFor;
+
+    std::vector<size_t> bufferBytes;
+    size_t naiveBytes = 0; // every planned tensor alive at once
+    size_t plannedBytes = 0; // peak with the plan (sum of bufferBytes)
+
+    std::string report() const;
+};
 
 class Graph {
 public:
     std::vector<std::shared_ptr<GraphNode>> nodes;
 
-    void execute(ThreadPool* pool) {
-        for (auto& node : nodes) {
-            node->compute(pool);
-        }
-    }
+    // Dependency-aware execution: a node is released onto the pool only once
+    // every producer in its `inputs` that belongs to this graph has finished,
+    // so independent branches run concurrently. Inputs that are not part of
+    // the graph are treated as already computed. The future becomes ready when
+    // the whole graph is done; if an operation throws, its dependents are
+    // skipped and the first exception is rethrown from the future.
+    // Throws std::runtime_error if the graph contains a cycle.
+    //
+    // With a plan from planMemory(), planned tensors live in the plan's
+    // shared buffers: each one is handed its buffer (contents unspecified)
+    // just before its operation runs and gives it up once its last reader
+    // in the graph has finished, so intermediates are empty afterwards.
+    // Throws std::runtime_error if `plan` was made for other nodes.
+    std::future<void> executeAsync(ThreadPool* pool, const MemoryPlan* plan = nullptr);
+
+    // Blocking wrapper around executeAsync(). Do not call from a worker of
+    // the same pool: the waiting worker cannot help run the graph.
+    void execute(ThreadPool* pool, const MemoryPlan* plan = nullptr);
+
+    // Assigns planned tensors to reusable buffers from their lifetimes over
+    // topologicalOrder(): best fit among buffers whose holder is dead, or a
+    // new one. An inPlace node reuses inputs[0]'s buffer when it is that
+    // intermediate's last reader, the shape and dtype match and it does not
+    // read inputs[0] again (x + x); otherwise it gets a buffer of its own and
+    // a copy of its input. Sizes are taken from the current tensors, so plan
+    // before the first planned run.
+    MemoryPlan planMemory() const;
+
+    // Merges each elementwise node (GraphNode::elementwise) into the
+    // elementwise node that reads it as inputs[0], when that is its only
+    // reader and does not also use it as an operand. The reader's chain
+    // becomes both chains and its inputs both nodes' inputs, and the
+    // producer is dropped from `nodes`, so a chain like scale -> add bias
+    // -> relu runs as one pass with one write. Returns how many nodes were
+    // merged away.
+    size_t fuseElementwise();
+
+    // Indices into `nodes` in a valid execution order (Kahn's algorithm).
+    // Throws std::runtime_error if the graph contains a cycle.
+    std::vector<size_t> topologicalOrder() const;
+
+private:
+    // Per-node consumers (indices into `nodes`) and in-degree counts
+    void buildEdges(std::vector<std::vector<size_t>>& dependents,
+                    std::vector<size_t>& inDegree) const;
+    // Per node, the index of each input (MemoryPlan::NONE if outside the graph)
+    std::vector<std::vector<size_t>> inputIndices() const;
 };
 
 #endif
@@ -1,14 +1,17 @@
 #ifndef GRAPHNODE_H
 #define GRAPHNODE_H
 
+#include "Elementwise.h"
 #include "Tensor.h"
 #include "ThreadPool.h"
 #include <vector>
 #include <memory>
 #include <functional>
 #include <string>
+#include <stdexcept>
 #include <iostream>
 #include <thread>
+#include <future>
 
 class GraphNode {
 public:
@@ -16,15 +19,45 @@ public:
     Tensor tensor;
     std::vector<std::shared_ptr<GraphNode>> inputs;
     std::function<void()> operation; // define how to compute tensor
+    // The operation updates `tensor` in place: the executor hands it
+    // inputs[0]'s tensor before it runs (see Graph::planMemory())
+    bool inPlace = false;
+    // Typed elementwise chain run over inputs[0] (or, in place, over
+    // `tensor`); ADD/MUL operands index `inputs`. Empty for opaque nodes.
+    // Graph::fuseElementwise() merges consecutive chains into one node.
+    std::vector<ElementwiseStep> elementwise;
 
-    void compute(ThreadPool* pool) {
+    // Makes this an elementwise node: sets `elementwise` and an `operation`
+    // that runs it. The operation refers to this node, so don't copy it.
+    void setElementwise(std::vector<ElementwiseStep> steps) {
+        elementwise = std::move(steps);
+        operation = [this] {
+            std::vector<const Tensor*> operands;
+            for (const auto& input : inputs) operands.push_back(&input->tensor);
+            if (!inPlace && inputs.empty()) throw std::runtime_error("Elementwise node " + name + " has no input");
+            runElementwise(elementwise, inPlace ? tensor : inputs[0]->tensor, operands, tensor);
+        };
+    }
+
+    // Returns a future that is ready once the operation has run
+    // (immediately ready for nodes without an operation, e.g. inputs)
+    std::future<void> compute(ThreadPool* pool) {
+        if (!operation) {
+            std::promise<void> done;
+            done.set_value();
+            return done.get_future();
+        }
+
+        return pool->submit([this]() { run(); });
+    }
+
+    // Run the operation on the calling thread
+    void run() {
         if (!operation) return;
 
-        pool->enqueue([this]() {
-            operation();
-            std::cout << "Node " << name << " computed on thread "
-                      << std::this_thread::get_id() << std::endl;
-        });
+        operation();
+        std::cout << "Node " << name << " computed on thread "
+                  << std::this_thread::get_id() << std::endl;
     }
 };
 
@@ -2,20 +2,189 @@
 #define KVSTORE_H
 
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include "Metrics.h"
 #include "Tensor.h"
 
+class ThreadPool;
+
+// How loadFromDisk() brings a checkpoint into memory
+enum class LoadMode {
+    READ, // read the file into a private buffer
+    MMAP  // map the file; tensor data stays in the page cache until written
+};
+
+// How hard a checkpoint write pushes data to stable storage
+enum class Durability {
+    NONE,        // temp file + rename only; the OS flushes whenever it likes
+    FILE,        // fsync the file before it is renamed into place
+    FILE_AND_DIR // also fsync checkpoints/ so the rename itself survives a crash
+};
+
+// Incremental checkpoints (see KVStore::saveIncremental())
+struct DeltaConfig {
+    // Granularity of change detection; each changed chunk is written whole
+    size_t chunkBytes = size_t(1) << 20;
+    // A full base is rewritten instead of a delta once this many deltas
+    // exist, or once the deltas would add up to the tensor's size
+    size_t maxDeltas = 8;
+};
+
+struct CheckpointConfig {
+    // How long the writer lets dirty keys accumulate before writing them
+    std::chrono::milliseconds flushInterval{100};
+    Durability durability = Durability::FILE;
+    // If set, the writer records each checkpoint write into the
+    // kvstore.checkpoint_write histogram. Must outlive stopCheckpointing().
+    MetricsRegistry* metrics = nullptr;
+    // Write each key with saveIncremental() instead of in full
+    bool incremental = false;
+    DeltaConfig delta;
+};
+
+// Thread-safe tensor store. Keys are spread over independently locked shards
+// (lock striping) and values are immutable shared tensors: readers take a
+// shared lock just long enough to copy a shared_ptr, and writers swap the
+// pointer, so hot keys are read concurrently without copying tensor data.
 class KVStore {
 public:
+    explicit KVStore(size_t shardCount = 16);
+    ~KVStore();
+
     void put(const std::string& key, const Tensor& tensor);
-    bool get(const std::string& key, Tensor& outTensor);
-    bool saveToDisk(const std::string& key);
-    bool loadFromDisk(const std::string& key);
+    void put(const std::string& key, std::shared_ptr<const Tensor> tensor);
+
+    // Handle to the current value (nullptr if absent). The handle stays
+    // valid and unchanged after later puts replace the key.
+    std::shared_ptr<const Tensor> get(const std::string& key) const;
+    // Copying variant; the copy shares storage until written (see Tensor)
+    bool get(const std::string& key, Tensor& outTensor) const;
+
+    // Total nbytes() of the stored tensors; locks each shard in turn
+    size_t bytes() const;
+
+    // Writes checkpoints/<key>.chk via a temp file and rename, so readers
+    // (including live mappings of the old file) never see a partial file.
+    // No store lock is held during the write.
+    bool saveToDisk(const std::string& key, Durability durability = Durability::NONE);
+    // Also replays the key's deltas, if saveIncremental() left any
+    bool loadFromDisk(const std::string& key, LoadMode mode = LoadMode::READ);
+
+    // Incremental checkpoint. Hashes the value in chunks and writes only
+    // the chunks that changed since the key's previous incremental save to
+    // checkpoints/<key>.delta.<n>, then commits it by replacing
+    // checkpoints/<key>.manifest. Writes a full base (checkpoints/<key>.chk)
+    // instead when nothing is known about the key (first save, or after a
+    // restart without loadFromDisk()), when its dtype, shape or chunk size
+    // changed, or when compaction is due (see DeltaConfig). Incremental
+    // saves are serialized across keys.
+    bool saveIncremental(const std::string& key, const DeltaConfig& config = DeltaConfig(),
+                         Durability durability = Durability::NONE);
+
+    // Whole-store snapshot in one file: an index of key -> (offset, length,
+    // dtype, shape), then every tensor with its data at a page-aligned
+    // offset (format in KVStore.cpp). Each key is captured as of when its
+    // shard is visited. Data is written in parallel across `pool` when
+    // given, into a temp file that is renamed into place.
+    bool saveSnapshot(const std::string& path, ThreadPool* pool = nullptr, Durability durability = Durability::FILE);
+    // Reads and validates the whole index before storing anything. MMAP
+    // maps the file and each tensor pages in on first access; READ reads
+    // them all into private memory, in parallel across `pool`. Keys in the
+    // snapshot replace current values; other keys are kept.
+    bool loadSnapshot(const std::string& path, LoadMode mode = LoadMode::MMAP, ThreadPool* pool = nullptr);
+
+    // Write-behind checkpointing. A background writer persists keys passed
+    // to scheduleSave() once per flush interval; a key scheduled several
+    // times in between is written once, with its latest value.
+    void startCheckpointing(const CheckpointConfig& config = CheckpointConfig());
+    // Flushes everything still pending, then stops the writer. Concurrent
+    // callers all return once the writer has exited.
+    void stopCheckpointing();
+    // Returns immediately; saves synchronously if no writer is running
+    void scheduleSave(const std::string& key);
+    // Blocks until every key scheduled before the call is on disk. Returns
+    // false if any checkpoint write failed since the previous flush().
+    bool flush();
 
 private:
-    std::unordered_map<std::string, Tensor> store;
-    std::mutex storeMutex;
+    // Padded to a cache line so neighbouring shard locks don't false-share
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<const Tensor>> values;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard& shardFor(const std::string& key) const;
+
+    // Held by startCheckpointing()/stopCheckpointing() throughout, join
+    // included, so neither sees a writer that is still shutting down
+    std::mutex checkpointLifecycleMutex;
+    // Background checkpoint writer state, guarded by checkpointMutex
+    std::mutex checkpointMutex;
+    std::condition_variable checkpointCv;
+    std::thread checkpointThread;
+    CheckpointConfig checkpointConfig;
+    std::unordered_set<std::string> dirtyKeys;
+    bool checkpointRunning = false;
+    bool flushRequested = false;
+    bool checkpointFailed = false;
+    uint64_t scheduledSeq = 0; // bumped by scheduleSave()
+    uint64_t writtenSeq = 0;   // highest scheduledSeq fully written
+
+    void checkpointLoop();
+    // Which file a manifest's base is. A base is replaced through a temp
+    // file created while the old one still exists, so the inode differs.
+    struct FileIdentity {
+        uint64_t device = 0, inode = 0, size = 0, mtimeNs = 0;
+        // Fills this in from fstat() of an open file
+        bool read(int fd);
+        bool operator==(const FileIdentity& other) const;
+    };
+    // Writes the base checkpoint. Any delta manifest is removed before the
+    // new base is renamed into place; `written`, if given, receives the
+    // new file's identity.
+    bool writeCheckpoint(const std::string& key, const Tensor& tensor, Durability durability,
+                         FileIdentity* written = nullptr);
+    // What the base and deltas on disk hold for a key, as chunk hashes
+    struct DeltaState {
+        DType dtype = DType::FLOAT32;
+        std::vector<size_t> shape;
+        size_t chunkBytes = 0;
+        std::vector<uint64_t> hashes; // after the deltas
+        uint64_t baseHash = 0;        // of the base's own chunk hashes
+        FileIdentity base;
+        std::vector<uint64_t> deltas; // sequence numbers, oldest first
+        uint64_t deltaBytes = 0;
+        uint64_t nextSeq = 0;
+    };
+    std::mutex deltaMutex; // held across each incremental save
+    std::unordered_map<std::string, DeltaState> deltaStates;
+
+    bool writeIncremental(const std::string& key, const Tensor& tensor, const DeltaConfig& config,
+                          Durability durability);
+    // Applies the deltas listed in `manifest` to `tensor`, the base just
+    // read from the file identified by `base`, writing to its memory in
+    // place, and records what is on disk for later saves
+    void replayDeltas(const std::string& key, Tensor& tensor, const std::vector<char>& manifest,
+                      const FileIdentity& base);
+    // A full checkpoint outside saveIncremental(): the key's manifest and
+    // delta files are removed, and the next incremental save starts over
+    bool writeFull(const std::string& key, const Tensor& tensor, Durability durability);
+    // Sequence numbers of the key's delta files and the next free one,
+    // from its state or else from the manifest an earlier run left.
+    // Call with deltaMutex held.
+    std::vector<uint64_t> deltasOnDisk(const std::string& key, uint64_t& nextSeq);
+    // Drops the in-memory delta state of a key loaded without a manifest
+    void forgetDeltas(const std::string& key);
 };
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized float32 kernels over raw contiguous buffers.
+//
+// The implementation is chosen once at startup from what the CPU supports
+// (AVX-512F, AVX2+FMA, SSE2, or portable scalar code), so one binary runs on
+// every machine. Set DAE_SIMD=scalar|sse|avx2|avx512 to cap the level.
+// Output buffers may alias inputs (in-place updates are fine).
+namespace kernels {
+
+enum class SimdLevel {
+    SCALAR,
+    SSE,
+    AVX2,
+    AVX512
+};
+
+// Best level supported by this CPU and build
+SimdLevel detectedSimdLevel();
+// Level the kernels currently dispatch to
+SimdLevel activeSimdLevel();
+// Switch dispatch (clamped to detectedSimdLevel()); returns the level in use.
+// Intended for tests and benchmarks; not synchronized with running kernels.
+SimdLevel setSimdLevel(SimdLevel level);
+const char* simdLevelName(SimdLevel level);
+
+// Elementwise: out[i] = ...
+void add(const float* a, const float* b, float* out, size_t n);
+void mul(const float* a, const float* b, float* out, size_t n);
+void scale(const float* a, float s, float* out, size_t n);
+void fma(const float* a, const float* b, const float* c, float* out, size_t n); // a * b + c
+void relu(const float* a, float* out, size_t n);
+void gelu(const float* a, float* out, size_t n); // tanh approximation
+
+// Reductions
+float sum(const float* a, size_t n);
+float max(const float* a, size_t n); // -infinity when n == 0
+float dot(const float* a, const float* b, size_t n);
+
+// Reduced-precision conversions (round to nearest even). Scalar and SIMD
+// paths produce identical bits.
+void floatToHalf(const float* in, uint16_t* out, size_t n); // IEEE binary16
+void halfToFloat(const uint16_t* in, float* out, size_t n);
+void floatToBfloat16(const float* in, uint16_t* out, size_t n);
+void bfloat16ToFloat(const uint16_t* in, float* out, size_t n);
+
+// Blockwise int8: every Q8_BLOCK values become a float scale (absmax / 127)
+// followed by Q8_BLOCK int8 values; a final partial block is zero-padded.
+// absmax is taken over finite values; NaN quantizes to 0 and ±Inf to ±127
+// (0 in a block with no nonzero finite value). Identical bits on every path.
+constexpr size_t Q8_BLOCK = 32;
+constexpr size_t Q8_BLOCK_BYTES = sizeof(float) + Q8_BLOCK;
+inline size_t q8Bytes(size_t n) { return (n + Q8_BLOCK - 1) / Q8_BLOCK * Q8_BLOCK_BYTES; }
+void quantizeQ8(const float* in, char* out, size_t n); // writes q8Bytes(n)
+void dequantizeQ8(const char* in, float* out, size_t n);
+
+} // namespace kernels
+
+#endif
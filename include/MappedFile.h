@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Private memory mapping of a whole file. Pages are faulted in
+// only when touched, so mapping a large checkpoint is O(1) regardless of
+// its size. The mapping stays valid after the file is replaced by rename.
+class MappedFile {
+public:
+    // Returns nullptr if the file cannot be opened or mapped. With
+    // copyOnWrite the pages are also writable: writes land in private
+    // copies of the pages they touch and never reach the file.
+    static std::shared_ptr<MappedFile> open(const std::string& path, bool copyOnWrite = false);
+    // Maps a file the caller has open; fd stays the caller's to close
+    static std::shared_ptr<MappedFile> map(int fd, bool copyOnWrite = false);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    MappedFile() = default;
+
+    const char* base = nullptr;
+    size_t length = 0;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MATMUL_H
+#define MATMUL_H
+
+#include <cstddef>
+
+class ThreadPool;
+
+// Single-precision GEMM on row-major matrices: C[M,N] = A[M,K] * B[K,N].
+// lda/ldb/ldc are row strides in elements. C is overwritten.
+//
+// Follows the usual packed, cache-blocked layout: B is packed into KCxNC
+// panels that stay in L2/L3, A into MCxKC blocks that stay in L2, and a
+// register-blocked micro-kernel (AVX-512, AVX2+FMA or scalar, picked from
+// kernels::activeSimdLevel()) accumulates an MRxNR tile of C in registers.
+// With a pool, independent tiles of C are spread across its workers and the
+// calling thread works on tiles too.
+void sgemm(size_t M, size_t N, size_t K,
+           const float* A, size_t lda,
+           const float* B, size_t ldb,
+           float* C, size_t ldc,
+           ThreadPool* pool = nullptr);
+
+// `batch` independent products; strides are element offsets between
+// consecutive matrices (use 0 to share an operand across the batch).
+void sgemmBatched(size_t batch, size_t M, size_t N, size_t K,
+                  const float* A, size_t lda, size_t strideA,
+                  const float* B, size_t ldb, size_t strideB,
+                  float* C, size_t ldc, size_t strideC,
+                  ThreadPool* pool = nullptr);
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Monotonic count, sharded so threads bumping it rarely share a cache line.
+// add() is one relaxed atomic add; value() sums the shards.
+class Counter {
+public:
+    static constexpr size_t SHARDS = 16;
+
+    void add(uint64_t n = 1);
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, SHARDS> shards;
+};
+
+// Point-in-time value set by its owner
+class Gauge {
+public:
+    void set(double v) { current.store(v, std::memory_order_relaxed); }
+    double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> current{0.0};
+};
+
+struct HistogramSummary {
+    uint64_t count = 0;
+    // Nanoseconds; percentiles are accurate to one bucket (~3%)
+    double mean = 0.0;
+    uint64_t min = 0;
+    uint64_t p50 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+};
+
+// HDR-style latency histogram over nanoseconds: each power of two is split
+// into 2^SUB_BITS linear buckets, so every recorded value lands in a bucket
+// within ~3% of it, from 1 ns up to the full uint64 range. record() is a
+// few relaxed atomic operations and never locks.
+class Histogram {
+public:
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BITS;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + (64 - SUB_BITS) * SUB_BUCKETS;
+
+    void record(uint64_t nanos);
+    void recordSince(std::chrono::steady_clock::time_point start);
+
+    uint64_t count() const;
+    // Smallest bucket bound at or above a fraction q (0..1) of the samples;
+    // 0 when empty
+    uint64_t percentile(double q) const;
+    HistogramSummary summary() const;
+
+    static size_t bucketFor(uint64_t nanos);
+    // Largest value that falls in `bucket`
+    static uint64_t bucketUpperBound(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> minimum{UINT64_MAX};
+    std::atomic<uint64_t> maximum{0};
+};
+
+// Records the time from construction to destruction
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { histogram.recordSince(start); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Named counters, gauges and histograms. Lookups lock, so callers look a
+// metric up once and keep the reference; references stay valid for the
+// registry's lifetime. snapshot() renders everything as one JSON object.
+class MetricsRegistry {
+public:
+    MetricsRegistry() = default;
+    // Stops the dump thread
+    ~MetricsRegistry();
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    Counter& counter(const std::string& name);
+    Gauge& gauge(const std::string& name);
+    Histogram& histogram(const std::string& name);
+    // Gauge read by calling `sample` at snapshot time. The callback must
+    // stay callable until stopDump() (or the registry's destruction).
+    void gauge(const std::string& name, std::function<double()> sample);
+
+    // {"counters":{...},"gauges":{...},"histograms":{"name":{"count":N,
+    // "mean_us":..,"min_us":..,"p50_us":..,"p99_us":..,"p999_us":..,
+    // "max_us":..}}} with names sorted
+    std::string snapshot() const;
+
+    // Rewrites `path` with a snapshot every `interval` (via a temp file and
+    // rename, so readers never see a partial file) until stopDump(), which
+    // writes a final one
+    void startDump(const std::string& path, std::chrono::milliseconds interval);
+    void stopDump();
+    bool writeSnapshot(const std::string& path) const;
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::function<double()>> sampledGauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+
+    std::mutex dumpMutex;
+    std::condition_variable dumpCv;
+    std::thread dumpThread;
+    bool dumping = false;
+};
+
+#endif
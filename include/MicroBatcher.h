@@ -0,0 +1,82 @@
+#ifndef MICROBATCHER_H
+#define MICROBATCHER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Scheduler.h"
+#include "Tensor.h"
+
+struct BatchOptions {
+    // Rows (leading-axis entries) per batch; a batch is dispatched as soon
+    // as it reaches this, or before a request that would take it past it.
+    // A single larger request runs on its own.
+    size_t maxBatchRows = 64;
+    // Longest a request waits for others before its batch is dispatched
+    std::chrono::microseconds maxWait{1000};
+};
+
+struct BatchStats {
+    uint64_t requests = 0;
+    uint64_t batches = 0;
+};
+
+// Merges requests into batched tensors in front of a Scheduler. Requests
+// with the same dtype and trailing shape (everything after the leading
+// axis) are concatenated along the leading axis, run as one COMPUTE task,
+// and each request gets its rows of the result back as a zero-copy slice.
+// Rank-0 requests count as one row and get their row back without the
+// leading axis.
+class MicroBatcher {
+public:
+    // Runs a batch; `rows` holds each request's leading-axis size in order.
+    // Must return a tensor with the batch's leading-axis size.
+    using BatchWork = std::function<Tensor(const Tensor& batch, const std::vector<size_t>& rows)>;
+
+    MicroBatcher(Scheduler& scheduler, BatchWork work, const BatchOptions& options = BatchOptions());
+    // Dispatches whatever is still waiting
+    ~MicroBatcher();
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+    // The future holds this request's rows of the result, or the exception
+    // the batch failed with (including the Scheduler rejecting it)
+    std::future<Tensor> submit(const Tensor& request);
+    // Dispatches every waiting batch now
+    void flush();
+
+    void setOptions(const BatchOptions& options);
+    BatchStats stats() const;
+
+private:
+    struct Pending {
+        std::vector<Tensor> requests;
+        std::vector<std::promise<Tensor>> results;
+        std::vector<bool> scalars; // request was rank-0
+        size_t rows = 0;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    using Key = std::pair<DType, std::vector<size_t>>;
+
+    Scheduler& scheduler;
+    BatchWork work;
+    BatchOptions options;
+    mutable std::mutex mutex; // guards everything below and options
+    std::condition_variable wake;
+    std::map<Key, Pending> pending;
+    BatchStats counts;
+    bool stopping = false;
+    std::thread timer; // dispatches batches whose oldest request hit maxWait
+
+    void timerLoop();
+    void dispatch(Pending batch);
+};
+
+#endif
@@ -1,27 +1,62 @@
 #ifndef NODE_H
 #define NODE_H
 
+#include <chrono>
 #include <string>
 #include <thread>
+#include "Metrics.h"
+#include "MicroBatcher.h"
 #include "Scheduler.h"
 #include "Tensor.h"
 #include "KVStore.h"
+#include "Reactor.h"
+#include "PeerPool.h"
+#include "Communicator.h"
 #include <vector>
 #include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
 
 class Node {
 public:
-    Node(int port, size_t numThreads, int nodeId = 0);
+    // With a snapshotPath the whole store is restored from it at startup
+    // and saved back at shutdown; give each Node in a process its own path.
+    // Empty (the default) keeps the Node's store out of any snapshot.
+    Node(int port, size_t numThreads, int nodeId = 0, const std::string& snapshotPath = "");
     ~Node();
 
-    void startServer();
+    // Uses the epoll Reactor unless options.useEventLoop is false or the
+    // platform lacks epoll, in which case each connection gets a thread
+    void startServer(const ServerOptions& options = ServerOptions());
     void sendTask(const std::string& message);
     void broadcastTensor(const Tensor& tensor);
     Tensor receiveTensor();
-    // Broadcast tensor to multiple destination ports
-    void broadcastTensor(const Tensor& tensor, const std::vector<int>& destPorts);
+    // Broadcast tensor to multiple destination ports, in `encoding` unless
+    // a port has its own (setPeerEncoding)
+    void broadcastTensor(const Tensor& tensor, const std::vector<int>& destPorts,
+                         WireEncoding encoding = WireEncoding::FLOAT32);
+    void setPeerEncoding(int port, WireEncoding encoding);
     // Send tensor to a specific destination port (RPC-ready) - removed; use broadcast overload
 
+    // Join a group of worldSize nodes for collectives (Communicator.h).
+    // Blocks until every rank has joined; throws std::runtime_error on failure.
+    void joinCollectives(int rank, int worldSize, int basePort, const CommOptions& options = CommOptions());
+    // The group joined above; throws if joinCollectives() has not been called
+    Communicator& collectives();
+
+    // Received tensors are batched before they reach the Scheduler
+    // (MicroBatcher.h)
+    void setBatchOptions(const BatchOptions& options);
+
+    // Per-stage latency histograms (node.*, scheduler.*, kvstore.*),
+    // counters and gauges; snapshot() for p50/p99/p999 of each stage
+    MetricsRegistry& metrics();
+    // Rewrites `path` with a metrics snapshot every `interval` until the
+    // Node is destroyed
+    void startMetricsDump(const std::string& path,
+                          std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
 private:
     int port;
     int serverSocket;
@@ -29,15 +64,56 @@ private:
     std::mutex clientsMutex;
     // Track connected client sockets
     std::vector<int> clientSockets;
+    // Running handleClient() threads; ~Node shuts their sockets down and
+    // waits for this to reach zero. Guarded by clientsMutex.
+    size_t clientHandlers = 0;
+    std::condition_variable handlersDone;
     int nodeId;
-    bool running;
+    std::string snapshotPath;
+    // ServerOptions::maxFrameBytes of startServer(); also bounds tensors on
+    // the thread-per-connection path
+    uint64_t maxReceiveBytes = ServerOptions().maxFrameBytes;
+    std::atomic<bool> running;
+    // Built before everything that records into it
+    MetricsRegistry metricsRegistry;
+    // Node's own stages, looked up once
+    struct Stages {
+        explicit Stages(MetricsRegistry& registry);
+        Histogram& receive;     // read and decode one tensor (thread-per-connection)
+        Histogram& deserialize; // decode one Reactor frame
+        Histogram& submit;      // hand a tensor to the batcher
+        Histogram& put;         // KVStore::put of a batch result
+        Histogram& scheduleSave;
+        Counter& tensors;
+        Counter& bytes;
+        Counter& malformed;
+        Counter& batches;        // batches run by runBatch
+        Counter& batchedTensors; // tensors in them
+    };
+    Stages stages;
     std::thread serverThread;
+    std::unique_ptr<Reactor> reactor;
 
-    Scheduler scheduler;
+    // Declared before the scheduler: queued batches write to it
     KVStore kvStore;
+    Scheduler scheduler;
+    // Between ingestTensor() and the scheduler. ~Node flushes it and
+    // drains the scheduler, so no batch runs once members are destroyed.
+    MicroBatcher batcher;
+    // Long-lived outgoing connections used by broadcastTensor(tensor, ports)
+    PeerPool peers;
+    std::unique_ptr<Communicator> communicator;
 
+    int openListenSocket(int backlog);
     void serverLoop();
     void handleClient(int clientSocket);
+    // Reactor callbacks
+    void handleFrame(std::shared_ptr<std::vector<char>> payload);
+    void trackClient(int clientSocket, bool open);
+    // Queue a received tensor for the next batch
+    void ingestTensor(const Tensor& received);
+    // Compute task for one batch of received tensors
+    Tensor runBatch(const Tensor& batch, const std::vector<size_t>& rows);
     // Receive a tensor from a specific connected socket
     Tensor receiveTensor(int clientSocket);
     // Broadcast a tensor to all currently connected peers
@@ -0,0 +1,92 @@
+#ifndef PEERPOOL_H
+#define PEERPOOL_H
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <sys/uio.h>
+#include "Tensor.h"
+#include "TensorWire.h"
+
+struct PeerOptions {
+    bool noDelay = true;
+    // Socket buffer sizes; 0 keeps the kernel default
+    int sendBufferBytes = 4 << 20;
+    int recvBufferBytes = 0;
+    // Reconnect backoff, doubled after each failed attempt
+    std::chrono::milliseconds initialBackoff{10};
+    std::chrono::milliseconds maxBackoff{2000};
+    // Tensors with at least this much data go out as chunked streams
+    // (TensorWire.h); 0 always sends plain frames
+    uint64_t streamThresholdBytes = 8 << 20;
+    size_t streamChunkBytes = DEFAULT_STREAM_CHUNK;
+    // A peer that accepts no data for this long during a broadcast is
+    // reported failed and disconnected (a partial frame leaves the stream
+    // unusable); slow peers that keep reading are never cut off. 0 waits
+    // indefinitely.
+    std::chrono::milliseconds stallTimeout{5000};
+};
+
+// Long-lived connections to peer nodes on the loopback interface, one per
+// destination port. Connections are opened on first use, checked for a
+// closed peer before every send and re-established with exponential
+// backoff. A broadcast writes to every peer at once from one poll loop, so
+// its latency is that of the slowest peer rather than the sum of them.
+//
+// Data goes out in the encoding of the broadcast's WireHeader unless the
+// peer has its own (setEncoding), e.g. bfloat16 to a node that only needs
+// activations. Each encoding in use is produced once per broadcast, as a
+// full encoded copy of the tensor (half its size for float16/bfloat16,
+// about 28% for qint8) that every peer's writes share. That copy is a
+// deliberate trade-off: peers advance at their own pace from one poll
+// loop, so encoding chunk by chunk would mean re-encoding for each peer or
+// holding chunks until the slowest had sent them. Float32 data is never
+// copied.
+class PeerPool {
+public:
+    explicit PeerPool(const PeerOptions& options = PeerOptions());
+    ~PeerPool();
+    PeerPool(const PeerPool&) = delete;
+    PeerPool& operator=(const PeerPool&) = delete;
+
+    // Sends one framed tensor to every port; returns the ports it could
+    // not be delivered to (connect failed, in backoff, send failed or
+    // stalled)
+    std::vector<int> broadcast(const WireHeader& header, const Tensor& tensor, const std::vector<int>& ports);
+
+    // Number of currently open connections
+    size_t connectedCount() const;
+
+    // Per-peer wire encoding, overriding the one each broadcast asks for
+    void setEncoding(int port, WireEncoding encoding);
+    void clearEncoding(int port);
+
+private:
+    struct Peer {
+        int fd = -1;
+        std::chrono::milliseconds backoff{0};
+        std::chrono::steady_clock::time_point nextAttempt;
+        bool hasEncoding = false;
+        WireEncoding encoding = WireEncoding::FLOAT32;
+    };
+
+    // One encoding of the broadcast tensor as a gather list shared by every
+    // peer receiving it
+    struct Frame {
+        WireHeader header;
+        std::vector<char> encoded; // reduced-precision data
+        std::vector<char> chunkHeaders;
+        std::vector<struct iovec> iov;
+    };
+
+    PeerOptions options;
+    mutable std::mutex mutex; // one broadcast at a time; guards peers
+    std::unordered_map<int, Peer> peers;
+
+    int acquire(int port, Peer& peer);
+    void fail(Peer& peer);
+    void buildFrame(Frame& frame, const Tensor& tensor) const;
+};
+
+#endif
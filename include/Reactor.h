@@ -0,0 +1,78 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+struct ServerOptions {
+    int backlog = 1024;
+    // Event loop threads; each owns the connections it accepts
+    size_t ioThreads = 1;
+    // Frames announcing a larger payload close the connection
+    uint64_t maxFrameBytes = uint64_t(256) << 20;
+    // Cap on partly received frames across all connections. A frame's
+    // buffer grows as its bytes arrive; a connection whose growth would
+    // pass this cap is closed.
+    uint64_t maxBufferedBytes = uint64_t(1) << 30;
+    // false keeps the blocking accept + thread-per-connection server
+    bool useEventLoop = true;
+};
+
+// Edge-triggered epoll server. Every I/O thread waits on its own epoll set
+// holding the shared listening socket, the connections it accepted and an
+// eventfd used to stop it. Connections are non-blocking and read frames
+// (8-byte big-endian length, then payload) incrementally, so a slow or
+// partial sender never ties up a thread. Streamed tensor frames
+// (TensorWire.h) are reassembled in place and delivered like plain ones.
+class Reactor {
+public:
+    // Called on the I/O thread with the payload of each completed frame;
+    // keep it short and push real work to a pool.
+    using FrameHandler = std::function<void(int fd, std::shared_ptr<std::vector<char>> payload)>;
+    // Called on the I/O thread when a connection is accepted (true) or
+    // about to be closed (false)
+    using ConnectionHandler = std::function<void(int fd, bool open)>;
+
+    Reactor(const ServerOptions& options, FrameHandler onFrame, ConnectionHandler onConnection = nullptr);
+    ~Reactor();
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // listenFd must already be listening; it is switched to non-blocking.
+    // Returns false if epoll is unavailable or setup fails.
+    bool start(int listenFd);
+    // Wakes every I/O thread, joins them and closes their connections.
+    // The listening socket is left to the caller.
+    void stop();
+
+    // False on platforms without epoll/eventfd
+    static bool supported();
+
+private:
+    struct Loop;
+    struct Connection;
+
+    ServerOptions options;
+    FrameHandler onFrame;
+    ConnectionHandler onConnection;
+    int listenFd = -1;
+    std::vector<std::unique_ptr<Loop>> loops;
+    // Capacity of the frame buffers held by all connections
+    std::atomic<uint64_t> buffered{0};
+
+    void run(Loop& loop);
+    void acceptAll(Loop& loop);
+    bool readFrames(Loop& loop, int fd);
+    bool prepareRead(Connection& conn);
+    bool grow(Connection& conn, size_t bytes);
+    void releaseBuffer(Connection& conn);
+    bool consume(Connection& conn, int fd, size_t n);
+    void deliver(Connection& conn, int fd);
+    void closeConnection(Loop& loop, int fd);
+};
+
+#endif
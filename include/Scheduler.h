@@ -1,18 +1,110 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
-#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Metrics.h"
 #include "Task.h"
 
+struct SchedulerOptions {
+    size_t computeThreads = 4;
+    // Blocking disk/network work gets its own threads so it never holds up
+    // compute
+    size_t ioThreads = 2;
+    // Tasks allowed to wait in each lane; 0 is unbounded
+    size_t maxQueuedCompute = 0;
+    size_t maxQueuedIo = 0;
+    // When a lane is full, submitTask() blocks until there is room (true)
+    // or returns false at once (false)
+    bool blockWhenFull = false;
+    // If set, each lane records how long tasks waited and ran into
+    // scheduler.<compute|io>.queue_wait and .execute histograms. The
+    // registry must outlive the Scheduler.
+    MetricsRegistry* metrics = nullptr;
+};
+
+struct SchedulerStats {
+    size_t queued = 0; // waiting now
+    size_t running = 0; // workers inside a task now
+    uint64_t completed = 0; // work ran (including ones that threw)
+    uint64_t rejected = 0; // lane was full
+    uint64_t expired = 0; // dropped at their deadline
+};
+
+// Runs Tasks on two independent lanes of worker threads, one per TaskType,
+// so a slow checkpoint write never sits in front of compute. Each lane
+// runs its queue in priority order, then earliest deadline, then
+// submission order.
 class Scheduler {
 public:
+    // numThreads compute threads and the default IO lane
     Scheduler(size_t numThreads);
+    explicit Scheduler(const SchedulerOptions& options);
+    // Runs or expires everything still queued, then joins the workers
     ~Scheduler();
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
 
-    void submitTask(const Task& task);
+    // False if the task's lane is full and blockWhenFull is off (the
+    // caller's signal to shed or retry), or after shutdown began
+    bool submitTask(const Task& task);
+
+    SchedulerStats stats(TaskType type) const;
+
+    // Blocks until both lanes are empty and idle, including tasks that
+    // running tasks submit meanwhile. Submitting keeps working.
+    void drain();
 
 private:
-    ThreadPool threadPool;
+    struct Entry {
+        Task task;
+        uint64_t sequence;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+    // Heap order of Lane::queue: its front is the entry to run next
+    struct RunsLater {
+        bool operator()(const std::shared_ptr<Entry>& a, const std::shared_ptr<Entry>& b) const;
+    };
+    struct Lane {
+        size_t maxQueued = 0;
+        mutable std::mutex mutex;
+        std::condition_variable ready; // work or shutdown for workers
+        std::condition_variable space; // room for blocked submitters
+        std::condition_variable idle;  // queue empty and no task running
+        std::vector<std::shared_ptr<Entry>> queue; // heap ordered by RunsLater
+        // Taken out of `queue` past their deadline; workers report these first
+        std::deque<std::shared_ptr<Entry>> expired;
+        // No entry in `queue` has an earlier deadline (it may be stale)
+        std::chrono::steady_clock::time_point earliestDeadline = std::chrono::steady_clock::time_point::max();
+        SchedulerStats stats;
+        Histogram* queueWait = nullptr;
+        Histogram* execute = nullptr;
+        bool stop = false;
+        std::vector<std::thread> workers;
+    };
+
+    SchedulerOptions options;
+    Lane compute;
+    Lane io;
+    std::atomic<uint64_t> nextSequence{0};
+
+    Lane& laneFor(TaskType type);
+    const Lane& laneFor(TaskType type) const;
+    void startLane(Lane& lane, const char* name, size_t threads, size_t maxQueued);
+    void stopLane(Lane& lane);
+    // True if the lane was already idle, i.e. did not have to wait
+    bool waitIdle(Lane& lane);
+    // Moves entries past their deadline from `queue` to `expired` and
+    // returns how many; call with the lane's mutex held
+    size_t purgeExpired(Lane& lane, std::chrono::steady_clock::time_point now);
+    void workerLoop(Lane& lane);
 };
 
 #endif
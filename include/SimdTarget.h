@@ -0,0 +1,31 @@
+#ifndef SIMDTARGET_H
+#define SIMDTARGET_H
+
+// Helpers for compiling ISA-specific code paths in an otherwise portable
+// translation unit. Functions defined between SIMD_TARGET_BEGIN(...) and
+// SIMD_TARGET_END are built for that instruction set and must only be called
+// after a runtime CPU check (see kernels::detectedSimdLevel()).
+//
+// Keep standard library includes *outside* these regions: inline library
+// functions instantiated inside would be compiled for the wider ISA and could
+// be picked by the linker for callers running on older CPUs.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define SIMD_X86 1
+#endif
+
+#define SIMD_PRAGMA(x) _Pragma(#x)
+
+#if defined(__clang__)
+#define SIMD_TARGET_BEGIN(isa) \
+    SIMD_PRAGMA(clang attribute push(__attribute__((target(isa))), apply_to = function))
+#define SIMD_TARGET_END SIMD_PRAGMA(clang attribute pop)
+#elif defined(__GNUC__)
+#define SIMD_TARGET_BEGIN(isa) SIMD_PRAGMA(GCC push_options) SIMD_PRAGMA(GCC target(isa))
+#define SIMD_TARGET_END SIMD_PRAGMA(GCC pop_options)
+#else
+#define SIMD_TARGET_BEGIN(isa)
+#define SIMD_TARGET_END
+#endif
+
+#endif
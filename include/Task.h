@@ -1,20 +1,40 @@
 #ifndef TASK_H
 #define TASK_H
 
+#include <chrono>
 #include <functional>
 #include <string>
 #include "Tensor.h"
 
+// Which Scheduler lane runs the task: COMPUTE for CPU-bound work, IO for
+// work that blocks on disk or network
 enum class TaskType {
     COMPUTE,
     IO
 };
 
+// Within a lane, higher priorities run first
+enum class TaskPriority {
+    LOW,
+    NORMAL,
+    HIGH,
+    INTERACTIVE
+};
+
 struct Task {
-    TaskType type;
+    TaskType type = TaskType::COMPUTE;
     std::string name;
     Tensor tensor;
     std::function<void(const Tensor&)> work;
+
+    TaskPriority priority = TaskPriority::NORMAL;
+    // A task still queued at its deadline is dropped: `work` never runs and
+    // `onExpired` (if set) is called instead, on its lane's next free
+    // worker whatever the priority. A dropped task no longer counts against
+    // the lane's queue limit. Among equal priorities the earliest deadline
+    // runs first. No deadline by default.
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    std::function<void()> onExpired;
 };
 
 #endif
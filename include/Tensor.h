@@ -4,23 +4,159 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <memory>
+#include "DType.h"
+#include "TensorStorage.h"
+#include "WireEncoding.h"
 
+class ThreadPool;
+
+// How the data after a TENS header is stored. The dtype byte names either a
+// DType (data stored as is) or, when the next byte is FLOAT32, the
+// WireEncoding of float32 data.
+struct BinaryFormat {
+    DType dtype = DType::FLOAT32; // of the decoded tensor
+    WireEncoding encoding = WireEncoding::FLOAT32; // FLOAT32: stored as dtype
+    uint64_t dataBytes(uint64_t nelems) const;
+};
+
+// Dense tensor with value semantics, float32 unless created with another
+// DType. Copies share the underlying TensorStorage until one of them is
+// written through a non-const accessor (operator[], dataPtr(), rawData()),
+// at which point the writer takes a private copy. Do not hold a mutable
+// pointer across a copy of the same tensor.
+//
+// A tensor is a strided view of its storage: an element offset plus a
+// stride per axis. reshape, slice, transpose/permute and broadcastTo return
+// views that share the storage without copying; like any copy, a view is
+// packed into private contiguous storage by the first non-const access.
 class Tensor {
 public:
     Tensor();
-    Tensor(const std::vector<size_t>& shape);
+    // Zero-filled
+    Tensor(const std::vector<size_t>& shape, DType dtype = DType::FLOAT32);
+    // Contents unspecified; for results that are about to be overwritten in
+    // full. Skips the zero-fill (Tensor storage comes from BufferPool.h).
+    static Tensor uninitialized(const std::vector<size_t>& shape, DType dtype = DType::FLOAT32);
+    // Like uninitialized(), but over `buffer`'s storage when it is private,
+    // writable and large enough, so a planner can pass one allocation from
+    // tensor to tensor
+    static Tensor reuse(Tensor&& buffer, const std::vector<size_t>& shape, DType dtype = DType::FLOAT32);
 
+    // float32 tensors only; throws std::runtime_error otherwise. Indexes
+    // elements in row-major order of the shape, whatever the strides.
+    // The non-const overload is inline for private, packed float32 storage
+    // and goes through dataPtr(), detaching first, otherwise; loops over
+    // many elements should still take dataPtr() once.
     float& operator[](size_t index);
     const float& operator[](size_t index) const;
 
     const std::vector<size_t>& getShape() const;
     size_t size() const;
+    DType dtype() const;
+    size_t nbytes() const; // size() * dtypeSize(dtype())
+
+    // Contiguous float storage (size() floats). Throws std::runtime_error
+    // for other dtypes. The non-const overload detaches shared or
+    // read-only storage and packs views first; the const one throws for a
+    // view that is not contiguous (see contiguous()).
+    float* dataPtr();
+    const float* dataPtr() const;
+
+    // Contiguous storage of any dtype (nbytes() bytes), detached like
+    // dataPtr()
+    void* rawData();
+    const void* rawData() const;
+
+    // Copies elements [first, first + count), in row-major order, to `out`
+    // as dtype() values; works for any view
+    void gather(size_t first, size_t count, void* out) const;
+
+    // Element strides per axis; 0 along broadcast axes
+    const std::vector<size_t>& getStrides() const;
+    // True if the elements are packed in row-major order, so dataPtr() and
+    // rawData() can be read directly
+    bool isContiguous() const;
+    // This tensor if contiguous, else a packed copy
+    Tensor contiguous() const;
+
+    // Views. All throw std::runtime_error on invalid arguments.
+    // Same elements in a new shape; copies when this view is not contiguous
+    Tensor reshape(const std::vector<size_t>& shape) const;
+    // Indices start, start + step, ... below end along `axis`
+    Tensor slice(size_t axis, size_t start, size_t end, size_t step = 1) const;
+    Tensor transpose(size_t axis0, size_t axis1) const;
+    // Axis i of the result is axis order[i] of this tensor
+    Tensor permute(const std::vector<size_t>& order) const;
+    // NumPy broadcasting: size-1 and missing leading axes repeat (stride 0)
+    Tensor broadcastTo(const std::vector<size_t>& shape) const;
+
+    // Converts to another dtype (see DType.h for rounding); the same dtype
+    // returns a copy sharing storage
+    Tensor cast(DType dtype) const;
 
-    // Serialize tensor to bytes (shape followed by raw float data)
-    std::vector<char> serializeBinary() const;
+    // True while the data still lives in borrowed read-only memory (e.g. a
+    // mapped checkpoint) and has not been copied by a write
+    bool isReadOnlyView() const;
 
-    // Reconstruct tensor from bytes produced by serializeBinary()
+    // Vectorized math backed by Kernels.h. Binary operations take operands
+    // with the same number of elements, or that broadcast to this shape,
+    // and throw std::runtime_error otherwise; results are contiguous and
+    // take this tensor's shape and dtype. Other dtypes and non-contiguous
+    // views are gathered into float32 a block at a time, so they compute
+    // with float32 precision but no full-size copy. Given a `pool`, large
+    // tensors are split into chunks across its workers and the calling
+    // thread (ThreadPool::parallel_for); reductions then combine per-chunk
+    // results in a fixed order, so they are deterministic for any pool.
+    Tensor add(const Tensor& other, ThreadPool* pool = nullptr) const;
+    Tensor mul(const Tensor& other, ThreadPool* pool = nullptr) const;
+    Tensor scale(float factor, ThreadPool* pool = nullptr) const;
+    Tensor fma(const Tensor& b, const Tensor& c, ThreadPool* pool = nullptr) const; // this * b + c
+    Tensor relu(ThreadPool* pool = nullptr) const;
+    Tensor gelu(ThreadPool* pool = nullptr) const;
+    float sum(ThreadPool* pool = nullptr) const;
+    float max(ThreadPool* pool = nullptr) const; // -infinity for an empty tensor
+    float mean(ThreadPool* pool = nullptr) const; // 0 for an empty tensor
+    float dot(const Tensor& other, ThreadPool* pool = nullptr) const;
+
+    // Matrix product via sgemm (MatMul.h): [M,K] x [K,N] -> [M,N],
+    // [B,M,K] x [B,K,N] -> [B,M,N], or [B,M,K] x [K,N] with a shared right
+    // operand. Large products are split across `pool` when given. Views
+    // with unit-stride rows are read in place; other views and dtypes are
+    // packed into float32 first. The result is float32.
+    Tensor matmul(const Tensor& other, ThreadPool* pool = nullptr) const;
+
+    // Serialize tensor to bytes (shape followed by the data in the tensor's
+    // dtype). A float32 tensor can instead be sent in a reduced-precision
+    // encoding (WireEncoding.h); other dtypes ignore `encoding`.
+    std::vector<char> serializeBinary(WireEncoding encoding = WireEncoding::FLOAT32) const;
+
+    // Reconstruct tensor from bytes produced by serializeBinary(), in its
+    // original dtype; encoded float32 data is decoded back to float32
     static Tensor deserializeBinary(const std::vector<char>& bytes);
+    static Tensor deserializeBinary(const char* bytes, size_t len);
+
+    // Like deserializeBinary() but without copying the data: the tensor
+    // points into `bytes`, which `owner` must keep alive (e.g. a MappedFile).
+    // The first write copies the data into private storage. Encoded data is
+    // decoded into a new tensor instead.
+    static Tensor viewBinary(std::shared_ptr<const void> owner, const char* bytes, size_t len);
+
+    // Largest rank the binary format accepts (bounds the header size)
+    static constexpr size_t MAX_DIMS = 16;
+
+    // The binary header alone (everything before the data), so callers
+    // can send it next to dataPtr() without building a full copy.
+    size_t binaryHeaderSize() const;
+    size_t writeBinaryHeader(char* out, WireEncoding encoding = WireEncoding::FLOAT32) const; // returns bytes written
+
+    // Parse a header from the start of `bytes`. Returns the header length,
+    // or 0 if more bytes are needed; throws std::runtime_error if invalid.
+    // Without `format` only plain float32 data is accepted; with it, any
+    // dtype or encoding is and is reported there.
+    static size_t parseBinaryHeader(const char* bytes, size_t len,
+                                    std::vector<size_t>& shape, uint64_t& nelems,
+                                    BinaryFormat* format = nullptr);
 
     // Text-based serialization helpers (human-readable)
     std::string serialize() const;
@@ -28,7 +164,29 @@ public:
 
 private:
     std::vector<size_t> shape;
-    std::vector<float> data;
+    std::vector<size_t> strides; // in elements
+    size_t storageOffset = 0; // of the first element, in elements
+    std::shared_ptr<TensorStorage> storage;
+    size_t numel = 0;
+    DType type = DType::FLOAT32;
+    bool packed = true; // row-major strides (see isContiguous())
+
+    // Make `storage` private, writable and packed before handing out
+    // mutable access
+    void detach();
+    // operator[] when the inline fast path does not apply
+    float& mutableElement(size_t index);
+    // Start of the view's data, whatever its layout
+    char* base() const;
+    // Recomputes numel and packed after a view changes shape or strides
+    void refreshLayout();
 };
 
+inline float& Tensor::operator[](size_t index) {
+    if (type == DType::FLOAT32 && packed && storage && storage->writable() && storage.use_count() == 1) {
+        return static_cast<float*>(storage->data())[storageOffset + index];
+    }
+    return mutableElement(index);
+}
+
 #endif
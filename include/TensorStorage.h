@@ -0,0 +1,41 @@
+#ifndef TENSORSTORAGE_H
+#define TENSORSTORAGE_H
+
+#include <cstddef>
+#include <memory>
+
+// Reference-counted backing memory for Tensor data. A storage is either a
+// 64-byte-aligned block from the BufferPool, returned to it when the
+// storage dies, or a read-only window into memory kept alive by another
+// object (for example a memory-mapped checkpoint). Tensors share storages
+// on copy and only duplicate them on first write.
+class TensorStorage {
+public:
+    // Zero-filled pooled block
+    static std::shared_ptr<TensorStorage> allocate(size_t bytes);
+    // Pooled block with unspecified contents, for data about to be
+    // overwritten in full
+    static std::shared_ptr<TensorStorage> allocateUninitialized(size_t bytes);
+
+    // Read-only view of `bytes` at `data`; `owner` keeps that memory valid
+    static std::shared_ptr<TensorStorage> wrapReadOnly(std::shared_ptr<const void> owner,
+                                                       const void* data, size_t bytes);
+
+    ~TensorStorage();
+    TensorStorage(const TensorStorage&) = delete;
+    TensorStorage& operator=(const TensorStorage&) = delete;
+
+    void* data() const { return ptr; }
+    size_t bytes() const { return size; }
+    bool writable() const { return ownsMemory; }
+
+private:
+    TensorStorage() = default;
+
+    void* ptr = nullptr;
+    size_t size = 0;
+    bool ownsMemory = false;
+    std::shared_ptr<const void> owner;
+};
+
+#endif
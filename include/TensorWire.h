@@ -0,0 +1,102 @@
+#ifndef TENSORWIRE_H
+#define TENSORWIRE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Tensor.h"
+
+// Framed tensor transport over a connected socket:
+//   8-byte big-endian payload length, then a TENS payload (Tensor.h).
+// Sends gather the frame header from a small stack buffer and the float data
+// straight from the tensor's storage; receives land directly in the new
+// tensor's storage, so a payload is never staged in an intermediate buffer.
+//
+// Streamed frames set the top bit of the length prefix; the remaining bits
+// give the size of the TENS header that follows. The float data then comes
+// as chunks, each with a 16-byte header:
+//   'CHNK', u32 chunk length, u64 byte offset into the data (little-endian)
+// Chunks arrive in order, so a receiver can consume (reduce, checkpoint)
+// the start of a tensor while the rest is still in flight.
+//
+// Tensors travel in their own dtype. Float32 data may instead be encoded
+// in reduced precision (WireEncoding.h); the TENS header says which, and
+// receivers decode it back to float32.
+// The functions here stage encoded data in bounded pieces (one chunk, or
+// DEFAULT_STREAM_CHUNK for plain frames), never a full copy, and chunks of
+// an encoded stream hold whole encoding units. PeerPool broadcasts are the
+// exception: they encode the whole tensor once per encoding (PeerPool.h).
+
+constexpr size_t MAX_WIRE_HEADER = 8 + 16 + Tensor::MAX_DIMS * 8 + 8;
+
+// Length prefix + TENS header for one tensor. Encode once and reuse it when
+// the same tensor goes to several destinations.
+struct WireHeader {
+    char bytes[MAX_WIRE_HEADER];
+    size_t size = 0;
+    uint64_t payloadSize = 0; // TENS header + data bytes
+    WireEncoding encoding = WireEncoding::FLOAT32;
+};
+
+WireHeader encodeWireHeader(const Tensor& tensor, WireEncoding encoding = WireEncoding::FLOAT32);
+
+constexpr uint64_t STREAM_FLAG = uint64_t(1) << 63;
+constexpr size_t CHUNK_HEADER_SIZE = 16;
+constexpr size_t DEFAULT_STREAM_CHUNK = 1 << 20;
+// Receivers reject larger chunks, bounding what a streaming consumer buffers
+constexpr size_t MAX_CHUNK_BYTES = 64 << 20;
+// Receivers reject tensors with more data than this before allocating; a
+// default for trusted links, far above what a server should accept
+constexpr uint64_t DEFAULT_MAX_TENSOR_BYTES = uint64_t(16) << 30;
+
+// Returns false if the connection failed before the whole frame was written
+bool sendTensor(int sock, const Tensor& tensor, WireEncoding encoding = WireEncoding::FLOAT32);
+bool sendTensor(int sock, const WireHeader& header, const Tensor& tensor);
+
+// Frame an arbitrary payload with the same length prefix
+bool sendFrame(int sock, const void* payload, size_t len);
+
+// Streamed send: header, then the data in chunks of at most chunkBytes
+// (rounded down to whole encoding units)
+bool sendTensorStream(int sock, const Tensor& tensor, size_t chunkBytes = DEFAULT_STREAM_CHUNK,
+                      WireEncoding encoding = WireEncoding::FLOAT32);
+
+// Called after each chunk of the destination tensor has landed; [offset,
+// offset + bytes) of dest's data is final. Frames that are neither streamed
+// nor encoded report one chunk.
+using ChunkSink = std::function<void(const Tensor& dest, uint64_t offset, size_t bytes)>;
+
+// Receives a plain or streamed frame. Throws std::runtime_error on EOF,
+// socket errors, malformed frames or tensors over maxTensorBytes. The
+// destination tensor is allocated, uninitialised, once the header has
+// passed that check, so maxTensorBytes is what one call may reserve: pass
+// a limit sized for the peer, not the default, on untrusted connections.
+Tensor recvTensor(int sock, uint64_t maxTensorBytes = DEFAULT_MAX_TENSOR_BYTES,
+                  const ChunkSink& onChunk = nullptr);
+
+// Consumes a streamed frame without materializing the tensor: each chunk is
+// read (and decoded) into one reusable buffer and handed to onChunk as
+// data in the dtype reported by onHeader, at a byte offset, so memory use
+// is bounded by the chunk size however large the tensor is.
+struct StreamSink {
+    std::function<void(const std::vector<size_t>& shape, DType dtype)> onHeader;
+    std::function<void(uint64_t offset, const char* data, size_t bytes)> onChunk;
+};
+void recvTensorStream(int sock, const StreamSink& sink, uint64_t maxTensorBytes = DEFAULT_MAX_TENSOR_BYTES);
+
+void encodeChunkHeader(uint64_t offset, uint32_t len, char out[CHUNK_HEADER_SIZE]);
+// False if the magic is wrong
+bool decodeChunkHeader(const char in[CHUNK_HEADER_SIZE], uint64_t& offset, uint32_t& len);
+// Chunk headers for a whole stream, CHUNK_HEADER_SIZE bytes per chunk.
+// Chunks are cut on multiples of unitBytes.
+std::vector<char> encodeChunkHeaders(uint64_t dataBytes, size_t chunkBytes, size_t unitBytes = 1);
+
+// Blocking helpers that retry on partial transfers and EINTR
+bool sendAll(int sock, const void* data, size_t len);
+bool readFull(int sock, void* data, size_t len);
+
+void encodeLengthPrefix(uint64_t len, char out[8]);
+uint64_t decodeLengthPrefix(const char in[8]);
+
+#endif
@@ -4,27 +4,111 @@
 #include <vector>
 #include <thread>
 #include <queue>
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
 #include <cstddef>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+// SHARED_QUEUE: every task goes through one FIFO queue (original behaviour).
+// WORK_STEALING: each worker owns a deque; tasks submitted from a worker go
+// onto its own deque (LIFO for locality) and idle workers steal from the
+// front of the others. Tasks from outside the pool use the shared queue.
+enum class PoolMode {
+    SHARED_QUEUE,
+    WORK_STEALING
+};
 
 class ThreadPool {
 public:
-    explicit ThreadPool(size_t numThreads);
+    explicit ThreadPool(size_t numThreads, PoolMode mode = PoolMode::SHARED_QUEUE);
     ~ThreadPool();
 
     void enqueue(std::function<void()> task);
 
+    // Enqueue a callable and get a future for its result (or exception).
+    // Do not block on the future from inside a worker of the same pool
+    // unless other workers are free to run it.
+    template <typename F>
+    auto submit(F&& f) -> std::future<typename std::invoke_result<F>::type> {
+        using R = typename std::invoke_result<F>::type;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> result = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return result;
+    }
+
+    // Runs body(begin, end) over consecutive chunks covering [first, last)
+    // on the workers and the calling thread, and returns once all chunks
+    // have run. Chunks are at least `grain` indices and grow with the range
+    // so there are at most MAX_CHUNKS of them. The caller claims chunks too,
+    // so this is safe (and makes progress) from inside one of the pool's
+    // workers. The first exception thrown is rethrown here.
+    void parallel_for(size_t first, size_t last, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+    // Folds map(begin, end) -> T over the same chunks as parallel_for and
+    // combines the partial results left to right in chunk order. Chunk
+    // boundaries depend only on the range and grain, so the result is the
+    // same on any pool (floating-point sums included) and from run to run.
+    template <typename T, typename Map, typename Combine>
+    T parallel_reduce(size_t first, size_t last, size_t grain, T identity, Map map, Combine combine) {
+        if (last <= first) return identity;
+        const size_t chunk = chunkSize(last - first, grain);
+        const size_t count = (last - first + chunk - 1) / chunk;
+        std::vector<T> partials(count, identity);
+        runChunks(count, [&](size_t c) {
+            const size_t begin = first + c * chunk;
+            partials[c] = map(begin, last - begin < chunk ? last : begin + chunk);
+        });
+        T result = identity;
+        for (T& partial : partials) result = combine(result, partial);
+        return result;
+    }
+
+    static constexpr size_t MAX_CHUNKS = 256;
+
+    size_t size() const { return workers.size(); }
+    PoolMode mode() const { return poolMode; }
+
+    // True when called from one of this pool's worker threads
+    bool isWorkerThread() const;
+
 private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
     std::vector<std::thread> workers;
     std::queue<std::function<void()>> tasks;
+    std::vector<std::unique_ptr<WorkerQueue>> localQueues;
 
     std::mutex queueMutex;
     std::condition_variable condition;
     bool stop{false};
+    PoolMode poolMode;
+
+    // Tasks queued anywhere (shared queue + worker deques) and workers
+    // parked on the condition variable; used to avoid lost wake-ups
+    // without taking queueMutex on every local push.
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> idleWorkers{0};
+    // Size of the shared queue, so stealing workers skip queueMutex while
+    // it is empty
+    std::atomic<size_t> injected{0};
+
+    static size_t chunkSize(size_t n, size_t grain);
+    // Runs fn(0..count-1), one index per claim, on the workers and the
+    // calling thread
+    void runChunks(size_t count, const std::function<void(size_t)>& fn);
 
-    void workerThread();
+    void workerThread(size_t index);
+    bool popTask(size_t index, std::function<void()>& task);
+    void wakeOne();
 };
 
 #endif // THREADPOOL_H
@@ -0,0 +1,42 @@
+#ifndef WIREENCODING_H
+#define WIREENCODING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// How a float32 tensor's data is encoded in the TENS format; the value goes
+// in the header's dtype byte (see BinaryFormat in Tensor.h). Tensors of
+// other dtypes always travel as they are. Reduced-precision encodings trade accuracy for
+// 2x (FLOAT16, BFLOAT16) or ~3.6x (QINT8) fewer bytes on the wire, and
+// always decode back to float32.
+//   FLOAT16   IEEE binary16, ~3 significant digits, range +-65504
+//   BFLOAT16  float32 exponent range, ~2 significant digits
+//   QINT8     blocks of 32 values as a float32 scale (block absmax / 127)
+//             and 32 int8 values; error <= half a step of the block scale
+enum class WireEncoding : uint8_t {
+    FLOAT32 = 1,
+    FLOAT16 = 2,
+    BFLOAT16 = 3,
+    QINT8 = 4
+};
+
+const char* wireEncodingName(WireEncoding encoding);
+// Accepts the names above in lower case ("float16", "qint8", ...); throws
+// std::runtime_error for anything else
+WireEncoding parseWireEncoding(const std::string& name);
+// False for dtype bytes this build cannot decode
+bool isWireEncoding(uint8_t dtype);
+
+// Bytes taken by n encoded elements
+uint64_t encodedBytes(WireEncoding encoding, uint64_t n);
+// Encoded data can only be split on whole units (one element, or one QINT8
+// block); streams and chunked decodes cut on these boundaries
+size_t encodingUnitElems(WireEncoding encoding);
+size_t encodingUnitBytes(WireEncoding encoding);
+
+// SIMD conversions (Kernels.h). `out` holds encodedBytes(encoding, n) bytes.
+void encodeFloats(WireEncoding encoding, const float* in, char* out, size_t n);
+void decodeFloats(WireEncoding encoding, const char* in, float* out, size_t n);
+
+#endif
@@ -0,0 +1,177 @@
+#include "BufferPool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+constexpr size_t SMALL_CLASSES = 16; // 64..1024 bytes in steps of 64
+constexpr size_t MAX_POOLED_BYTES = size_t(1) << 30;
+constexpr size_t THREAD_CACHE_MAX_BUFFER = size_t(256) << 10;
+constexpr size_t THREAD_CACHE_PER_CLASS = 8;
+
+int log2Floor(size_t v) {
+    return 63 - __builtin_clzll(static_cast<unsigned long long>(v));
+}
+
+size_t classIndex(size_t bytes) {
+    if (bytes <= 1024) return bytes == 0 ? 0 : (bytes + 63) / 64 - 1;
+    // Four classes in (p, 2p] for p = the power of two below `bytes`
+    const int lg = log2Floor(bytes - 1);
+    const size_t p = size_t(1) << lg;
+    const size_t step = p / 4;
+    const size_t k = (bytes - p + step - 1) / step; // 1..4
+    return SMALL_CLASSES + static_cast<size_t>(lg - 10) * 4 + (k - 1);
+}
+
+size_t indexBytes(size_t index) {
+    if (index < SMALL_CLASSES) return (index + 1) * 64;
+    const size_t j = index - SMALL_CLASSES;
+    const size_t p = size_t(1) << (10 + j / 4);
+    return p + (j % 4 + 1) * (p / 4);
+}
+
+void* systemAllocate(size_t bytes) {
+    void* ptr = std::aligned_alloc(BufferPool::ALIGNMENT, bytes);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+} // namespace
+
+// Idle small buffers owned by one thread; handed to the shared lists when
+// the thread exits, or freed if a trim() has run since the thread last
+// used them
+struct BufferPool::ThreadCache {
+    std::vector<void*> lists[NUM_CLASSES];
+    uint64_t generation = 0;
+
+    ~ThreadCache() {
+        BufferPool& pool = BufferPool::instance();
+        if (generation != pool.trimGeneration.load(std::memory_order_acquire)) {
+            pool.freeIdle(lists);
+            return;
+        }
+        for (size_t i = 0; i < NUM_CLASSES; ++i) {
+            for (void* ptr : lists[i]) pool.releaseShared(ptr, i);
+        }
+    }
+};
+
+BufferPool& BufferPool::instance() {
+    // Never destroyed: thread caches may flush into it during exit
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+BufferPool::ThreadCache& BufferPool::threadCache() {
+    thread_local ThreadCache cache;
+    const uint64_t generation = trimGeneration.load(std::memory_order_acquire);
+    if (cache.generation != generation) {
+        cache.generation = generation;
+        freeIdle(cache.lists);
+    }
+    return cache;
+}
+
+size_t BufferPool::classBytes(size_t bytes) {
+    if (bytes > MAX_POOLED_BYTES) return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    return indexBytes(classIndex(bytes));
+}
+
+void* BufferPool::allocate(size_t bytes) {
+    if (bytes == 0) return nullptr;
+    const size_t reserved = classBytes(bytes);
+    bytesInUse.fetch_add(reserved, std::memory_order_relaxed);
+    if (bytes > MAX_POOLED_BYTES) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return systemAllocate(reserved);
+    }
+
+    const size_t index = classIndex(bytes);
+    void* ptr = nullptr;
+    if (reserved <= THREAD_CACHE_MAX_BUFFER) {
+        std::vector<void*>& list = threadCache().lists[index];
+        if (!list.empty()) {
+            ptr = list.back();
+            list.pop_back();
+        }
+    }
+    if (!ptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeLists[index].empty()) {
+            ptr = freeLists[index].back();
+            freeLists[index].pop_back();
+        }
+    }
+    if (ptr) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        bytesHeld.fetch_sub(reserved, std::memory_order_relaxed);
+        return ptr;
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return systemAllocate(reserved);
+}
+
+void BufferPool::release(void* ptr, size_t bytes) {
+    if (!ptr) return;
+    const size_t reserved = classBytes(bytes);
+    bytesInUse.fetch_sub(reserved, std::memory_order_relaxed);
+    if (bytes > MAX_POOLED_BYTES ||
+        bytesHeld.load(std::memory_order_relaxed) + reserved > maxHeldBytes.load(std::memory_order_relaxed)) {
+        std::free(ptr);
+        return;
+    }
+
+    const size_t index = classIndex(bytes);
+    bytesHeld.fetch_add(reserved, std::memory_order_relaxed);
+    if (reserved <= THREAD_CACHE_MAX_BUFFER) {
+        std::vector<void*>& list = threadCache().lists[index];
+        if (list.size() < THREAD_CACHE_PER_CLASS) {
+            list.push_back(ptr);
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    freeLists[index].push_back(ptr);
+}
+
+void BufferPool::releaseShared(void* ptr, size_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    freeLists[index].push_back(ptr);
+}
+
+BufferPoolStats BufferPool::stats() const {
+    BufferPoolStats s;
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    s.bytesHeld = bytesHeld.load(std::memory_order_relaxed);
+    s.bytesInUse = bytesInUse.load(std::memory_order_relaxed);
+    return s;
+}
+
+void BufferPool::setMaxHeldBytes(size_t bytes) {
+    maxHeldBytes.store(bytes);
+    if (bytesHeld.load() > bytes) trim();
+}
+
+void BufferPool::trim() {
+    // Every thread cache, this thread's included, is now stale
+    trimGeneration.fetch_add(1, std::memory_order_acq_rel);
+    threadCache();
+    std::vector<void*> idle[NUM_CLASSES];
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < NUM_CLASSES; ++i) idle[i].swap(freeLists[i]);
+    }
+    freeIdle(idle);
+}
+
+// Frees and empties per-class lists of idle buffers
+void BufferPool::freeIdle(std::vector<void*>* lists) {
+    for (size_t i = 0; i < NUM_CLASSES; ++i) {
+        for (void* ptr : lists[i]) std::free(ptr);
+        bytesHeld.fetch_sub(lists[i].size() * indexBytes(i), std::memory_order_relaxed);
+        lists[i].clear();
+    }
+}
@@ -0,0 +1,323 @@
+#include "Communicator.h"
+#include "Kernels.h"
+#include "TensorWire.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+sockaddr_in loopbackAddr(int port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+int mod(int a, int n) {
+    return ((a % n) + n) % n;
+}
+
+} // namespace
+
+Communicator::Communicator(int rank, int worldSize, int basePort, const CommOptions& options)
+    : myRank(rank), worldSize(worldSize), basePort(basePort), options(options) {
+    if (worldSize < 1 || rank < 0 || rank >= worldSize) throw std::runtime_error("Invalid rank or world size");
+    if (this->options.chunkBytes < sizeof(float)) this->options.chunkBytes = sizeof(float);
+    this->options.chunkBytes -= this->options.chunkBytes % sizeof(float);
+    staging.resize(this->options.chunkBytes / sizeof(float));
+    peers.assign(worldSize, -1);
+}
+
+Communicator::~Communicator() {
+    for (int fd : peers) {
+        if (fd >= 0) close(fd);
+    }
+    if (listenFd >= 0) close(listenFd);
+}
+
+void Communicator::tune(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (options.socketBufferBytes > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &options.socketBufferBytes, sizeof(options.socketBufferBytes));
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &options.socketBufferBytes, sizeof(options.socketBufferBytes));
+    }
+}
+
+void Communicator::connect() {
+    if (worldSize == 1) return;
+    const auto deadline = std::chrono::steady_clock::now() + options.connectTimeout;
+
+    // Higher ranks connect to us; buffers are set before listen so accepted
+    // sockets inherit them
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    tune(listenFd);
+    sockaddr_in addr = loopbackAddr(basePort + myRank);
+    if (listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, worldSize) < 0) {
+        throw std::runtime_error("Communicator: cannot listen on port " + std::to_string(basePort + myRank));
+    }
+
+    // Connect to every lower rank, retrying until it is listening, and
+    // introduce ourselves with our rank
+    for (int peer = 0; peer < myRank; ++peer) {
+        while (true) {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            tune(fd);
+            sockaddr_in peerAddr = loopbackAddr(basePort + peer);
+            if (fd >= 0 && ::connect(fd, (sockaddr*)&peerAddr, sizeof(peerAddr)) == 0) {
+                uint32_t hello = static_cast<uint32_t>(myRank);
+                if (!sendAll(fd, &hello, sizeof(hello))) {
+                    close(fd);
+                    throw std::runtime_error("Communicator: handshake failed");
+                }
+                peers[peer] = fd;
+                break;
+            }
+            if (fd >= 0) close(fd);
+            if (std::chrono::steady_clock::now() > deadline)
+                throw std::runtime_error("Communicator: timed out connecting to rank " + std::to_string(peer));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    // Accept every higher rank
+    for (int pending = worldSize - 1 - myRank; pending > 0;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (left.count() <= 0 || ::poll(&pfd, 1, static_cast<int>(left.count())) <= 0)
+            throw std::runtime_error("Communicator: timed out waiting for peers");
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        uint32_t hello = 0;
+        if (!readFull(fd, &hello, sizeof(hello)) || hello <= static_cast<uint32_t>(myRank) ||
+            hello >= static_cast<uint32_t>(worldSize) || peers[hello] >= 0) {
+            close(fd);
+            throw std::runtime_error("Communicator: bad handshake");
+        }
+        tune(fd);
+        peers[hello] = fd;
+        --pending;
+    }
+}
+
+std::pair<size_t, size_t> Communicator::segment(size_t n, int i) const {
+    return {n * i / worldSize, n * (i + 1) / worldSize};
+}
+
+std::vector<Communicator::Piece> Communicator::floatSegments(float* data, size_t n) const {
+    std::vector<Piece> segments;
+    for (int i = 0; i < worldSize; ++i) {
+        auto range = segment(n, i);
+        segments.push_back(Piece{reinterpret_cast<char*>(data + range.first),
+                                 (range.second - range.first) * sizeof(float)});
+    }
+    return segments;
+}
+
+// Streams `out` to the right-hand neighbour while receiving `in` from the
+// left, in one poll loop so neither direction waits for the other. `out`
+// may reuse memory that `in` fills: byte k of `out` past `initiallyReady` is
+// only sent once byte k - initiallyReady of `in` has landed. Incoming data
+// is either written in place or, with reduceIncoming, staged one chunk at a
+// time and added into the destination, so reduction overlaps the transfer.
+void Communicator::ringExchange(const std::vector<Piece>& out, const std::vector<Piece>& in,
+                                size_t initiallyReady, bool reduceIncoming) {
+    const int right = peers[mod(myRank + 1, worldSize)];
+    const int left = peers[mod(myRank - 1, worldSize)];
+
+    size_t outTotal = 0, inTotal = 0;
+    for (const Piece& p : out) outTotal += p.bytes;
+    for (const Piece& p : in) inTotal += p.bytes;
+
+    size_t sent = 0, landed = 0;
+    size_t outIdx = 0, outOff = 0, inIdx = 0, inOff = 0, stageFill = 0;
+    char* stage = reinterpret_cast<char*>(staging.data());
+
+    while (sent < outTotal || landed < inTotal) {
+        bool progress = false;
+
+        const size_t ready = std::min(outTotal, initiallyReady + landed);
+        while (sent < ready) {
+            while (out[outIdx].bytes == outOff) { ++outIdx; outOff = 0; }
+            size_t want = std::min(out[outIdx].bytes - outOff, ready - sent);
+            ssize_t n = ::send(right, out[outIdx].data + outOff, want, SEND_FLAGS | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                throw std::runtime_error("Communicator: send failed");
+            }
+            sent += static_cast<size_t>(n);
+            outOff += static_cast<size_t>(n);
+            progress = true;
+        }
+
+        while (landed < inTotal) {
+            while (in[inIdx].bytes == inOff) { ++inIdx; inOff = 0; }
+            const Piece& piece = in[inIdx];
+            size_t chunk = std::min(options.chunkBytes, piece.bytes - inOff);
+            char* dst = reduceIncoming ? stage + stageFill : piece.data + inOff;
+            size_t want = reduceIncoming ? chunk - stageFill : piece.bytes - inOff;
+            ssize_t n = ::recv(left, dst, want, MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                throw std::runtime_error("Communicator: receive failed");
+            }
+            if (n == 0) throw std::runtime_error("Communicator: peer closed the connection");
+            progress = true;
+            if (!reduceIncoming) {
+                inOff += static_cast<size_t>(n);
+                landed += static_cast<size_t>(n);
+                continue;
+            }
+            stageFill += static_cast<size_t>(n);
+            if (stageFill == chunk) {
+                float* target = reinterpret_cast<float*>(piece.data + inOff);
+                kernels::add(target, staging.data(), target, chunk / sizeof(float));
+                inOff += chunk;
+                landed += chunk;
+                stageFill = 0;
+            }
+        }
+
+        if (progress) continue;
+        pollfd fds[2];
+        nfds_t count = 0;
+        if (sent < ready) fds[count++] = pollfd{right, POLLOUT, 0};
+        if (landed < inTotal) {
+            if (count == 1 && right == left) fds[0].events |= POLLIN;
+            else fds[count++] = pollfd{left, POLLIN, 0};
+        }
+        if (::poll(fds, count, -1) < 0 && errno != EINTR) throw std::runtime_error("Communicator: poll failed");
+    }
+}
+
+// After N-1 steps rank r holds the full sum of segment r. At step s it
+// forwards segment r-s-1 (already reduced with everything received so far)
+// and receives segment r-s-2, so the stream it sends at step s+1 is exactly
+// what it received at step s.
+void Communicator::ringReduceScatter(const std::vector<Piece>& segments) {
+    std::vector<Piece> out, in;
+    for (int s = 0; s < worldSize - 1; ++s) {
+        out.push_back(segments[mod(myRank - s - 1, worldSize)]);
+        in.push_back(segments[mod(myRank - s - 2, worldSize)]);
+    }
+    ringExchange(out, in, out[0].bytes, true);
+}
+
+// Rank r starts with segment r and passes along whatever it received last
+void Communicator::ringAllGather(const std::vector<Piece>& segments) {
+    std::vector<Piece> out, in;
+    for (int s = 0; s < worldSize - 1; ++s) {
+        out.push_back(segments[mod(myRank - s, worldSize)]);
+        in.push_back(segments[mod(myRank - s - 1, worldSize)]);
+    }
+    ringExchange(out, in, out[0].bytes, false);
+}
+
+void Communicator::allReduce(Tensor& tensor) {
+    if (worldSize == 1) return;
+    std::vector<Piece> segments = floatSegments(tensor.dataPtr(), tensor.size());
+    ringReduceScatter(segments);
+    ringAllGather(segments);
+}
+
+Tensor Communicator::reduceScatter(const Tensor& input) {
+    Tensor work = input;
+    float* data = work.dataPtr();
+    if (worldSize > 1) ringReduceScatter(floatSegments(data, work.size()));
+
+    auto range = segment(work.size(), myRank);
+    Tensor result = Tensor::uninitialized({range.second - range.first});
+    if (result.size() > 0) std::memcpy(result.dataPtr(), data + range.first, result.size() * sizeof(float));
+    return result;
+}
+
+Tensor Communicator::allGather(const Tensor& local) {
+    std::vector<size_t> shape = local.getShape();
+    shape.insert(shape.begin(), static_cast<size_t>(worldSize));
+    Tensor result = Tensor::uninitialized(shape);
+
+    const size_t bytes = local.size() * sizeof(float);
+    char* base = reinterpret_cast<char*>(result.dataPtr());
+    if (bytes > 0) std::memcpy(base + myRank * bytes, local.contiguous().dataPtr(), bytes);
+    if (worldSize > 1) {
+        std::vector<Piece> segments;
+        for (int i = 0; i < worldSize; ++i) segments.push_back(Piece{base + i * bytes, bytes});
+        ringAllGather(segments);
+    }
+    return result;
+}
+
+void Communicator::sendTo(int rank, const char* data, size_t bytes) {
+    if (!sendAll(peers[rank], data, bytes)) throw std::runtime_error("Communicator: send failed");
+}
+
+void Communicator::recvInto(int rank, char* data, size_t bytes) {
+    if (bytes > 0 && !readFull(peers[rank], data, bytes)) throw std::runtime_error("Communicator: receive failed");
+}
+
+void Communicator::recvReduce(int rank, float* data, size_t n) {
+    const size_t chunk = staging.size();
+    for (size_t i = 0; i < n; i += chunk) {
+        size_t count = std::min(chunk, n - i);
+        recvInto(rank, reinterpret_cast<char*>(staging.data()), count * sizeof(float));
+        kernels::add(data + i, staging.data(), data + i, count);
+    }
+}
+
+// Binomial tree rooted at `root`, in ranks relative to it: a rank receives
+// from the parent that differs in its lowest set bit, then forwards to the
+// children below that bit, largest subtree first.
+void Communicator::broadcast(Tensor& tensor, int root) {
+    if (worldSize == 1) return;
+    const int vr = mod(myRank - root, worldSize);
+    char* data = reinterpret_cast<char*>(tensor.dataPtr());
+    const size_t bytes = tensor.size() * sizeof(float);
+
+    int mask = 1;
+    while (mask < worldSize) {
+        if (vr & mask) {
+            recvInto(mod(vr - mask + root, worldSize), data, bytes);
+            break;
+        }
+        mask <<= 1;
+    }
+    for (mask >>= 1; mask > 0; mask >>= 1) {
+        if (vr + mask < worldSize) sendTo(mod(vr + mask + root, worldSize), data, bytes);
+    }
+}
+
+// Mirror image of broadcast: children's partial sums flow up the same tree
+void Communicator::reduce(Tensor& tensor, int root) {
+    if (worldSize == 1) return;
+    const int vr = mod(myRank - root, worldSize);
+    float* data = tensor.dataPtr();
+
+    for (int mask = 1; mask < worldSize; mask <<= 1) {
+        if (vr & mask) {
+            sendTo(mod(vr - mask + root, worldSize), reinterpret_cast<const char*>(data),
+                   tensor.size() * sizeof(float));
+            break;
+        }
+        if (vr + mask < worldSize) recvReduce(mod(vr + mask + root, worldSize), data, tensor.size());
+    }
+}
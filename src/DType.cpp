@@ -0,0 +1,115 @@
+#include "DType.h"
+#include "Kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+size_t dtypeSize(DType dtype) {
+    switch (dtype) {
+    case DType::FLOAT16:
+    case DType::BFLOAT16: return 2;
+    case DType::INT8: return 1;
+    case DType::FLOAT64: return 8;
+    default: return 4;
+    }
+}
+
+const char* dtypeName(DType dtype) {
+    switch (dtype) {
+    case DType::FLOAT16: return "float16";
+    case DType::BFLOAT16: return "bfloat16";
+    case DType::INT8: return "int8";
+    case DType::INT32: return "int32";
+    case DType::FLOAT64: return "float64";
+    default: return "float32";
+    }
+}
+
+bool isDType(uint8_t code) {
+    return (code >= 1 && code <= 3) || (code >= 5 && code <= 7);
+}
+
+namespace {
+
+// Round to nearest (ties to even) and clamp into [lo, hi]
+template <typename Int>
+Int saturate(double v, double lo, double hi) {
+    if (std::isnan(v)) return 0;
+    return static_cast<Int>(std::nearbyint(std::min(hi, std::max(lo, v))));
+}
+
+template <typename From, typename To>
+void castLoop(const void* in, void* out, size_t n) {
+    const From* src = static_cast<const From*>(in);
+    To* dst = static_cast<To*>(out);
+    for (size_t i = 0; i < n; ++i) dst[i] = static_cast<To>(src[i]);
+}
+
+template <typename From, typename Int>
+void saturateLoop(const void* in, void* out, size_t n, double lo, double hi) {
+    const From* src = static_cast<const From*>(in);
+    Int* dst = static_cast<Int*>(out);
+    for (size_t i = 0; i < n; ++i) dst[i] = saturate<Int>(src[i], lo, hi);
+}
+
+void toFloat(DType from, const void* in, float* out, size_t n) {
+    switch (from) {
+    case DType::FLOAT16: kernels::halfToFloat(static_cast<const uint16_t*>(in), out, n); break;
+    case DType::BFLOAT16: kernels::bfloat16ToFloat(static_cast<const uint16_t*>(in), out, n); break;
+    case DType::INT8: castLoop<int8_t, float>(in, out, n); break;
+    case DType::INT32: castLoop<int32_t, float>(in, out, n); break;
+    case DType::FLOAT64: castLoop<double, float>(in, out, n); break;
+    default: std::memcpy(out, in, n * sizeof(float)); break;
+    }
+}
+
+void fromFloat(const float* in, DType to, void* out, size_t n) {
+    switch (to) {
+    case DType::FLOAT16: kernels::floatToHalf(in, static_cast<uint16_t*>(out), n); break;
+    case DType::BFLOAT16: kernels::floatToBfloat16(in, static_cast<uint16_t*>(out), n); break;
+    case DType::INT8: saturateLoop<float, int8_t>(in, out, n, -128.0, 127.0); break;
+    case DType::INT32: saturateLoop<float, int32_t>(in, out, n, -2147483648.0, 2147483647.0); break;
+    case DType::FLOAT64: castLoop<float, double>(in, out, n); break;
+    default: std::memcpy(out, in, n * sizeof(float)); break;
+    }
+}
+
+} // namespace
+
+void convertElements(DType from, const void* in, DType to, void* out, size_t n) {
+    if (n == 0) return;
+    if (from == to) {
+        std::memcpy(out, in, n * dtypeSize(from));
+        return;
+    }
+    if (from == DType::FLOAT32) return fromFloat(static_cast<const float*>(in), to, out, n);
+    if (to == DType::FLOAT32) return toFloat(from, in, static_cast<float*>(out), n);
+
+    // Pairs that float32 would round: keep them exact
+    switch ((static_cast<int>(from) << 8) | static_cast<int>(to)) {
+    case (int(DType::INT32) << 8) | int(DType::FLOAT64): return castLoop<int32_t, double>(in, out, n);
+    case (int(DType::INT8) << 8) | int(DType::FLOAT64): return castLoop<int8_t, double>(in, out, n);
+    case (int(DType::INT8) << 8) | int(DType::INT32): return castLoop<int8_t, int32_t>(in, out, n);
+    case (int(DType::FLOAT64) << 8) | int(DType::INT32):
+        return saturateLoop<double, int32_t>(in, out, n, -2147483648.0, 2147483647.0);
+    case (int(DType::FLOAT64) << 8) | int(DType::INT8): return saturateLoop<double, int8_t>(in, out, n, -128.0, 127.0);
+    case (int(DType::INT32) << 8) | int(DType::INT8): {
+        const int32_t* src = static_cast<const int32_t*>(in);
+        int8_t* dst = static_cast<int8_t*>(out);
+        for (size_t i = 0; i < n; ++i) dst[i] = static_cast<int8_t>(std::min(127, std::max(-128, src[i])));
+        return;
+    }
+    default: break;
+    }
+
+    // Everything else goes through float32 a block at a time
+    constexpr size_t BLOCK = 1024;
+    float buffer[BLOCK];
+    const char* src = static_cast<const char*>(in);
+    char* dst = static_cast<char*>(out);
+    for (size_t i = 0; i < n; i += BLOCK) {
+        const size_t len = std::min(BLOCK, n - i);
+        toFloat(from, src + i * dtypeSize(from), buffer, len);
+        fromFloat(buffer, to, dst + i * dtypeSize(to), len);
+    }
+}
@@ -0,0 +1,110 @@
+#include "Elementwise.h"
+#include "Kernels.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// An operand as float32, broadcast to the source's shape; `data` is set
+// when it can be read in place
+struct Operand {
+    Tensor tensor;
+    const float* data = nullptr;
+};
+
+Operand prepareOperand(const Tensor* operand, const Tensor& source) {
+    if (!operand) throw std::runtime_error("Elementwise operand out of range");
+    Operand ready;
+    ready.tensor = operand->dtype() == DType::FLOAT32 ? *operand : operand->cast(DType::FLOAT32);
+    if (ready.tensor.size() != source.size()) {
+        try {
+            ready.tensor = ready.tensor.broadcastTo(source.getShape());
+        } catch (const std::runtime_error&) {
+            throw std::runtime_error("Elementwise operand does not broadcast to the source");
+        }
+    }
+    const Tensor& view = ready.tensor; // const access: no copy-on-write detach
+    if (view.isContiguous()) ready.data = view.dataPtr();
+    return ready;
+}
+
+} // namespace
+
+void runElementwise(const std::vector<ElementwiseStep>& steps, const Tensor& source,
+                    const std::vector<const Tensor*>& operands, Tensor& out) {
+    std::vector<Operand> ready(operands.size());
+    std::vector<bool> prepared(operands.size(), false);
+    std::vector<std::vector<float>> constants(steps.size());
+    for (size_t s = 0; s < steps.size(); ++s) {
+        const ElementwiseStep& step = steps[s];
+        if (step.op == ElementwiseOp::ADD || step.op == ElementwiseOp::MUL) {
+            if (step.operand >= operands.size()) throw std::runtime_error("Elementwise operand out of range");
+            if (!prepared[step.operand]) {
+                ready[step.operand] = prepareOperand(operands[step.operand], source);
+                prepared[step.operand] = true;
+            }
+        } else if (step.op == ElementwiseOp::ADD_SCALAR) {
+            constants[s].assign(std::min(ELEMENTWISE_TILE, source.size()), step.scalar);
+        }
+    }
+
+    // Where each tile comes from: the source in place, a float32 copy of
+    // it, or gathered straight into the output tile
+    Tensor widened;
+    const float* src = nullptr;
+    float* dst = nullptr;
+    if (&out == &source) {
+        if (out.dtype() != DType::FLOAT32) out = out.cast(DType::FLOAT32);
+        dst = out.dataPtr();
+        src = dst;
+    } else {
+        if (source.dtype() != DType::FLOAT32) widened = source.cast(DType::FLOAT32);
+        const Tensor& from = source.dtype() == DType::FLOAT32 ? source : widened;
+        out = Tensor::reuse(std::move(out), source.getShape());
+        dst = out.dataPtr();
+        if (from.isContiguous()) src = from.dataPtr();
+    }
+
+    const size_t n = source.size();
+    float operandTile[ELEMENTWISE_TILE];
+    for (size_t i = 0; i < n; i += ELEMENTWISE_TILE) {
+        const size_t len = std::min(ELEMENTWISE_TILE, n - i);
+        float* y = dst + i;
+        const float* x = y;
+        if (src) {
+            x = src + i;
+        } else {
+            source.gather(i, len, y);
+        }
+
+        for (size_t s = 0; s < steps.size(); ++s) {
+            const ElementwiseStep& step = steps[s];
+            switch (step.op) {
+            case ElementwiseOp::ADD:
+            case ElementwiseOp::MUL: {
+                const Operand& operand = ready[step.operand];
+                const float* b = operand.data ? operand.data + i : operandTile;
+                if (!operand.data) operand.tensor.gather(i, len, operandTile);
+                if (step.op == ElementwiseOp::ADD) kernels::add(x, b, y, len);
+                else kernels::mul(x, b, y, len);
+                break;
+            }
+            case ElementwiseOp::SCALE:
+                kernels::scale(x, step.scalar, y, len);
+                break;
+            case ElementwiseOp::ADD_SCALAR:
+                kernels::add(x, constants[s].data(), y, len);
+                break;
+            case ElementwiseOp::RELU:
+                kernels::relu(x, y, len);
+                break;
+            case ElementwiseOp::GELU:
+                kernels::gelu(x, y, len);
+                break;
+            }
+            x = y;
+        }
+        if (x != y) std::memcpy(y, x, len * sizeof(float));
+    }
+}
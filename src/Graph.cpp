@@ -0,0 +1,387 @@
+#include "Graph.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// Shared by every task of one executeAsync() call; kept alive by the tasks
+// themselves so the caller may drop the future early.
+struct GraphRun {
+    std::vector<std::shared_ptr<GraphNode>> nodes;
+    std::vector<std::vector<size_t>> dependents;
+    std::unique_ptr<std::atomic<size_t>[]> remaining;
+    std::atomic<size_t> unfinished{0};
+    std::atomic<bool> failed{false};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    std::promise<void> done;
+    ThreadPool* pool = nullptr;
+
+    // Memory plan state: the plan, free buffers by index, each node's
+    // in-graph inputs and how many reads of it are still to come
+    bool planned = false;
+    MemoryPlan plan;
+    std::vector<Tensor> slots;
+    std::vector<std::vector<size_t>> inputs;
+    std::unique_ptr<std::atomic<size_t>[]> readersLeft;
+};
+
+void launchNode(const std::shared_ptr<GraphRun>& run, size_t index);
+
+// True if a node still reads inputs[0] after taking its buffer over: through
+// a second edge to it, or as operand 0 of an elementwise ADD or MUL
+bool readsSourceAgain(const GraphNode& node, const std::vector<size_t>& inputs) {
+    for (size_t k = 1; k < inputs.size(); ++k) {
+        if (inputs[k] == inputs[0]) return true;
+    }
+    for (const ElementwiseStep& step : node.elementwise) {
+        if ((step.op == ElementwiseOp::ADD || step.op == ElementwiseOp::MUL) && step.operand == 0) return true;
+    }
+    return false;
+}
+
+// Fulfil the promise once the last outstanding node (or guard) is done
+void finishOne(const std::shared_ptr<GraphRun>& run) {
+    if (run->unfinished.fetch_sub(1) != 1) return;
+    if (run->error) {
+        run->done.set_exception(run->error);
+    } else {
+        run->done.set_value();
+    }
+}
+
+// Hands an in-place node its input and a planned node its buffer
+void prepareOutput(GraphRun& run, size_t index) {
+    GraphNode& node = *run.nodes[index];
+    if (!node.operation) return;
+    const size_t buffer = run.planned ? run.plan.buffer[index] : MemoryPlan::NONE;
+    if (run.planned && run.plan.inPlace[index]) {
+        node.tensor = std::move(node.inputs[0]->tensor);
+        node.inputs[0]->tensor = Tensor();
+    } else if (node.inPlace && !node.inputs.empty()) {
+        const Tensor& input = node.inputs[0]->tensor;
+        if (buffer == MemoryPlan::NONE) {
+            node.tensor = input; // copy-on-write
+        } else {
+            node.tensor = Tensor::reuse(std::move(run.slots[buffer]), input.getShape(), input.dtype());
+            input.gather(0, input.size(), node.tensor.rawData());
+        }
+    } else if (buffer != MemoryPlan::NONE) {
+        node.tensor = Tensor::reuse(std::move(run.slots[buffer]), run.plan.shapes[index], run.plan.dtypes[index]);
+    }
+}
+
+// Frees the buffers of planned inputs that this node was the last to read
+void releaseInputs(GraphRun& run, size_t index) {
+    if (!run.planned) return;
+    for (size_t input : run.inputs[index]) {
+        if (input == MemoryPlan::NONE || run.readersLeft[input].fetch_sub(1) != 1) continue;
+        const size_t buffer = run.plan.buffer[input];
+        if (buffer == MemoryPlan::NONE) continue;
+        // Empty if an in-place reader took the buffer over
+        run.slots[buffer] = std::move(run.nodes[input]->tensor);
+        run.nodes[input]->tensor = Tensor();
+    }
+}
+
+void runNode(const std::shared_ptr<GraphRun>& run, size_t index) {
+    if (!run->failed.load()) {
+        try {
+            prepareOutput(*run, index);
+            run->nodes[index]->run();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(run->errorMutex);
+            if (!run->error) run->error = std::current_exception();
+            run->failed.store(true);
+        }
+    }
+    releaseInputs(*run, index);
+
+    // Release consumers before counting this node as finished so the graph
+    // cannot be reported complete while dependents are still being queued.
+    for (size_t next : run->dependents[index]) {
+        if (run->remaining[next].fetch_sub(1) == 1) {
+            launchNode(run, next);
+        }
+    }
+
+    finishOne(run);
+}
+
+void launchNode(const std::shared_ptr<GraphRun>& run, size_t index) {
+    // Source nodes (no operation) complete inline; no pool round-trip needed
+    if (!run->nodes[index]->operation) {
+        runNode(run, index);
+        return;
+    }
+    run->pool->enqueue([run, index]() { runNode(run, index); });
+}
+
+} // namespace
+
+void Graph::buildEdges(std::vector<std::vector<size_t>>& dependents,
+                       std::vector<size_t>& inDegree) const {
+    std::unordered_map<const GraphNode*, size_t> indexOf;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        indexOf[nodes[i].get()] = i;
+    }
+
+    dependents.assign(nodes.size(), {});
+    inDegree.assign(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        for (const auto& input : nodes[i]->inputs) {
+            auto it = indexOf.find(input.get());
+            if (it == indexOf.end()) continue;
+            dependents[it->second].push_back(i);
+            ++inDegree[i];
+        }
+    }
+}
+
+std::vector<std::vector<size_t>> Graph::inputIndices() const {
+    std::unordered_map<const GraphNode*, size_t> indexOf;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        indexOf[nodes[i].get()] = i;
+    }
+
+    std::vector<std::vector<size_t>> inputs(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        for (const auto& input : nodes[i]->inputs) {
+            auto it = indexOf.find(input.get());
+            inputs[i].push_back(it == indexOf.end() ? MemoryPlan::NONE : it->second);
+        }
+    }
+    return inputs;
+}
+
+std::vector<size_t> Graph::topologicalOrder() const {
+    std::vector<std::vector<size_t>> dependents;
+    std::vector<size_t> inDegree;
+    buildEdges(dependents, inDegree);
+
+    std::vector<size_t> order;
+    order.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (inDegree[i] == 0) order.push_back(i);
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+        for (size_t next : dependents[order[head]]) {
+            if (--inDegree[next] == 0) order.push_back(next);
+        }
+    }
+
+    if (order.size() != nodes.size()) {
+        throw std::runtime_error("Graph contains a cycle");
+    }
+    return order;
+}
+
+std::future<void> Graph::executeAsync(ThreadPool* pool, const MemoryPlan* plan) {
+    topologicalOrder(); // reject cycles up front; they would never complete
+
+    auto run = std::make_shared<GraphRun>();
+    run->nodes = nodes;
+    run->pool = pool;
+
+    std::vector<size_t> inDegree;
+    buildEdges(run->dependents, inDegree);
+    if (plan) {
+        bool matches = plan->nodes.size() == nodes.size();
+        for (size_t i = 0; matches && i < nodes.size(); ++i) matches = plan->nodes[i] == nodes[i].get();
+        if (!matches) throw std::runtime_error("Memory plan was made for a different graph");
+
+        run->planned = true;
+        run->plan = *plan;
+        run->slots.resize(plan->bufferBytes.size());
+        run->inputs = inputIndices();
+        // Counted from the data edges alone: releaseInputs() only ever
+        // decrements for real inputs, and an ordering edge added below can
+        // land on a node that was already visited
+        run->readersLeft.reset(new std::atomic<size_t>[nodes.size()]);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            run->readersLeft[i].store(run->dependents[i].size());
+        }
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            for (size_t before : plan->waitFor[i]) {
+                run->dependents[before].push_back(i);
+                ++inDegree[i];
+            }
+            // Leftovers from building the graph or an earlier run
+            if (plan->buffer[i] != MemoryPlan::NONE) nodes[i]->tensor = Tensor();
+        }
+    }
+    run->remaining.reset(new std::atomic<size_t>[nodes.size()]);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        run->remaining[i].store(inDegree[i]);
+    }
+
+    std::future<void> result = run->done.get_future();
+    if (nodes.empty()) {
+        run->done.set_value();
+        return result;
+    }
+
+    // +1 guard so the graph cannot complete while sources are still launching
+    run->unfinished.store(nodes.size() + 1);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (inDegree[i] == 0) launchNode(run, i);
+    }
+    finishOne(run);
+    return result;
+}
+
+void Graph::execute(ThreadPool* pool, const MemoryPlan* plan) {
+    executeAsync(pool, plan).get();
+}
+
+MemoryPlan Graph::planMemory() const {
+    const size_t n = nodes.size();
+    MemoryPlan plan;
+    plan.order = topologicalOrder();
+
+    std::vector<std::vector<size_t>> readers;
+    std::vector<size_t> inDegree;
+    buildEdges(readers, inDegree);
+    const std::vector<std::vector<size_t>> inputs = inputIndices();
+
+    plan.firstUse.assign(n, 0);
+    plan.lastUse.assign(n, n);
+    plan.buffer.assign(n, MemoryPlan::NONE);
+    plan.inPlace.assign(n, false);
+    plan.waitFor.assign(n, {});
+    std::vector<bool> intermediate(n, false);
+    for (size_t s = 0; s < n; ++s) plan.firstUse[plan.order[s]] = s;
+    for (size_t i = 0; i < n; ++i) {
+        plan.nodes.push_back(nodes[i].get());
+        plan.shapes.push_back(nodes[i]->tensor.getShape());
+        plan.dtypes.push_back(nodes[i]->tensor.dtype());
+        intermediate[i] = nodes[i]->operation && !readers[i].empty();
+        if (!intermediate[i]) continue;
+        plan.lastUse[i] = 0;
+        for (size_t r : readers[i]) plan.lastUse[i] = std::max(plan.lastUse[i], plan.firstUse[r]);
+    }
+
+    std::vector<size_t> freeBuffers;
+    std::vector<size_t> holder; // per buffer, the node that last took it
+    std::vector<bool> handedOff(n, false); // buffer taken over in place or freed
+    for (size_t s = 0; s < n; ++s) {
+        const size_t i = plan.order[s];
+        const GraphNode& node = *nodes[i];
+        if (!node.operation) continue;
+
+        const size_t source = inputs[i].empty() ? MemoryPlan::NONE : inputs[i][0];
+        if (node.inPlace && source != MemoryPlan::NONE && intermediate[source] &&
+            plan.buffer[source] != MemoryPlan::NONE && plan.lastUse[source] == s && !handedOff[source] &&
+            plan.shapes[source] == plan.shapes[i] && plan.dtypes[source] == plan.dtypes[i] &&
+            !readsSourceAgain(node, inputs[i])) {
+            plan.buffer[i] = plan.buffer[source];
+            plan.inPlace[i] = true;
+            handedOff[source] = true;
+            for (size_t r : readers[source]) {
+                if (r != i) plan.waitFor[i].push_back(r);
+            }
+        } else if (intermediate[i]) {
+            const size_t bytes = node.tensor.nbytes();
+            size_t best = freeBuffers.size();
+            for (size_t f = 0; f < freeBuffers.size(); ++f) {
+                const size_t have = plan.bufferBytes[freeBuffers[f]];
+                if (have >= bytes && (best == freeBuffers.size() || have < plan.bufferBytes[freeBuffers[best]])) {
+                    best = f;
+                }
+            }
+            if (best < freeBuffers.size()) {
+                plan.buffer[i] = freeBuffers[best];
+                freeBuffers.erase(freeBuffers.begin() + best);
+                plan.waitFor[i] = readers[holder[plan.buffer[i]]];
+            } else {
+                plan.buffer[i] = plan.bufferBytes.size();
+                plan.bufferBytes.push_back(bytes);
+                holder.push_back(i);
+            }
+        }
+        if (plan.buffer[i] != MemoryPlan::NONE) {
+            holder[plan.buffer[i]] = i;
+            plan.naiveBytes += node.tensor.nbytes();
+        }
+
+        // Buffers whose holder was last read by this node are free again
+        for (size_t input : inputs[i]) {
+            if (input == MemoryPlan::NONE || plan.buffer[input] == MemoryPlan::NONE || handedOff[input] ||
+                plan.lastUse[input] != s) {
+                continue;
+            }
+            handedOff[input] = true;
+            freeBuffers.push_back(plan.buffer[input]);
+        }
+    }
+    for (size_t bytes : plan.bufferBytes) plan.plannedBytes += bytes;
+    return plan;
+}
+
+size_t Graph::fuseElementwise() {
+    const std::vector<size_t> order = topologicalOrder();
+    std::vector<std::vector<size_t>> readers;
+    std::vector<size_t> inDegree;
+    buildEdges(readers, inDegree);
+    const std::vector<std::vector<size_t>> inputs = inputIndices();
+
+    // In topological order a merged producer already holds everything
+    // fused into it, so whole chains collapse in one pass
+    std::vector<bool> merged(nodes.size(), false);
+    size_t count = 0;
+    for (size_t i : order) {
+        GraphNode& node = *nodes[i];
+        if (node.elementwise.empty() || inputs[i].empty()) continue;
+        const size_t p = inputs[i][0];
+        if (p == MemoryPlan::NONE || nodes[p]->elementwise.empty() || readers[p].size() != 1) continue;
+        GraphNode& producer = *nodes[p];
+        if (producer.inputs.empty()) continue;
+        bool readsProducer = false; // as an operand besides the running value
+        for (const ElementwiseStep& step : node.elementwise) {
+            if ((step.op == ElementwiseOp::ADD || step.op == ElementwiseOp::MUL) && step.operand == 0) {
+                readsProducer = true;
+            }
+        }
+        if (readsProducer) continue;
+
+        // Our operand k >= 1 follows the producer's inputs
+        std::vector<ElementwiseStep> steps = producer.elementwise;
+        for (ElementwiseStep step : node.elementwise) {
+            if (step.op == ElementwiseOp::ADD || step.op == ElementwiseOp::MUL) {
+                step.operand += producer.inputs.size() - 1;
+            }
+            steps.push_back(step);
+        }
+        std::vector<std::shared_ptr<GraphNode>> mergedInputs = producer.inputs;
+        mergedInputs.insert(mergedInputs.end(), node.inputs.begin() + 1, node.inputs.end());
+        node.inputs = std::move(mergedInputs);
+        node.inPlace = producer.inPlace; // the merged chain starts where the producer's did
+        node.name = producer.name + "+" + node.name;
+        node.setElementwise(std::move(steps));
+        merged[p] = true;
+        ++count;
+    }
+
+    std::vector<std::shared_ptr<GraphNode>> kept;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!merged[i]) kept.push_back(nodes[i]);
+    }
+    nodes = std::move(kept);
+    return count;
+}
+
+std::string MemoryPlan::report() const {
+    size_t planned = 0, inPlaceCount = 0;
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        if (buffer[i] != NONE) ++planned;
+        if (inPlace[i]) ++inPlaceCount;
+    }
+    std::ostringstream out;
+    out << planned << " tensors in " << bufferBytes.size() << " buffers (" << inPlaceCount << " in place): "
+        << plannedBytes << " bytes planned vs " << naiveBytes << " naive";
+    return out.str();
+}
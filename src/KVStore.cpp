@@ -1,53 +1,939 @@
 #include "KVStore.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
 
-void KVStore::put(const std::string& key, const Tensor& tensor) {
-    std::lock_guard<std::mutex> lock(storeMutex);
-    store[key] = tensor;
+namespace {
+
+std::string checkpointPath(const std::string& key) {
+    return "checkpoints/" + key + ".chk";
 }
 
-bool KVStore::get(const std::string& key, Tensor& outTensor) {
-    std::lock_guard<std::mutex> lock(storeMutex);
+// Unique per process and call so concurrent saves never share a temp file
+std::string tempPathFor(const std::string& filename) {
+    static std::atomic<unsigned long> counter{0};
+    return filename + ".tmp." + std::to_string(getpid()) + "." + std::to_string(counter.fetch_add(1));
+}
 
-    auto it = store.find(key);
-    if (it == store.end()) {
-        return false;
+bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
     }
+    return true;
+}
 
-    outTensor = it->second;
+bool syncDirectory(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+bool writeAllAt(int fd, const char* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = ::pwrite(fd, data, len, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
     return true;
 }
 
-bool KVStore::saveToDisk(const std::string& key) {
-    std::lock_guard<std::mutex> lock(storeMutex);
+bool readAllAt(int fd, char* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = ::pread(fd, data, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Snapshot file, all integers little-endian:
+//   0   'KVSN' magic
+//   4   u32 version (1)
+//   8   u64 entry count
+//   16  u64 index bytes
+//   24  u64 FNV-1a hash of the index
+//   32  index, per entry: u32 key length, key bytes, u8 dtype, u8 dims,
+//       u16 reserved, dims x u64 shape, u64 data offset, u64 data bytes
+// then each tensor as a binary tensor record (Tensor::writeBinaryHeader
+// followed by the data) placed so the data starts on a page boundary,
+// which lets a mapped snapshot hand out aligned zero-copy tensors
+constexpr size_t SNAPSHOT_HEADER = 32;
+constexpr uint64_t SNAPSHOT_ALIGN = 4096;
+// Tensor data is read and written in pieces of this size, spread over the
+// pool
+constexpr uint64_t SNAPSHOT_PIECE = uint64_t(8) << 20;
+
+struct SnapshotEntry {
+    std::string key;
+    DType dtype = DType::FLOAT32;
+    std::vector<size_t> shape;
+    uint64_t offset = 0; // of the data
+    uint64_t bytes = 0;
+    std::shared_ptr<const Tensor> tensor; // packed; when saving
+
+    // The binary tensor header just before the data
+    size_t headerBytes() const { return 16 + shape.size() * 8 + 8; }
+};
+
+void putU64(std::vector<char>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+void putU32(std::vector<char>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+uint64_t getLE(const char* in, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= uint64_t(static_cast<unsigned char>(in[i])) << (8 * i);
+    return v;
+}
+
+uint64_t fnv1a(const char* data, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::vector<SnapshotEntry> parseSnapshotIndex(const char* index, size_t len, uint64_t count, uint64_t fileSize) {
+    std::vector<SnapshotEntry> entries;
+    size_t pos = 0;
+    auto need = [&](size_t n) {
+        if (len - pos < n) throw std::runtime_error("index truncated");
+    };
+    uint64_t dataStart = SNAPSHOT_HEADER + len;
+    for (uint64_t i = 0; i < count; ++i) {
+        SnapshotEntry e;
+        need(4);
+        const size_t keyLen = static_cast<size_t>(getLE(index + pos, 4));
+        pos += 4;
+        need(keyLen + 4);
+        e.key.assign(index + pos, keyLen);
+        pos += keyLen;
+        if (!isDType(static_cast<uint8_t>(index[pos]))) throw std::runtime_error("unknown dtype");
+        e.dtype = static_cast<DType>(index[pos]);
+        const size_t dims = static_cast<unsigned char>(index[pos + 1]);
+        if (dims > Tensor::MAX_DIMS) throw std::runtime_error("too many dims");
+        pos += 4;
+        need(dims * 8 + 16);
+        uint64_t numel = 1;
+        for (size_t d = 0; d < dims; ++d) {
+            const uint64_t extent = getLE(index + pos + d * 8, 8);
+            if (extent != 0 && numel > fileSize / extent) throw std::runtime_error("shape larger than the file");
+            numel *= extent;
+            e.shape.push_back(static_cast<size_t>(extent));
+        }
+        pos += dims * 8;
+        e.offset = getLE(index + pos, 8);
+        e.bytes = getLE(index + pos + 8, 8);
+        pos += 16;
+        if (e.bytes != numel * dtypeSize(e.dtype)) throw std::runtime_error("size does not match shape");
+        if (e.offset < dataStart + e.headerBytes() || e.offset > fileSize || e.bytes > fileSize - e.offset) {
+            throw std::runtime_error("data outside the file");
+        }
+        entries.push_back(std::move(e));
+    }
+    if (pos != len) throw std::runtime_error("index has trailing bytes");
+    return entries;
+}
+
+// Calls fn(entry, begin, len) for every SNAPSHOT_PIECE-sized piece of the
+// entries' data (one empty piece for an empty tensor), across `pool` when
+// given. Returns false if any call did.
+bool forEachPiece(const std::vector<SnapshotEntry>& entries, ThreadPool* pool,
+                  const std::function<bool(const SnapshotEntry&, uint64_t, size_t)>& fn) {
+    std::vector<std::pair<size_t, uint64_t>> pieces;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        uint64_t begin = 0;
+        do {
+            pieces.emplace_back(i, begin);
+            begin += SNAPSHOT_PIECE;
+        } while (begin < entries[i].bytes);
+    }
+    std::atomic<bool> ok{true};
+    auto run = [&](size_t first, size_t last) {
+        for (size_t p = first; p < last && ok; ++p) {
+            const SnapshotEntry& e = entries[pieces[p].first];
+            const uint64_t begin = pieces[p].second;
+            if (!fn(e, begin, static_cast<size_t>(std::min(SNAPSHOT_PIECE, e.bytes - begin)))) ok = false;
+        }
+    };
+    if (pool) {
+        pool->parallel_for(0, pieces.size(), 1, run);
+    } else {
+        run(0, pieces.size());
+    }
+    return ok;
+}
+
+std::string manifestPath(const std::string& key) {
+    return "checkpoints/" + key + ".manifest";
+}
+
+std::string deltaPath(const std::string& key, uint64_t seq) {
+    return "checkpoints/" + key + ".delta." + std::to_string(seq);
+}
+
+// Incremental checkpoint files, integers little-endian:
+//   manifest: 'KVDM', u32 version (1), u64 chunk bytes, u64 base hash,
+//             u64 x 4 base identity (device, inode, size, mtime in ns),
+//             u64 delta count, u64 chunk count, delta count x u64 sequence
+//             number, chunk count x u64 chunk hash, u64 checksum
+//   delta:    'KVDL', u32 version (1), u64 chunk bytes, u64 tensor bytes,
+//             u64 chunk count, per chunk u64 index and its data, u64 checksum
+// Checksums are chunkHash() of everything before them. The manifest's chunk
+// hashes describe the base with its deltas applied, so a load never has to
+// hash the data. The base hash is chunkHash() of the base's own chunk
+// hashes; it is only checked when the base file is not the one the
+// manifest recorded (say, checkpoints/ was copied). Every full write of a
+// base removes the manifest before renaming the new base into place, so
+// deltas never outlive the base they were taken against, whatever inode
+// and mtime the new file ends up with.
+constexpr uint32_t DELTA_VERSION = 1;
+
+// Fast non-cryptographic hash for change detection: four independent
+// multiply-rotate lanes over 32-byte blocks, then the tail
+uint64_t chunkHash(const char* data, size_t len) {
+    const uint64_t K1 = 0x9E3779B97F4A7C15ull, K2 = 0xC2B2AE3D27D4EB4Full;
+    auto mix = [&](uint64_t h, uint64_t w) {
+        h ^= w * K2;
+        h = (h << 31) | (h >> 33);
+        return h * K1;
+    };
+    uint64_t lanes[4] = {K1, K2, ~K1, ~K2};
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        for (int l = 0; l < 4; ++l) {
+            uint64_t w;
+            std::memcpy(&w, data + i + 8 * l, 8);
+            lanes[l] = mix(lanes[l], w);
+        }
+    }
+    uint64_t h = len;
+    for (uint64_t lane : lanes) h = mix(h, lane);
+    for (; i < len; i += 8) {
+        uint64_t w = 0;
+        std::memcpy(&w, data + i, std::min<size_t>(8, len - i));
+        h = mix(h, w);
+    }
+    h ^= h >> 33;
+    h *= K2;
+    return h ^ (h >> 29);
+}
+
+std::vector<uint64_t> chunkHashes(const char* data, size_t len, size_t chunkBytes) {
+    std::vector<uint64_t> hashes;
+    for (size_t begin = 0; begin < len; begin += chunkBytes) {
+        hashes.push_back(chunkHash(data + begin, std::min(chunkBytes, len - begin)));
+    }
+    return hashes;
+}
+
+uint64_t hashOfHashes(const std::vector<uint64_t>& hashes) {
+    return chunkHash(reinterpret_cast<const char*>(hashes.data()), hashes.size() * sizeof(uint64_t));
+}
+
+void putChecksum(std::vector<char>& out) {
+    putU64(out, chunkHash(out.data(), out.size()));
+}
+
+// Checks the magic, version and trailing checksum; returns the body
+// length (what precedes the checksum), or 0 if the file is invalid
+size_t checkedLength(const std::vector<char>& in, const char* magic) {
+    if (in.size() < 16 || std::memcmp(in.data(), magic, 4) != 0 || getLE(in.data() + 4, 4) != DELTA_VERSION) return 0;
+    const size_t body = in.size() - 8;
+    return getLE(in.data() + body, 8) == chunkHash(in.data(), body) ? body : 0;
+}
 
-    auto it = store.find(key);
-    if (it == store.end()) return false;
+struct Manifest {
+    uint64_t chunkBytes = 0;
+    uint64_t baseHash = 0;
+    uint64_t base[4] = {}; // KVStore::FileIdentity fields, in order
+    std::vector<uint64_t> deltas;
+    std::vector<uint64_t> hashes;
+};
 
-    std::string filename = "checkpoints/" + key + ".chk";
-    std::ofstream out(filename, std::ios::binary);
-    if (!out) return false;
+constexpr size_t MANIFEST_HEADER = 72;
 
-    auto buffer = it->second.serializeBinary();
-    out.write(buffer.data(), buffer.size());
+bool parseManifest(const std::vector<char>& in, Manifest& m) {
+    const size_t body = checkedLength(in, "KVDM");
+    if (body < MANIFEST_HEADER) return false;
+    m.chunkBytes = getLE(in.data() + 8, 8);
+    m.baseHash = getLE(in.data() + 16, 8);
+    for (int i = 0; i < 4; ++i) m.base[i] = getLE(in.data() + 24 + i * 8, 8);
+    const uint64_t deltas = getLE(in.data() + 56, 8);
+    const uint64_t hashes = getLE(in.data() + 64, 8);
+    const uint64_t entries = (body - MANIFEST_HEADER) / 8;
+    if (m.chunkBytes == 0 || (body - MANIFEST_HEADER) % 8 != 0 || deltas > entries || hashes != entries - deltas) {
+        return false;
+    }
+    const char* at = in.data() + MANIFEST_HEADER;
+    for (uint64_t i = 0; i < deltas; ++i, at += 8) m.deltas.push_back(getLE(at, 8));
+    for (uint64_t i = 0; i < hashes; ++i, at += 8) m.hashes.push_back(getLE(at, 8));
     return true;
 }
 
-bool KVStore::loadFromDisk(const std::string& key) {
-    std::lock_guard<std::mutex> lock(storeMutex);
+// Validates the whole delta before returning its chunks as (index, data)
+bool parseDelta(const std::vector<char>& in, uint64_t chunkBytes, uint64_t total,
+                std::vector<std::pair<uint64_t, const char*>>& chunks) {
+    const size_t body = checkedLength(in, "KVDL");
+    if (body < 32 || getLE(in.data() + 8, 8) != chunkBytes || getLE(in.data() + 16, 8) != total) return false;
+    const uint64_t count = getLE(in.data() + 24, 8);
+    size_t pos = 32;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (body - pos < 8) return false;
+        const uint64_t index = getLE(in.data() + pos, 8);
+        pos += 8;
+        if (index >= (total + chunkBytes - 1) / chunkBytes) return false;
+        const uint64_t len = std::min(chunkBytes, total - index * chunkBytes);
+        if (body - pos < len) return false;
+        chunks.emplace_back(index, in.data() + pos);
+        pos += static_cast<size_t>(len);
+    }
+    return pos == body;
+}
 
-    std::string filename = "checkpoints/" + key + ".chk";
-    std::ifstream in(filename, std::ios::binary);
+bool readFile(const std::string& path, std::vector<char>& out) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
     if (!in) return false;
+    out.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    return static_cast<bool>(in.read(out.data(), out.size()));
+}
+
+// Temp file and rename, like checkpoint writes; the caller syncs the
+// directory if asked to
+bool writeFileAtomically(const std::string& path, const std::vector<char>& bytes, Durability durability) {
+    const std::string tmpname = tempPathFor(path);
+    int fd = ::open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, bytes.data(), bytes.size());
+    if (ok && durability != Durability::NONE) ok = fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+    if (!ok || std::rename(tmpname.c_str(), path.c_str()) != 0) {
+        std::remove(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string directoryOf(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+}
+
+} // namespace
+
+KVStore::KVStore(size_t shardCount) {
+    if (shardCount == 0) shardCount = 1;
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.emplace_back(new Shard());
+    }
+}
+
+KVStore::~KVStore() {
+    stopCheckpointing();
+}
+
+KVStore::Shard& KVStore::shardFor(const std::string& key) const {
+    return *shards[std::hash<std::string>{}(key) % shards.size()];
+}
+
+void KVStore::put(const std::string& key, const Tensor& tensor) {
+    // Tensor copies share storage, so this does not copy the data
+    put(key, std::make_shared<const Tensor>(tensor));
+}
+
+void KVStore::put(const std::string& key, std::shared_ptr<const Tensor> tensor) {
+    Shard& shard = shardFor(key);
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.values[key].swap(tensor);
+    }
+    // `tensor` now holds the previous value; it is released outside the lock
+}
+
+std::shared_ptr<const Tensor> KVStore::get(const std::string& key) const {
+    Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.values.find(key);
+    if (it == shard.values.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+bool KVStore::get(const std::string& key, Tensor& outTensor) const {
+    std::shared_ptr<const Tensor> value = get(key);
+    if (!value) return false;
+
+    outTensor = *value;
+    return true;
+}
+
+size_t KVStore::bytes() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        for (const auto& entry : shard->values) total += entry.second->nbytes();
+    }
+    return total;
+}
+
+bool KVStore::saveToDisk(const std::string& key, Durability durability) {
+    // The handle pins this version; concurrent puts don't affect the write
+    std::shared_ptr<const Tensor> value = get(key);
+    if (!value) return false;
+    return writeFull(key, *value, durability);
+}
+
+bool KVStore::saveIncremental(const std::string& key, const DeltaConfig& config, Durability durability) {
+    std::shared_ptr<const Tensor> value = get(key);
+    if (!value) return false;
+    return writeIncremental(key, *value, config, durability);
+}
 
-    std::vector<char> buffer(
-        (std::istreambuf_iterator<char>(in)),
-        std::istreambuf_iterator<char>()
-    );
+bool KVStore::writeIncremental(const std::string& key, const Tensor& view, const DeltaConfig& config,
+                               Durability durability) {
+    const Tensor tensor = view.contiguous();
+    const char* data = static_cast<const char*>(tensor.rawData());
+    const size_t total = tensor.nbytes();
+    const size_t chunkBytes = std::max<size_t>(config.chunkBytes, 1);
+    const std::vector<uint64_t> hashes = chunkHashes(data, total, chunkBytes);
+    const Durability fileDurability = durability == Durability::FILE_AND_DIR ? Durability::FILE : durability;
 
-    Tensor tensor = Tensor::deserializeBinary(buffer);
-    store[key] = tensor;
+    std::lock_guard<std::mutex> lock(deltaMutex);
+    auto it = deltaStates.find(key);
+    bool full = it == deltaStates.end() || it->second.dtype != tensor.dtype() ||
+                it->second.shape != tensor.getShape() || it->second.chunkBytes != chunkBytes;
+    std::vector<size_t> changed;
+    uint64_t changedBytes = 0;
+    if (!full) {
+        for (size_t c = 0; c < hashes.size(); ++c) {
+            if (hashes[c] == it->second.hashes[c]) continue;
+            changed.push_back(c);
+            changedBytes += std::min(chunkBytes, total - c * chunkBytes);
+        }
+        if (changed.empty()) return true;
+        full = it->second.deltas.size() >= config.maxDeltas || it->second.deltaBytes + changedBytes >= total;
+    }
+
+    auto writeManifest = [&](const DeltaState& state) {
+        std::vector<char> out = {'K', 'V', 'D', 'M'};
+        putU32(out, DELTA_VERSION);
+        putU64(out, state.chunkBytes);
+        putU64(out, state.baseHash);
+        for (uint64_t field : {state.base.device, state.base.inode, state.base.size, state.base.mtimeNs}) {
+            putU64(out, field);
+        }
+        putU64(out, state.deltas.size());
+        putU64(out, state.hashes.size());
+        for (uint64_t seq : state.deltas) putU64(out, seq);
+        for (uint64_t hash : state.hashes) putU64(out, hash);
+        putChecksum(out);
+        return writeFileAtomically(manifestPath(key), out, fileDurability);
+    };
+
+    if (full) {
+        uint64_t nextSeq = 0;
+        const std::vector<uint64_t> obsolete = deltasOnDisk(key, nextSeq);
+        deltaStates.erase(key);
+
+        // The old manifest is gone before the new base is in place, so a
+        // crash before the new one is written loads just the base
+        DeltaState state;
+        if (!writeCheckpoint(key, tensor, fileDurability, &state.base)) return false;
+        state.dtype = tensor.dtype();
+        state.shape = tensor.getShape();
+        state.chunkBytes = chunkBytes;
+        state.hashes = hashes;
+        state.baseHash = hashOfHashes(hashes);
+        state.nextSeq = nextSeq;
+        if (!writeManifest(state)) return false;
+        for (uint64_t seq : obsolete) std::remove(deltaPath(key, seq).c_str());
+        deltaStates[key] = std::move(state);
+    } else {
+        DeltaState& state = it->second;
+        std::vector<char> out = {'K', 'V', 'D', 'L'};
+        putU32(out, DELTA_VERSION);
+        putU64(out, chunkBytes);
+        putU64(out, total);
+        putU64(out, changed.size());
+        out.reserve(out.size() + changed.size() * 8 + changedBytes + 8);
+        for (size_t c : changed) {
+            putU64(out, c);
+            const char* chunk = data + c * chunkBytes;
+            out.insert(out.end(), chunk, chunk + std::min(chunkBytes, total - c * chunkBytes));
+        }
+        putChecksum(out);
+
+        // The delta only counts once the manifest lists it
+        const uint64_t seq = state.nextSeq++;
+        if (!writeFileAtomically(deltaPath(key, seq), out, fileDurability)) return false;
+        const std::vector<uint64_t> previous = state.hashes;
+        state.deltas.push_back(seq);
+        for (size_t c : changed) state.hashes[c] = hashes[c];
+        if (!writeManifest(state)) {
+            state.deltas.pop_back();
+            state.hashes = previous;
+            std::remove(deltaPath(key, seq).c_str());
+            return false;
+        }
+        state.deltaBytes += changedBytes;
+    }
+    if (durability == Durability::FILE_AND_DIR) {
+        return syncDirectory("checkpoints");
+    }
+    return true;
+}
+
+std::vector<uint64_t> KVStore::deltasOnDisk(const std::string& key, uint64_t& nextSeq) {
+    nextSeq = 0;
+    auto it = deltaStates.find(key);
+    if (it != deltaStates.end()) {
+        nextSeq = it->second.nextSeq;
+        return it->second.deltas;
+    }
+    std::vector<char> bytes;
+    Manifest old;
+    if (!readFile(manifestPath(key), bytes) || !parseManifest(bytes, old)) return {};
+    for (uint64_t seq : old.deltas) nextSeq = std::max(nextSeq, seq + 1);
+    return old.deltas;
+}
+
+bool KVStore::writeFull(const std::string& key, const Tensor& tensor, Durability durability) {
+    std::vector<uint64_t> obsolete;
+    {
+        std::lock_guard<std::mutex> lock(deltaMutex);
+        uint64_t nextSeq;
+        obsolete = deltasOnDisk(key, nextSeq);
+        deltaStates.erase(key);
+    }
+    if (!writeCheckpoint(key, tensor, durability)) return false;
+    for (uint64_t seq : obsolete) std::remove(deltaPath(key, seq).c_str());
+    return true;
+}
+
+void KVStore::forgetDeltas(const std::string& key) {
+    std::lock_guard<std::mutex> lock(deltaMutex);
+    deltaStates.erase(key);
+}
+
+bool KVStore::writeCheckpoint(const std::string& key, const Tensor& view, Durability durability,
+                              FileIdentity* written) {
+    const Tensor tensor = view.contiguous();
+    std::string filename = checkpointPath(key);
+    std::string tmpname = tempPathFor(filename);
+
+    int fd = ::open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    std::vector<char> header(tensor.binaryHeaderSize());
+    tensor.writeBinaryHeader(header.data());
+    bool ok = writeAll(fd, header.data(), header.size()) &&
+              writeAll(fd, static_cast<const char*>(tensor.rawData()), tensor.nbytes());
+    if (ok && durability != Durability::NONE) ok = fsync(fd) == 0;
+    if (ok && written) ok = written->read(fd);
+    if (close(fd) != 0) ok = false;
+
+    // Deltas apply only to the base they were taken against, so their
+    // manifest goes first: no crash, and no new file that happens to get
+    // the old inode and mtime, can pair them with this base
+    if (ok && std::remove(manifestPath(key).c_str()) == 0 && durability == Durability::FILE_AND_DIR) {
+        ok = syncDirectory("checkpoints");
+    }
+    // Replacing the directory entry leaves any existing mapping of the old
+    // file intact (truncating it in place would fault mapped readers)
+    if (!ok || std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpname.c_str());
+        return false;
+    }
+    if (durability == Durability::FILE_AND_DIR) {
+        return syncDirectory("checkpoints");
+    }
+    return true;
+}
+
+void KVStore::startCheckpointing(const CheckpointConfig& config) {
+    std::lock_guard<std::mutex> lifecycle(checkpointLifecycleMutex);
+    std::lock_guard<std::mutex> lock(checkpointMutex);
+    if (checkpointRunning) return;
+    checkpointConfig = config;
+    checkpointRunning = true;
+    checkpointThread = std::thread(&KVStore::checkpointLoop, this);
+}
+
+void KVStore::stopCheckpointing() {
+    std::lock_guard<std::mutex> lifecycle(checkpointLifecycleMutex);
+    {
+        std::lock_guard<std::mutex> lock(checkpointMutex);
+        if (!checkpointRunning) return;
+        checkpointRunning = false;
+    }
+    checkpointCv.notify_all();
+    checkpointThread.join(); // the loop drains dirty keys before exiting
+}
+
+void KVStore::scheduleSave(const std::string& key) {
+    {
+        std::lock_guard<std::mutex> lock(checkpointMutex);
+        if (checkpointRunning) {
+            dirtyKeys.insert(key);
+            ++scheduledSeq;
+            return;
+        }
+    }
+    saveToDisk(key);
+}
+
+bool KVStore::flush() {
+    std::unique_lock<std::mutex> lock(checkpointMutex);
+    if (checkpointRunning || checkpointThread.joinable()) {
+        const uint64_t target = scheduledSeq;
+        flushRequested = true;
+        checkpointCv.notify_all();
+        checkpointCv.wait(lock, [&] { return writtenSeq >= target; });
+    }
+    bool ok = !checkpointFailed;
+    checkpointFailed = false;
+    return ok;
+}
+
+void KVStore::checkpointLoop() {
+    std::unique_lock<std::mutex> lock(checkpointMutex);
+    while (true) {
+        // Sleep until there is work, then give writes one interval to coalesce
+        checkpointCv.wait(lock, [&] { return !checkpointRunning || !dirtyKeys.empty(); });
+        if (checkpointRunning && !flushRequested) {
+            checkpointCv.wait_for(lock, checkpointConfig.flushInterval,
+                                  [&] { return !checkpointRunning || flushRequested; });
+        }
+        if (dirtyKeys.empty() && !checkpointRunning) break;
+
+        std::unordered_set<std::string> batch;
+        batch.swap(dirtyKeys);
+        const uint64_t batchSeq = scheduledSeq;
+        const Durability durability = checkpointConfig.durability;
+        const bool incremental = checkpointConfig.incremental;
+        const DeltaConfig delta = checkpointConfig.delta;
+        Histogram* writeLatency =
+            checkpointConfig.metrics ? &checkpointConfig.metrics->histogram("kvstore.checkpoint_write") : nullptr;
+        flushRequested = false;
+        lock.unlock();
+
+        bool failed = false;
+        for (const std::string& key : batch) {
+            // Latest value at write time; older versions are never written
+            std::shared_ptr<const Tensor> value = get(key);
+            if (!value) continue;
+            const auto start = std::chrono::steady_clock::now();
+            const Durability fileDurability = durability == Durability::FILE_AND_DIR ? Durability::FILE : durability;
+            bool ok;
+            if (incremental) {
+                ok = writeIncremental(key, *value, delta, fileDurability);
+            } else {
+                ok = writeFull(key, *value, fileDurability);
+            }
+            if (!ok) {
+                std::cerr << "Checkpoint write failed: " << key << std::endl;
+                failed = true;
+            }
+            if (writeLatency) writeLatency->recordSince(start);
+        }
+        // One directory sync covers every rename in the batch
+        if (durability == Durability::FILE_AND_DIR && !batch.empty() && !syncDirectory("checkpoints")) {
+            failed = true;
+        }
+
+        lock.lock();
+        if (failed) checkpointFailed = true;
+        writtenSeq = batchSeq;
+        checkpointCv.notify_all();
+    }
+    writtenSeq = scheduledSeq;
+    checkpointCv.notify_all();
+}
+
+bool KVStore::loadFromDisk(const std::string& key, LoadMode mode) {
+    std::string filename = checkpointPath(key);
+    Tensor tensor;
+    // With a manifest, deltas are replayed into the base's memory; a mapped
+    // base is then mapped copy-on-write, so only the pages they rewrite
+    // are copied and the rest still loads lazily
+    std::vector<char> manifest;
+    const bool hasManifest = readFile(manifestPath(key), manifest);
+
+    // The identity comes from the file actually read, so a base replaced
+    // in the meantime is never paired with the other base's manifest
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    FileIdentity base;
+    bool ok = base.read(fd);
+    std::shared_ptr<MappedFile> file;
+    std::vector<char> buffer;
+    if (ok && mode == LoadMode::MMAP) {
+        file = MappedFile::map(fd, hasManifest);
+        ok = file != nullptr;
+    } else if (ok) {
+        buffer.resize(static_cast<size_t>(base.size));
+        ok = readAllAt(fd, buffer.data(), buffer.size(), 0);
+    }
+    close(fd);
+    if (!ok) return false;
+
+    // Parse before touching the store; only the pointer swap takes a lock
+    try {
+        tensor = file ? Tensor::viewBinary(file, file->data(), file->size()) : Tensor::deserializeBinary(buffer);
+    } catch (const std::exception& e) {
+        std::cerr << "Checkpoint " << key << " is invalid: " << e.what() << std::endl;
+        return false;
+    }
+    if (hasManifest) {
+        replayDeltas(key, tensor, manifest, base);
+    } else {
+        forgetDeltas(key);
+    }
+
+    put(key, std::make_shared<const Tensor>(std::move(tensor)));
     std::cout << "Checkpoint loaded: " << key << std::endl;
     return true;
 }
+
+bool KVStore::FileIdentity::read(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return false;
+    device = static_cast<uint64_t>(st.st_dev);
+    inode = static_cast<uint64_t>(st.st_ino);
+    size = static_cast<uint64_t>(st.st_size);
+    mtimeNs = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+    return true;
+}
+
+bool KVStore::FileIdentity::operator==(const FileIdentity& other) const {
+    return device == other.device && inode == other.inode && size == other.size && mtimeNs == other.mtimeNs;
+}
+
+void KVStore::replayDeltas(const std::string& key, Tensor& tensor, const std::vector<char>& bytes,
+                           const FileIdentity& base) {
+    std::lock_guard<std::mutex> lock(deltaMutex);
+    deltaStates.erase(key);
+    Manifest manifest;
+    if (!parseManifest(bytes, manifest)) {
+        std::cerr << "Delta manifest for " << key << " is invalid; loaded the base only" << std::endl;
+        return;
+    }
+
+    const size_t total = tensor.nbytes();
+    const size_t chunkBytes = static_cast<size_t>(manifest.chunkBytes);
+    // The loaded tensor is the only handle to its memory: private, or a
+    // copy-on-write mapping whose pages are writable
+    char* data = const_cast<char*>(static_cast<const char*>(static_cast<const Tensor&>(tensor).rawData()));
+    FileIdentity recorded;
+    recorded.device = manifest.base[0];
+    recorded.inode = manifest.base[1];
+    recorded.size = manifest.base[2];
+    recorded.mtimeNs = manifest.base[3];
+    if (!(recorded == base) && hashOfHashes(chunkHashes(data, total, chunkBytes)) != manifest.baseHash) {
+        return; // the deltas predate this base
+    }
+    if (manifest.hashes.size() != (total + chunkBytes - 1) / chunkBytes) {
+        std::cerr << "Delta manifest for " << key << " does not fit its base; loaded the base only" << std::endl;
+        return;
+    }
+
+    DeltaState state;
+    state.dtype = tensor.dtype();
+    state.shape = tensor.getShape();
+    state.chunkBytes = chunkBytes;
+    state.hashes = manifest.hashes;
+    state.baseHash = manifest.baseHash;
+    state.base = base;
+    for (uint64_t seq : manifest.deltas) {
+        std::vector<char> delta;
+        std::vector<std::pair<uint64_t, const char*>> chunks;
+        if (!readFile(deltaPath(key, seq), delta) || !parseDelta(delta, chunkBytes, total, chunks)) {
+            // The manifest's hashes include this delta, so the next
+            // incremental save starts over with a full base
+            std::cerr << "Delta " << seq << " of " << key << " is invalid; restored up to the one before" << std::endl;
+            return;
+        }
+        for (const auto& chunk : chunks) {
+            const size_t len = std::min(chunkBytes, total - static_cast<size_t>(chunk.first) * chunkBytes);
+            std::memcpy(data + chunk.first * chunkBytes, chunk.second, len);
+            state.deltaBytes += len;
+        }
+        state.deltas.push_back(seq);
+        state.nextSeq = std::max(state.nextSeq, seq + 1);
+    }
+    deltaStates[key] = std::move(state);
+}
+
+bool KVStore::saveSnapshot(const std::string& path, ThreadPool* pool, Durability durability) {
+    // Copy the handles shard by shard; no lock is held while writing
+    std::vector<SnapshotEntry> entries;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        for (const auto& kv : shard->values) {
+            SnapshotEntry e;
+            e.key = kv.first;
+            e.tensor = kv.second;
+            entries.push_back(std::move(e));
+        }
+    }
+    // Sorted, so the same contents always give the same file
+    std::sort(entries.begin(), entries.end(),
+              [](const SnapshotEntry& a, const SnapshotEntry& b) { return a.key < b.key; });
+
+    size_t indexBytes = 0;
+    for (SnapshotEntry& e : entries) {
+        if (!e.tensor->isContiguous()) e.tensor = std::make_shared<const Tensor>(e.tensor->contiguous());
+        e.dtype = e.tensor->dtype();
+        e.shape = e.tensor->getShape();
+        e.bytes = e.tensor->nbytes();
+        indexBytes += 4 + e.key.size() + 4 + e.shape.size() * 8 + 16;
+    }
+    uint64_t cursor = SNAPSHOT_HEADER + indexBytes;
+    for (SnapshotEntry& e : entries) {
+        e.offset = (cursor + e.headerBytes() + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+        cursor = e.offset + e.bytes;
+    }
+    const uint64_t fileSize = cursor;
+
+    std::vector<char> index;
+    index.reserve(indexBytes);
+    for (const SnapshotEntry& e : entries) {
+        putU32(index, static_cast<uint32_t>(e.key.size()));
+        index.insert(index.end(), e.key.begin(), e.key.end());
+        index.push_back(static_cast<char>(e.dtype));
+        index.push_back(static_cast<char>(e.shape.size()));
+        index.push_back(0);
+        index.push_back(0);
+        for (size_t extent : e.shape) putU64(index, extent);
+        putU64(index, e.offset);
+        putU64(index, e.bytes);
+    }
+    std::vector<char> head = {'K', 'V', 'S', 'N'};
+    putU32(head, 1);
+    putU64(head, entries.size());
+    putU64(head, index.size());
+    putU64(head, fnv1a(index.data(), index.size()));
+    head.insert(head.end(), index.begin(), index.end());
+
+    const std::string tmpname = tempPathFor(path);
+    int fd = ::open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Snapshot " << path << ": cannot create " << tmpname << std::endl;
+        return false;
+    }
+    // Sizing the file first lets every piece be written independently
+    bool ok = ftruncate(fd, static_cast<off_t>(fileSize)) == 0 && writeAllAt(fd, head.data(), head.size(), 0);
+    ok = ok && forEachPiece(entries, pool, [fd](const SnapshotEntry& e, uint64_t begin, size_t len) {
+        if (begin == 0) {
+            char header[16 + Tensor::MAX_DIMS * 8 + 8];
+            const size_t n = e.tensor->writeBinaryHeader(header);
+            if (!writeAllAt(fd, header, n, e.offset - n)) return false;
+        }
+        return writeAllAt(fd, static_cast<const char*>(e.tensor->rawData()) + begin, len, e.offset + begin);
+    });
+    if (ok && durability != Durability::NONE) ok = fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    ok = ok && std::rename(tmpname.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        std::remove(tmpname.c_str());
+        std::cerr << "Snapshot write failed: " << path << std::endl;
+        return false;
+    }
+    return durability != Durability::FILE_AND_DIR || syncDirectory(directoryOf(path));
+}
+
+bool KVStore::loadSnapshot(const std::string& path, LoadMode mode, ThreadPool* pool) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    std::vector<SnapshotEntry> entries;
+    std::vector<Tensor> tensors;
+    try {
+        struct stat st;
+        char head[SNAPSHOT_HEADER];
+        if (fstat(fd, &st) != 0 || !readAllAt(fd, head, sizeof(head), 0)) throw std::runtime_error("short header");
+        const uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+        if (head[0] != 'K' || head[1] != 'V' || head[2] != 'S' || head[3] != 'N') throw std::runtime_error("bad magic");
+        if (getLE(head + 4, 4) != 1) throw std::runtime_error("unsupported version");
+        const uint64_t count = getLE(head + 8, 8);
+        const uint64_t indexBytes = getLE(head + 16, 8);
+        if (indexBytes > fileSize - SNAPSHOT_HEADER) throw std::runtime_error("index larger than the file");
+
+        std::vector<char> index(static_cast<size_t>(indexBytes));
+        if (!readAllAt(fd, index.data(), index.size(), SNAPSHOT_HEADER)) throw std::runtime_error("short index");
+        if (fnv1a(index.data(), index.size()) != getLE(head + 24, 8)) throw std::runtime_error("index checksum");
+        entries = parseSnapshotIndex(index.data(), index.size(), count, fileSize);
+
+        if (mode == LoadMode::MMAP) {
+            std::shared_ptr<MappedFile> file = MappedFile::open(path);
+            if (!file || file->size() != fileSize) throw std::runtime_error("cannot map");
+            for (const SnapshotEntry& e : entries) {
+                const size_t h = e.headerBytes();
+                tensors.push_back(Tensor::viewBinary(file, file->data() + e.offset - h, h + e.bytes));
+                if (tensors.back().getShape() != e.shape || tensors.back().dtype() != e.dtype) {
+                    throw std::runtime_error("record does not match the index");
+                }
+            }
+        } else {
+            // Storage is allocated up front; the pieces then land in it in
+            // parallel
+            std::vector<char*> dest;
+            for (const SnapshotEntry& e : entries) {
+                tensors.push_back(Tensor::uninitialized(e.shape, e.dtype));
+                dest.push_back(static_cast<char*>(tensors.back().rawData()));
+            }
+            const SnapshotEntry* first = entries.data();
+            if (!forEachPiece(entries, pool, [fd, first, &dest](const SnapshotEntry& e, uint64_t begin, size_t len) {
+                    return readAllAt(fd, dest[&e - first] + begin, len, e.offset + begin);
+                })) {
+                throw std::runtime_error("short data");
+            }
+        }
+    } catch (const std::exception& e) {
+        close(fd);
+        std::cerr << "Snapshot " << path << " is invalid: " << e.what() << std::endl;
+        return false;
+    }
+    close(fd);
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        put(entries[i].key, std::make_shared<const Tensor>(std::move(tensors[i])));
+    }
+    std::cout << "Snapshot loaded: " << entries.size() << " tensors from " << path << std::endl;
+    return true;
+}
@@ -0,0 +1,583 @@
+#include "Kernels.h"
+#include "SimdTarget.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace kernels {
+namespace {
+
+struct KernelTable {
+    void (*add)(const float*, const float*, float*, size_t);
+    void (*mul)(const float*, const float*, float*, size_t);
+    void (*scale)(const float*, float, float*, size_t);
+    void (*fma)(const float*, const float*, const float*, float*, size_t);
+    void (*relu)(const float*, float*, size_t);
+    void (*gelu)(const float*, float*, size_t);
+    float (*sum)(const float*, size_t);
+    float (*max)(const float*, size_t);
+    float (*dot)(const float*, const float*, size_t);
+    void (*floatToHalf)(const float*, uint16_t*, size_t);
+    void (*halfToFloat)(const uint16_t*, float*, size_t);
+    void (*floatToBfloat16)(const float*, uint16_t*, size_t);
+    void (*bfloat16ToFloat)(const uint16_t*, float*, size_t);
+    void (*quantizeQ8)(const float*, char*, size_t);
+    void (*dequantizeQ8)(const char*, float*, size_t);
+};
+
+#define KERNEL_TABLE                                                                      \
+    { add, mul, scale, fma, relu, gelu, sum, max, dot,                                    \
+      floatToHalf, halfToFloat, floatToBfloat16, bfloat16ToFloat, quantizeQ8, dequantizeQ8 }
+
+// Single-value conversions, shared by the scalar table and SIMD tails. They
+// follow the hardware instructions bit for bit (quiet NaNs keep their
+// payload), so every level encodes identically.
+inline uint32_t floatBits(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline uint16_t toHalf(float f) {
+    uint32_t bits = floatBits(f);
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t abs = bits & 0x7FFFFFFF;
+    if (abs > 0x7F800000) return static_cast<uint16_t>(sign | 0x7E00 | ((abs >> 13) & 0x3FF)); // NaN
+    if (abs >= 0x477FF000) return static_cast<uint16_t>(sign | 0x7C00); // rounds to infinity
+    if (abs < 0x38800000) {
+        // Subnormal or zero: adding 0.5 lines the result up with the low
+        // mantissa bits and lets the FPU do the rounding
+        return static_cast<uint16_t>(sign | (floatBits(bitsFloat(abs) + 0.5f) - 0x3F000000));
+    }
+    abs += 0xC8000FFF + ((abs >> 13) & 1); // rebias exponent, round to nearest even
+    return static_cast<uint16_t>(sign | (abs >> 13));
+}
+
+inline float fromHalf(uint16_t h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    const uint32_t exp = (h >> 10) & 0x1F;
+    const uint32_t mant = h & 0x3FF;
+    if (exp == 0) return bitsFloat(sign | floatBits(static_cast<float>(mant) * (1.0f / 16777216.0f)));
+    if (exp == 31) return bitsFloat(sign | 0x7F800000 | (mant << 13) | (mant ? 0x400000 : 0));
+    return bitsFloat(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+inline uint16_t toBfloat16(float f) {
+    uint32_t bits = floatBits(f);
+    if ((bits & 0x7FFFFFFF) > 0x7F800000) return static_cast<uint16_t>((bits >> 16) | 0x40); // quiet NaN
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float fromBfloat16(uint16_t h) {
+    return bitsFloat(static_cast<uint32_t>(h) << 16);
+}
+
+// One value scaled by a block's 127 / absmax: NaN becomes 0, anything
+// else is clamped to [-127, 127] first, so the conversion is always defined
+inline int8_t quantizeValue(float x, float inv) {
+    float y = x * inv;
+    if (y != y) return 0;
+    y = std::min(std::max(y, -127.0f), 127.0f);
+    return static_cast<int8_t>(std::nearbyint(y));
+}
+
+// One Q8 block of `count` <= Q8_BLOCK values. absmax covers the finite
+// values only, so ±Inf saturates to ±127 instead of zeroing the block.
+inline void quantizeBlock(const float* in, char* out, size_t count) {
+    float absmax = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        const float a = std::fabs(in[i]);
+        if (a < std::numeric_limits<float>::infinity()) absmax = std::max(absmax, a);
+    }
+    const float scale = absmax / 127.0f;
+    const float inv = absmax > 0.0f ? 127.0f / absmax : 0.0f;
+    std::memcpy(out, &scale, sizeof(scale));
+    int8_t* q = reinterpret_cast<int8_t*>(out + sizeof(scale));
+    for (size_t i = 0; i < count; ++i) q[i] = quantizeValue(in[i], inv);
+    for (size_t i = count; i < Q8_BLOCK; ++i) q[i] = 0;
+}
+
+inline void dequantizeBlock(const char* in, float* out, size_t count) {
+    float scale;
+    std::memcpy(&scale, in, sizeof(scale));
+    const int8_t* q = reinterpret_cast<const int8_t*>(in + sizeof(scale));
+    for (size_t i = 0; i < count; ++i) out[i] = static_cast<float>(q[i]) * scale;
+}
+
+// The last, partial block of an n-value Q8 buffer, if any
+inline void quantizeTail(const float* in, char* out, size_t n) {
+    const size_t full = n / Q8_BLOCK;
+    if (n % Q8_BLOCK) quantizeBlock(in + full * Q8_BLOCK, out + full * Q8_BLOCK_BYTES, n % Q8_BLOCK);
+}
+
+inline void dequantizeTail(const char* in, float* out, size_t n) {
+    const size_t full = n / Q8_BLOCK;
+    if (n % Q8_BLOCK) dequantizeBlock(in + full * Q8_BLOCK_BYTES, out + full * Q8_BLOCK, n % Q8_BLOCK);
+}
+
+namespace scalar {
+using vec = float;
+constexpr size_t W = 1;
+static inline vec vload(const float* p) { return *p; }
+static inline void vstore(float* p, vec v) { *p = v; }
+static inline vec vset1(float v) { return v; }
+static inline vec vadd(vec a, vec b) { return a + b; }
+static inline vec vsub(vec a, vec b) { return a - b; }
+static inline vec vmul(vec a, vec b) { return a * b; }
+static inline vec vdiv(vec a, vec b) { return a / b; }
+static inline vec vmax(vec a, vec b) { return a > b ? a : b; }
+static inline vec vmin(vec a, vec b) { return a < b ? a : b; }
+static inline vec vfmadd(vec a, vec b, vec c) { return a * b + c; }
+static inline vec vround(vec a) { return std::nearbyint(a); }
+static inline vec vpow2i(vec n) {
+    uint32_t bits = static_cast<uint32_t>(static_cast<int32_t>(n) + 127) << 23;
+    float out;
+    std::memcpy(&out, &bits, sizeof(out));
+    return out;
+}
+static inline float vhsum(vec v) { return v; }
+static inline float vhmax(vec v) { return v; }
+#include "KernelsImpl.inc"
+
+static void floatToHalf(const float* in, uint16_t* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = toHalf(in[i]);
+}
+static void halfToFloat(const uint16_t* in, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = fromHalf(in[i]);
+}
+static void floatToBfloat16(const float* in, uint16_t* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = toBfloat16(in[i]);
+}
+static void bfloat16ToFloat(const uint16_t* in, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = fromBfloat16(in[i]);
+}
+static void quantizeQ8(const float* in, char* out, size_t n) {
+    for (size_t b = 0; b < n / Q8_BLOCK; ++b) quantizeBlock(in + b * Q8_BLOCK, out + b * Q8_BLOCK_BYTES, Q8_BLOCK);
+    quantizeTail(in, out, n);
+}
+static void dequantizeQ8(const char* in, float* out, size_t n) {
+    for (size_t b = 0; b < n / Q8_BLOCK; ++b) dequantizeBlock(in + b * Q8_BLOCK_BYTES, out + b * Q8_BLOCK, Q8_BLOCK);
+    dequantizeTail(in, out, n);
+}
+
+const KernelTable table = KERNEL_TABLE;
+} // namespace scalar
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_BEGIN("sse2")
+namespace sse {
+using vec = __m128;
+constexpr size_t W = 4;
+static inline vec vload(const float* p) { return _mm_loadu_ps(p); }
+static inline void vstore(float* p, vec v) { _mm_storeu_ps(p, v); }
+static inline vec vset1(float v) { return _mm_set1_ps(v); }
+static inline vec vadd(vec a, vec b) { return _mm_add_ps(a, b); }
+static inline vec vsub(vec a, vec b) { return _mm_sub_ps(a, b); }
+static inline vec vmul(vec a, vec b) { return _mm_mul_ps(a, b); }
+static inline vec vdiv(vec a, vec b) { return _mm_div_ps(a, b); }
+static inline vec vmax(vec a, vec b) { return _mm_max_ps(a, b); }
+static inline vec vmin(vec a, vec b) { return _mm_min_ps(a, b); }
+static inline vec vfmadd(vec a, vec b, vec c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+// cvtps_epi32 rounds to nearest under the default MXCSR mode
+static inline vec vround(vec a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+static inline vec vpow2i(vec n) {
+    __m128i e = _mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+}
+static inline float vhsum(vec v) {
+    vec hi = _mm_movehl_ps(v, v);
+    vec s = _mm_add_ps(v, hi);
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+static inline float vhmax(vec v) {
+    vec hi = _mm_movehl_ps(v, v);
+    vec m = _mm_max_ps(v, hi);
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+#include "KernelsImpl.inc"
+// SSE2 has no half-precision conversions; the scalar ones are used
+using scalar::floatToHalf;
+using scalar::halfToFloat;
+using scalar::floatToBfloat16;
+using scalar::bfloat16ToFloat;
+using scalar::quantizeQ8;
+using scalar::dequantizeQ8;
+const KernelTable table = KERNEL_TABLE;
+} // namespace sse
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN("avx2,fma,f16c")
+namespace avx2 {
+using vec = __m256;
+constexpr size_t W = 8;
+static inline vec vload(const float* p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float* p, vec v) { _mm256_storeu_ps(p, v); }
+static inline vec vset1(float v) { return _mm256_set1_ps(v); }
+static inline vec vadd(vec a, vec b) { return _mm256_add_ps(a, b); }
+static inline vec vsub(vec a, vec b) { return _mm256_sub_ps(a, b); }
+static inline vec vmul(vec a, vec b) { return _mm256_mul_ps(a, b); }
+static inline vec vdiv(vec a, vec b) { return _mm256_div_ps(a, b); }
+static inline vec vmax(vec a, vec b) { return _mm256_max_ps(a, b); }
+static inline vec vmin(vec a, vec b) { return _mm256_min_ps(a, b); }
+static inline vec vfmadd(vec a, vec b, vec c) { return _mm256_fmadd_ps(a, b, c); }
+static inline vec vround(vec a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+static inline vec vpow2i(vec n) {
+    __m256i e = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(e, 23));
+}
+static inline float vhsum(vec v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+static inline float vhmax(vec v) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+#include "KernelsImpl.inc"
+
+static void floatToHalf(const float* in, uint16_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+    }
+    for (; i < n; ++i) out[i] = toHalf(in[i]);
+}
+static void halfToFloat(const uint16_t* in, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+    }
+    for (; i < n; ++i) out[i] = fromHalf(in[i]);
+}
+// Round to nearest even on the integer bits; NaNs are quieted instead
+static inline __m256i roundBfloat16(__m256 v) {
+    const __m256i bits = _mm256_castps_si256(v);
+    const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    __m256i r = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7FFF))), 16);
+    const __m256i nan = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+    return _mm256_blendv_epi8(r, nan, _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q)));
+}
+static void floatToBfloat16(const float* in, uint16_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i lo = roundBfloat16(_mm256_loadu_ps(in + i));
+        __m256i hi = roundBfloat16(_mm256_loadu_ps(in + i + 8));
+        // packus interleaves the 128-bit lanes; put them back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    for (; i < n; ++i) out[i] = toBfloat16(in[i]);
+}
+static void bfloat16ToFloat(const uint16_t* in, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16)));
+    }
+    for (; i < n; ++i) out[i] = fromBfloat16(in[i]);
+}
+static void quantizeQ8(const float* in, char* out, size_t n) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    const __m256 lowest = _mm256_set1_ps(-127.0f), highest = _mm256_set1_ps(127.0f);
+    for (size_t b = 0; b < n / Q8_BLOCK; ++b) {
+        const float* src = in + b * Q8_BLOCK;
+        char* dst = out + b * Q8_BLOCK_BYTES;
+        __m256 v[4], a[4];
+        for (int k = 0; k < 4; ++k) {
+            v[k] = _mm256_loadu_ps(src + 8 * k);
+            // NaN and ±Inf lanes drop out of absmax, as in quantizeBlock
+            a[k] = _mm256_and_ps(v[k], absMask);
+            a[k] = _mm256_and_ps(a[k], _mm256_cmp_ps(a[k], inf, _CMP_LT_OQ));
+        }
+        const float absmax = vhmax(_mm256_max_ps(_mm256_max_ps(a[0], a[1]), _mm256_max_ps(a[2], a[3])));
+        const float scale = absmax / 127.0f;
+        const __m256 inv = _mm256_set1_ps(absmax > 0.0f ? 127.0f / absmax : 0.0f);
+        std::memcpy(dst, &scale, sizeof(scale));
+        __m256i q[4];
+        for (int k = 0; k < 4; ++k) {
+            __m256 y = _mm256_mul_ps(v[k], inv);
+            y = _mm256_and_ps(y, _mm256_cmp_ps(y, y, _CMP_ORD_Q)); // NaN -> 0
+            y = _mm256_min_ps(_mm256_max_ps(y, lowest), highest);
+            q[k] = _mm256_cvtps_epi32(y);
+        }
+        __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+        packed = _mm256_permutevar8x32_epi32(packed, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + sizeof(scale)), packed);
+    }
+    quantizeTail(in, out, n);
+}
+static void dequantizeQ8(const char* in, float* out, size_t n) {
+    for (size_t b = 0; b < n / Q8_BLOCK; ++b) {
+        const char* src = in + b * Q8_BLOCK_BYTES;
+        float scale;
+        std::memcpy(&scale, src, sizeof(scale));
+        const __m256 s = _mm256_set1_ps(scale);
+        for (int k = 0; k < 4; ++k) {
+            __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + sizeof(scale) + 8 * k));
+            __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+            _mm256_storeu_ps(out + b * Q8_BLOCK + 8 * k, _mm256_mul_ps(f, s));
+        }
+    }
+    dequantizeTail(in, out, n);
+}
+
+const KernelTable table = KERNEL_TABLE;
+} // namespace avx2
+SIMD_TARGET_END
+
+// GCC 12's AVX-512 intrinsics seed their pass-through operand with a
+// self-initialized _mm512_undefined_*() value, which -Wuninitialized flags
+// (GCC PR105593) wherever they are inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+SIMD_TARGET_BEGIN("avx512f")
+namespace avx512 {
+using vec = __m512;
+constexpr size_t W = 16;
+static inline vec vload(const float* p) { return _mm512_loadu_ps(p); }
+static inline void vstore(float* p, vec v) { _mm512_storeu_ps(p, v); }
+static inline vec vset1(float v) { return _mm512_set1_ps(v); }
+static inline vec vadd(vec a, vec b) { return _mm512_add_ps(a, b); }
+static inline vec vsub(vec a, vec b) { return _mm512_sub_ps(a, b); }
+static inline vec vmul(vec a, vec b) { return _mm512_mul_ps(a, b); }
+static inline vec vdiv(vec a, vec b) { return _mm512_div_ps(a, b); }
+static inline vec vmax(vec a, vec b) { return _mm512_max_ps(a, b); }
+static inline vec vmin(vec a, vec b) { return _mm512_min_ps(a, b); }
+static inline vec vfmadd(vec a, vec b, vec c) { return _mm512_fmadd_ps(a, b, c); }
+static inline vec vround(vec a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT); }
+static inline vec vpow2i(vec n) {
+    __m512i e = _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(e, 23));
+}
+static inline float vhsum(vec v) { return _mm512_reduce_add_ps(v); }
+static inline float vhmax(vec v) { return _mm512_reduce_max_ps(v); }
+#include "KernelsImpl.inc"
+
+static void floatToHalf(const float* in, uint16_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+    }
+    for (; i < n; ++i) out[i] = toHalf(in[i]);
+}
+static void halfToFloat(const uint16_t* in, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i))));
+    }
+    for (; i < n; ++i) out[i] = fromHalf(in[i]);
+}
+static void floatToBfloat16(const float* in, uint16_t* out, size_t n) {
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i bias = _mm512_set1_epi32(0x7FFF);
+    const __m512i quiet = _mm512_set1_epi32(0x40);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 v = _mm512_loadu_ps(in + i);
+        const __m512i bits = _mm512_castps_si512(v);
+        const __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), one);
+        __m512i r = _mm512_srli_epi32(_mm512_add_epi32(bits, _mm512_add_epi32(lsb, bias)), 16);
+        const __mmask16 nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+        r = _mm512_mask_or_epi32(r, nan, _mm512_srli_epi32(bits, 16), quiet);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm512_cvtepi32_epi16(r));
+    }
+    for (; i < n; ++i) out[i] = toBfloat16(in[i]);
+}
+static void bfloat16ToFloat(const uint16_t* in, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)));
+        _mm512_storeu_ps(out + i, _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16)));
+    }
+    for (; i < n; ++i) out[i] = fromBfloat16(in[i]);
+}
+// |x|, or 0 for NaN and ±Inf lanes, which drop out of absmax as in
+// quantizeBlock
+static inline __m512 finiteAbs(__m512 x) {
+    const __m512 a = _mm512_abs_ps(x);
+    const __m512 inf = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+    return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(a, inf, _CMP_LT_OQ), a);
+}
+// x * inv with NaN -> 0, clamped to [-127, 127] so the truncating narrow
+// cannot overflow
+static inline __m128i quantizeLanes(__m512 x, __m512 inv) {
+    __m512 y = _mm512_mul_ps(x, inv);
+    y = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(y, y, _CMP_ORD_Q), y);
+    y = _mm512_min_ps(_mm512_max_ps(y, _mm512_set1_ps(-127.0f)), _mm512_set1_ps(127.0f));
+    return _mm512_cvtepi32_epi8(_mm512_cvtps_epi32(y));
+}
+static void quantizeQ8(const float* in, char* out, size_t n) {
+    for (size_t b = 0; b < n / Q8_BLOCK; ++b) {
+        const float* src = in + b * Q8_BLOCK;
+        char* dst = out + b * Q8_BLOCK_BYTES;
+        const __m512 lo = _mm512_loadu_ps(src);
+        const __m512 hi = _mm512_loadu_ps(src + 16);
+        const float absmax = _mm512_reduce_max_ps(_mm512_max_ps(finiteAbs(lo), finiteAbs(hi)));
+        const float scale = absmax / 127.0f;
+        const __m512 inv = _mm512_set1_ps(absmax > 0.0f ? 127.0f / absmax : 0.0f);
+        std::memcpy(dst, &scale, sizeof(scale));
+        __m128i qlo = quantizeLanes(lo, inv);
+        __m128i qhi = quantizeLanes(hi, inv);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + sizeof(scale)), qlo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + sizeof(scale) + 16), qhi);
+    }
+    quantizeTail(in, out, n);
+}
+static void dequantizeQ8(const char* in, float* out, size_t n) {
+    for (size_t b = 0; b < n / Q8_BLOCK; ++b) {
+        const char* src = in + b * Q8_BLOCK_BYTES;
+        float scale;
+        std::memcpy(&scale, src, sizeof(scale));
+        const __m512 s = _mm512_set1_ps(scale);
+        for (int k = 0; k < 2; ++k) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + sizeof(scale) + 16 * k));
+            __m512 f = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(bytes));
+            _mm512_storeu_ps(out + b * Q8_BLOCK + 16 * k, _mm512_mul_ps(f, s));
+        }
+    }
+    dequantizeTail(in, out, n);
+}
+
+const KernelTable table = KERNEL_TABLE;
+} // namespace avx512
+SIMD_TARGET_END
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // SIMD_X86
+
+#undef KERNEL_TABLE
+
+SimdLevel probeCpu() {
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+    // Every AVX2 part also has F16C; checked anyway since the path uses it
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE;
+#endif
+    return SimdLevel::SCALAR;
+}
+
+SimdLevel detectOnce() {
+    SimdLevel level = probeCpu();
+    // DAE_SIMD caps the level, e.g. to compare paths or rule out a bad one
+    if (const char* env = std::getenv("DAE_SIMD")) {
+        std::string cap(env);
+        SimdLevel limit = level;
+        if (cap == "scalar") limit = SimdLevel::SCALAR;
+        else if (cap == "sse") limit = SimdLevel::SSE;
+        else if (cap == "avx2") limit = SimdLevel::AVX2;
+        else if (cap == "avx512") limit = SimdLevel::AVX512;
+        if (limit < level) level = limit;
+    }
+    return level;
+}
+
+const KernelTable* tableFor(SimdLevel level) {
+    switch (level) {
+#ifdef SIMD_X86
+    case SimdLevel::AVX512: return &avx512::table;
+    case SimdLevel::AVX2: return &avx2::table;
+    case SimdLevel::SSE: return &sse::table;
+#endif
+    default: return &scalar::table;
+    }
+}
+
+struct Dispatch {
+    SimdLevel detected;
+    std::atomic<SimdLevel> level;
+    std::atomic<const KernelTable*> table;
+
+    Dispatch() : detected(detectOnce()), level(detected), table(tableFor(detected)) {}
+};
+
+Dispatch& dispatch() {
+    static Dispatch instance;
+    return instance;
+}
+
+inline const KernelTable& active() {
+    return *dispatch().table.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+SimdLevel detectedSimdLevel() {
+    return dispatch().detected;
+}
+
+SimdLevel activeSimdLevel() {
+    return dispatch().level.load();
+}
+
+SimdLevel setSimdLevel(SimdLevel level) {
+    Dispatch& d = dispatch();
+    if (level > d.detected) level = d.detected;
+    d.level.store(level);
+    d.table.store(tableFor(level));
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX512: return "avx512";
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::SSE: return "sse";
+    default: return "scalar";
+    }
+}
+
+void add(const float* a, const float* b, float* out, size_t n) { active().add(a, b, out, n); }
+void mul(const float* a, const float* b, float* out, size_t n) { active().mul(a, b, out, n); }
+void scale(const float* a, float s, float* out, size_t n) { active().scale(a, s, out, n); }
+void fma(const float* a, const float* b, const float* c, float* out, size_t n) { active().fma(a, b, c, out, n); }
+void relu(const float* a, float* out, size_t n) { active().relu(a, out, n); }
+void gelu(const float* a, float* out, size_t n) { active().gelu(a, out, n); }
+float sum(const float* a, size_t n) { return active().sum(a, n); }
+float max(const float* a, size_t n) { return active().max(a, n); }
+float dot(const float* a, const float* b, size_t n) { return active().dot(a, b, n); }
+
+void floatToHalf(const float* in, uint16_t* out, size_t n) { active().floatToHalf(in, out, n); }
+void halfToFloat(const uint16_t* in, float* out, size_t n) { active().halfToFloat(in, out, n); }
+void floatToBfloat16(const float* in, uint16_t* out, size_t n) { active().floatToBfloat16(in, out, n); }
+void bfloat16ToFloat(const uint16_t* in, float* out, size_t n) { active().bfloat16ToFloat(in, out, n); }
+void quantizeQ8(const float* in, char* out, size_t n) { active().quantizeQ8(in, out, n); }
+void dequantizeQ8(const char* in, float* out, size_t n) { active().dequantizeQ8(in, out, n); }
+
+} // namespace kernels
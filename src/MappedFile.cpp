@@ -0,0 +1,31 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path, bool copyOnWrite) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    std::shared_ptr<MappedFile> file = map(fd, copyOnWrite);
+    close(fd); // the mapping keeps its own reference to the file
+    return file;
+}
+
+std::shared_ptr<MappedFile> MappedFile::map(int fd, bool copyOnWrite) {
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) return nullptr;
+
+    size_t length = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, length, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) return nullptr;
+
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->base = static_cast<const char*>(base);
+    file->length = length;
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (base) munmap(const_cast<char*>(base), length);
+}
@@ -0,0 +1,344 @@
+#include "MatMul.h"
+#include "Kernels.h"
+#include "SimdTarget.h"
+#include "Tensor.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Cache blocking. KC x NR slivers of B stay in L1 across a micro-kernel
+// call, the MC x KC block of A stays in L2, and the KC x NC panel of B in L3.
+constexpr size_t KC = 256;
+constexpr size_t MC = 96; // multiple of every MR below
+constexpr size_t NC = 2048;
+constexpr size_t MAX_MR = 12;
+constexpr size_t MAX_NR = 32;
+
+// Computes an MR x NR tile: c = (accumulate ? c : 0) + a_panel * b_panel,
+// where a is packed MR-interleaved and b NR-interleaved over kc steps.
+using MicroKernelFn = void (*)(size_t kc, const float* a, const float* b,
+                               float* c, size_t ldc, bool accumulate);
+
+struct MicroKernel {
+    size_t mr;
+    size_t nr;
+    MicroKernelFn run;
+};
+
+void kernelScalar(size_t kc, const float* a, const float* b, float* c, size_t ldc, bool accumulate) {
+    float acc[4][16] = {};
+    for (size_t p = 0; p < kc; ++p) {
+        for (size_t r = 0; r < 4; ++r) {
+            const float ar = a[r];
+            for (size_t j = 0; j < 16; ++j) acc[r][j] += ar * b[j];
+        }
+        a += 4;
+        b += 16;
+    }
+    for (size_t r = 0; r < 4; ++r) {
+        float* row = c + r * ldc;
+        for (size_t j = 0; j < 16; ++j) row[j] = accumulate ? row[j] + acc[r][j] : acc[r][j];
+    }
+}
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_BEGIN("avx2,fma")
+
+static inline void storeRow8(float* c, __m256 v, bool accumulate) {
+    if (accumulate) v = _mm256_add_ps(v, _mm256_loadu_ps(c));
+    _mm256_storeu_ps(c, v);
+}
+
+// 6 x 16 tile: 12 ymm accumulators, 2 B loads and 1 broadcast per k step
+static void kernelAvx2(size_t kc, const float* a, const float* b, float* c, size_t ldc, bool accumulate) {
+#define DECLARE_ROW(r) __m256 c##r##0 = _mm256_setzero_ps(), c##r##1 = _mm256_setzero_ps();
+#define UPDATE_ROW(r) { \
+        const __m256 ar = _mm256_broadcast_ss(a + r); \
+        c##r##0 = _mm256_fmadd_ps(ar, b0, c##r##0); \
+        c##r##1 = _mm256_fmadd_ps(ar, b1, c##r##1); }
+#define STORE_ROW(r) \
+    storeRow8(c + r * ldc, c##r##0, accumulate); \
+    storeRow8(c + r * ldc + 8, c##r##1, accumulate);
+
+    DECLARE_ROW(0) DECLARE_ROW(1) DECLARE_ROW(2) DECLARE_ROW(3) DECLARE_ROW(4) DECLARE_ROW(5)
+    for (size_t p = 0; p < kc; ++p) {
+        const __m256 b0 = _mm256_loadu_ps(b);
+        const __m256 b1 = _mm256_loadu_ps(b + 8);
+        UPDATE_ROW(0) UPDATE_ROW(1) UPDATE_ROW(2) UPDATE_ROW(3) UPDATE_ROW(4) UPDATE_ROW(5)
+        a += 6;
+        b += 16;
+    }
+    STORE_ROW(0) STORE_ROW(1) STORE_ROW(2) STORE_ROW(3) STORE_ROW(4) STORE_ROW(5)
+
+#undef DECLARE_ROW
+#undef UPDATE_ROW
+#undef STORE_ROW
+}
+
+SIMD_TARGET_END
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+SIMD_TARGET_BEGIN("avx512f")
+
+static inline void storeRow16(float* c, __m512 v, bool accumulate) {
+    if (accumulate) v = _mm512_add_ps(v, _mm512_loadu_ps(c));
+    _mm512_storeu_ps(c, v);
+}
+
+// 12 x 32 tile: 24 zmm accumulators, 2 B loads and 1 broadcast per k step
+static void kernelAvx512(size_t kc, const float* a, const float* b, float* c, size_t ldc, bool accumulate) {
+#define DECLARE_ROW(r) __m512 c##r##_0 = _mm512_setzero_ps(), c##r##_1 = _mm512_setzero_ps();
+#define UPDATE_ROW(r) { \
+        const __m512 ar = _mm512_set1_ps(a[r]); \
+        c##r##_0 = _mm512_fmadd_ps(ar, b0, c##r##_0); \
+        c##r##_1 = _mm512_fmadd_ps(ar, b1, c##r##_1); }
+#define STORE_ROW(r) \
+    storeRow16(c + r * ldc, c##r##_0, accumulate); \
+    storeRow16(c + r * ldc + 16, c##r##_1, accumulate);
+
+    DECLARE_ROW(0) DECLARE_ROW(1) DECLARE_ROW(2) DECLARE_ROW(3) DECLARE_ROW(4) DECLARE_ROW(5)
+    DECLARE_ROW(6) DECLARE_ROW(7) DECLARE_ROW(8) DECLARE_ROW(9) DECLARE_ROW(10) DECLARE_ROW(11)
+    for (size_t p = 0; p < kc; ++p) {
+        const __m512 b0 = _mm512_loadu_ps(b);
+        const __m512 b1 = _mm512_loadu_ps(b + 16);
+        UPDATE_ROW(0) UPDATE_ROW(1) UPDATE_ROW(2) UPDATE_ROW(3) UPDATE_ROW(4) UPDATE_ROW(5)
+        UPDATE_ROW(6) UPDATE_ROW(7) UPDATE_ROW(8) UPDATE_ROW(9) UPDATE_ROW(10) UPDATE_ROW(11)
+        a += 12;
+        b += 32;
+    }
+    STORE_ROW(0) STORE_ROW(1) STORE_ROW(2) STORE_ROW(3) STORE_ROW(4) STORE_ROW(5)
+    STORE_ROW(6) STORE_ROW(7) STORE_ROW(8) STORE_ROW(9) STORE_ROW(10) STORE_ROW(11)
+
+#undef DECLARE_ROW
+#undef UPDATE_ROW
+#undef STORE_ROW
+}
+
+SIMD_TARGET_END
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // SIMD_X86
+
+MicroKernel selectMicroKernel() {
+#ifdef SIMD_X86
+    switch (kernels::activeSimdLevel()) {
+    case kernels::SimdLevel::AVX512: return {12, 32, kernelAvx512};
+    case kernels::SimdLevel::AVX2: return {6, 16, kernelAvx2};
+    default: break;
+    }
+#endif
+    return {4, 16, kernelScalar};
+}
+
+// A block [mc x kc] -> ceil(mc/mr) panels, each kc steps of mr values
+void packA(const MicroKernel& uk, size_t mc, size_t kc, const float* A, size_t lda, float* out) {
+    for (size_t ir = 0; ir < mc; ir += uk.mr) {
+        const size_t rows = std::min(uk.mr, mc - ir);
+        for (size_t r = 0; r < uk.mr; ++r) {
+            if (r < rows) {
+                const float* src = A + (ir + r) * lda;
+                for (size_t p = 0; p < kc; ++p) out[p * uk.mr + r] = src[p];
+            } else {
+                for (size_t p = 0; p < kc; ++p) out[p * uk.mr + r] = 0.0f;
+            }
+        }
+        out += uk.mr * kc;
+    }
+}
+
+// B panel [kc x nc] -> ceil(nc/nr) slivers, each kc steps of nr values
+void packB(const MicroKernel& uk, size_t kc, size_t nc, const float* B, size_t ldb, float* out) {
+    for (size_t jr = 0; jr < nc; jr += uk.nr) {
+        const size_t cols = std::min(uk.nr, nc - jr);
+        for (size_t p = 0; p < kc; ++p) {
+            const float* src = B + p * ldb + jr;
+            std::memcpy(out, src, cols * sizeof(float));
+            for (size_t j = cols; j < uk.nr; ++j) out[j] = 0.0f;
+            out += uk.nr;
+        }
+    }
+}
+
+// Serial blocked GEMM on one tile of C, using per-thread packing buffers
+void gemmTile(const MicroKernel& uk, size_t M, size_t N, size_t K,
+              const float* A, size_t lda, const float* B, size_t ldb,
+              float* C, size_t ldc) {
+    if (K == 0) {
+        for (size_t i = 0; i < M; ++i) std::memset(C + i * ldc, 0, N * sizeof(float));
+        return;
+    }
+
+    thread_local std::vector<float> packedA;
+    thread_local std::vector<float> packedB;
+    packedA.resize(MC * KC);
+    packedB.resize(KC * ((NC + uk.nr - 1) / uk.nr) * uk.nr);
+
+    alignas(64) float edge[MAX_MR * MAX_NR];
+
+    for (size_t jc = 0; jc < N; jc += NC) {
+        const size_t nc = std::min(NC, N - jc);
+        for (size_t pc = 0; pc < K; pc += KC) {
+            const size_t kc = std::min(KC, K - pc);
+            const bool accumulate = pc > 0;
+            packB(uk, kc, nc, B + pc * ldb + jc, ldb, packedB.data());
+
+            for (size_t ic = 0; ic < M; ic += MC) {
+                const size_t mc = std::min(MC, M - ic);
+                packA(uk, mc, kc, A + ic * lda + pc, lda, packedA.data());
+
+                for (size_t jr = 0; jr < nc; jr += uk.nr) {
+                    const size_t cols = std::min(uk.nr, nc - jr);
+                    const float* bSliver = packedB.data() + jr * kc;
+                    for (size_t ir = 0; ir < mc; ir += uk.mr) {
+                        const size_t rows = std::min(uk.mr, mc - ir);
+                        const float* aPanel = packedA.data() + ir * kc;
+                        float* cTile = C + (ic + ir) * ldc + jc + jr;
+
+                        if (rows == uk.mr && cols == uk.nr) {
+                            uk.run(kc, aPanel, bSliver, cTile, ldc, accumulate);
+                            continue;
+                        }
+                        // Partial tile: compute a full tile aside, copy what fits
+                        uk.run(kc, aPanel, bSliver, edge, uk.nr, false);
+                        for (size_t r = 0; r < rows; ++r) {
+                            float* dst = cTile + r * ldc;
+                            const float* src = edge + r * uk.nr;
+                            for (size_t j = 0; j < cols; ++j) {
+                                dst[j] = accumulate ? dst[j] + src[j] : src[j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Products below this many multiply-adds are not worth distributing
+constexpr size_t PARALLEL_MIN_FLOPS = size_t(1) << 21;
+
+} // namespace
+
+void sgemmBatched(size_t batch, size_t M, size_t N, size_t K,
+                  const float* A, size_t lda, size_t strideA,
+                  const float* B, size_t ldb, size_t strideB,
+                  float* C, size_t ldc, size_t strideC,
+                  ThreadPool* pool) {
+    if (batch == 0 || M == 0 || N == 0) return;
+    const MicroKernel uk = selectMicroKernel();
+
+    // Split each product into row blocks of MC and, when that leaves too few
+    // tasks to keep every thread busy, into column blocks as well.
+    size_t rowBlocks = 1, colBlocks = 1;
+    const size_t threads = pool ? pool->size() + 1 : 1;
+    if (threads > 1 && batch * M * N * K >= PARALLEL_MIN_FLOPS) {
+        const size_t target = threads * 4;
+        rowBlocks = (M + MC - 1) / MC;
+        const size_t perBatch = (target + batch - 1) / batch;
+        if (rowBlocks < perBatch) {
+            const size_t maxColBlocks = std::max<size_t>(1, N / (uk.nr * 4));
+            colBlocks = std::min(maxColBlocks, (perBatch + rowBlocks - 1) / rowBlocks);
+        }
+    }
+
+    const size_t rowStep = (M + rowBlocks - 1) / rowBlocks;
+    size_t colStep = (N + colBlocks - 1) / colBlocks;
+    colStep = (colStep + uk.nr - 1) / uk.nr * uk.nr;
+    colBlocks = (N + colStep - 1) / colStep;
+    const size_t tilesPerBatch = rowBlocks * colBlocks;
+
+    auto runTile = [&](size_t task) {
+        const size_t b = task / tilesPerBatch;
+        const size_t tile = task % tilesPerBatch;
+        const size_t row0 = (tile / colBlocks) * rowStep;
+        const size_t col0 = (tile % colBlocks) * colStep;
+        if (row0 >= M || col0 >= N) return;
+        const size_t rows = std::min(rowStep, M - row0);
+        const size_t cols = std::min(colStep, N - col0);
+        gemmTile(uk, rows, cols, K,
+                 A + b * strideA + row0 * lda, lda,
+                 B + b * strideB + col0, ldb,
+                 C + b * strideC + row0 * ldc + col0, ldc);
+    };
+    const size_t tiles = batch * tilesPerBatch;
+    if (threads > 1 && tiles > 1) {
+        pool->parallel_for(0, tiles, 1, [&](size_t first, size_t last) {
+            for (size_t task = first; task < last; ++task) runTile(task);
+        });
+    } else {
+        for (size_t task = 0; task < tiles; ++task) runTile(task);
+    }
+}
+
+void sgemm(size_t M, size_t N, size_t K,
+           const float* A, size_t lda,
+           const float* B, size_t ldb,
+           float* C, size_t ldc,
+           ThreadPool* pool) {
+    sgemmBatched(1, M, N, K, A, lda, 0, B, ldb, 0, C, ldc, 0, pool);
+}
+
+// sgemm reads operands whose rows are unit-stride in place, stepping by
+// the view's row and batch strides (0 for a broadcast operand)
+static bool unitStrideRows(const Tensor& t) {
+    const size_t rank = t.getShape().size();
+    return t.size() == 0 || t.getShape()[rank - 1] == 1 || t.getStrides()[rank - 1] == 1;
+}
+
+Tensor Tensor::matmul(const Tensor& other, ThreadPool* pool) const {
+    if (type != DType::FLOAT32 || other.dtype() != DType::FLOAT32) {
+        return cast(DType::FLOAT32).matmul(other.cast(DType::FLOAT32), pool);
+    }
+    const std::vector<size_t>& a = shape;
+    const std::vector<size_t>& b = other.getShape();
+    if (a.size() < 2 || b.size() < 2) {
+        throw std::runtime_error("matmul: expected 2-D x 2-D, 3-D x 3-D or 3-D x 2-D tensors");
+    }
+    if (!unitStrideRows(*this) || !unitStrideRows(other)) {
+        return contiguous().matmul(other.contiguous(), pool);
+    }
+    const size_t lda = strides[a.size() - 2];
+    const size_t ldb = other.getStrides()[b.size() - 2];
+    const float* A = numel > 0 ? reinterpret_cast<const float*>(base()) : nullptr;
+    const float* B = other.size() > 0 ? reinterpret_cast<const float*>(other.base()) : nullptr;
+
+    if (a.size() == 2 && b.size() == 2) {
+        if (a[1] != b[0]) throw std::runtime_error("matmul: inner dimensions differ");
+        Tensor out = uninitialized({a[0], b[1]});
+        sgemm(a[0], b[1], a[1], A, lda, B, ldb, out.dataPtr(), b[1], pool);
+        return out;
+    }
+
+    if (a.size() == 3 && (b.size() == 3 || b.size() == 2)) {
+        const bool shared = b.size() == 2;
+        const size_t batch = a[0], M = a[1], K = a[2];
+        const size_t bK = shared ? b[0] : b[1];
+        const size_t N = shared ? b[1] : b[2];
+        if (!shared && b[0] != batch) throw std::runtime_error("matmul: batch sizes differ");
+        if (bK != K) throw std::runtime_error("matmul: inner dimensions differ");
+
+        Tensor out = uninitialized({batch, M, N});
+        sgemmBatched(batch, M, N, K,
+                     A, lda, strides[0],
+                     B, ldb, shared ? 0 : other.getStrides()[0],
+                     out.dataPtr(), N, M * N, pool);
+        return out;
+    }
+
+    throw std::runtime_error("matmul: expected 2-D x 2-D, 3-D x 3-D or 3-D x 2-D tensors");
+}
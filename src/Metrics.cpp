@@ -0,0 +1,243 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Each thread keeps to one counter shard, assigned round-robin on first use
+size_t threadShard() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % Counter::SHARDS;
+    return shard;
+}
+
+void atomicMin(std::atomic<uint64_t>& target, uint64_t v) {
+    uint64_t seen = target.load(std::memory_order_relaxed);
+    while (v < seen && !target.compare_exchange_weak(seen, v, std::memory_order_relaxed)) {
+    }
+}
+
+void atomicMax(std::atomic<uint64_t>& target, uint64_t v) {
+    uint64_t seen = target.load(std::memory_order_relaxed);
+    while (v > seen && !target.compare_exchange_weak(seen, v, std::memory_order_relaxed)) {
+    }
+}
+
+void writeName(std::ostream& out, const std::string& name) {
+    out << '"';
+    for (char c : name) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << "\":";
+}
+
+double micros(uint64_t nanos) {
+    return static_cast<double>(nanos) / 1000.0;
+}
+
+} // namespace
+
+void Counter::add(uint64_t n) {
+    shards[threadShard()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const {
+    uint64_t sum = 0;
+    for (const Shard& shard : shards) sum += shard.value.load(std::memory_order_relaxed);
+    return sum;
+}
+
+size_t Histogram::bucketFor(uint64_t nanos) {
+    if (nanos < SUB_BUCKETS) return static_cast<size_t>(nanos);
+    const unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(nanos));
+    const unsigned shift = exponent - SUB_BITS;
+    const size_t mantissa = static_cast<size_t>(nanos >> shift) - SUB_BUCKETS;
+    return SUB_BUCKETS + shift * SUB_BUCKETS + mantissa;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    const size_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+    const uint64_t mantissa = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    const uint64_t lower = (SUB_BUCKETS + mantissa) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void Histogram::record(uint64_t nanos) {
+    buckets[bucketFor(nanos)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(nanos, std::memory_order_relaxed);
+    atomicMin(minimum, nanos);
+    atomicMax(maximum, nanos);
+}
+
+void Histogram::recordSince(std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+}
+
+uint64_t Histogram::count() const {
+    uint64_t n = 0;
+    for (const auto& bucket : buckets) n += bucket.load(std::memory_order_relaxed);
+    return n;
+}
+
+uint64_t Histogram::percentile(double q) const {
+    // One pass over a copy so the answer is consistent with itself
+    std::vector<uint64_t> counts(BUCKETS);
+    uint64_t n = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) n += counts[i] = buckets[i].load(std::memory_order_relaxed);
+    if (n == 0) return 0;
+
+    const uint64_t max = maximum.load(std::memory_order_relaxed);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(n))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) return std::min(bucketUpperBound(i), max);
+    }
+    return max;
+}
+
+HistogramSummary Histogram::summary() const {
+    std::vector<uint64_t> counts(BUCKETS);
+    HistogramSummary s;
+    for (size_t i = 0; i < BUCKETS; ++i) s.count += counts[i] = buckets[i].load(std::memory_order_relaxed);
+    if (s.count == 0) return s;
+
+    s.mean = static_cast<double>(total.load(std::memory_order_relaxed)) / static_cast<double>(s.count);
+    s.min = minimum.load(std::memory_order_relaxed);
+    s.max = maximum.load(std::memory_order_relaxed);
+    // Walk the buckets once for all three percentiles
+    const double quantiles[] = {0.5, 0.99, 0.999};
+    uint64_t* outs[] = {&s.p50, &s.p99, &s.p999};
+    size_t next = 0;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS && next < 3; ++i) {
+        seen += counts[i];
+        while (next < 3) {
+            const uint64_t rank =
+                std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantiles[next] * static_cast<double>(s.count))));
+            if (seen < rank) break;
+            *outs[next++] = std::min(bucketUpperBound(i), s.max);
+        }
+    }
+    while (next < 3) *outs[next++] = s.max;
+    return s;
+}
+
+MetricsRegistry::~MetricsRegistry() {
+    stopDump();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Counter>& slot = counters[name];
+    if (!slot) slot.reset(new Counter());
+    return *slot;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Gauge>& slot = gauges[name];
+    if (!slot) slot.reset(new Gauge());
+    return *slot;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Histogram>& slot = histograms[name];
+    if (!slot) slot.reset(new Histogram());
+    return *slot;
+}
+
+void MetricsRegistry::gauge(const std::string& name, std::function<double()> sample) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sampledGauges[name] = std::move(sample);
+}
+
+std::string MetricsRegistry::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream out;
+    out << std::setprecision(15) << "{\"counters\":{";
+    const char* sep = "";
+    for (const auto& entry : counters) {
+        out << sep;
+        writeName(out, entry.first);
+        out << entry.second->value();
+        sep = ",";
+    }
+
+    // Set and sampled gauges share one namespace; a sampled one wins
+    std::map<std::string, double> gaugeValues;
+    for (const auto& entry : gauges) gaugeValues[entry.first] = entry.second->value();
+    for (const auto& entry : sampledGauges) gaugeValues[entry.first] = entry.second();
+    out << "},\"gauges\":{";
+    sep = "";
+    for (const auto& entry : gaugeValues) {
+        out << sep;
+        writeName(out, entry.first);
+        out << entry.second;
+        sep = ",";
+    }
+
+    out << "},\"histograms\":{";
+    sep = "";
+    for (const auto& entry : histograms) {
+        HistogramSummary s = entry.second->summary();
+        out << sep;
+        writeName(out, entry.first);
+        out << "{\"count\":" << s.count << ",\"mean_us\":" << s.mean / 1000.0 << ",\"min_us\":" << micros(s.min)
+            << ",\"p50_us\":" << micros(s.p50) << ",\"p99_us\":" << micros(s.p99)
+            << ",\"p999_us\":" << micros(s.p999) << ",\"max_us\":" << micros(s.max) << "}";
+        sep = ",";
+    }
+    out << "}}";
+    return out.str();
+}
+
+bool MetricsRegistry::writeSnapshot(const std::string& path) const {
+    const std::string temp = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out) return false;
+        out << snapshot() << "\n";
+        if (!out.flush()) return false;
+    }
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+void MetricsRegistry::startDump(const std::string& path, std::chrono::milliseconds interval) {
+    stopDump();
+    std::lock_guard<std::mutex> lock(dumpMutex);
+    dumping = true;
+    dumpThread = std::thread([this, path, interval] {
+        std::unique_lock<std::mutex> lock(dumpMutex);
+        while (true) {
+            dumpCv.wait_for(lock, interval, [this] { return !dumping; });
+            const bool last = !dumping;
+            lock.unlock();
+            if (!writeSnapshot(path)) {
+                std::cerr << "Metrics dump to " << path << " failed" << std::endl;
+            }
+            lock.lock();
+            if (last) return;
+        }
+    });
+}
+
+void MetricsRegistry::stopDump() {
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex);
+        dumping = false;
+    }
+    dumpCv.notify_all();
+    if (dumpThread.joinable()) dumpThread.join();
+}
@@ -0,0 +1,163 @@
+#include "MicroBatcher.h"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+MicroBatcher::MicroBatcher(Scheduler& scheduler, BatchWork work, const BatchOptions& options)
+    : scheduler(scheduler), work(std::move(work)), options(options) {
+    timer = std::thread(&MicroBatcher::timerLoop, this);
+}
+
+MicroBatcher::~MicroBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    timer.join();
+    flush();
+}
+
+std::future<Tensor> MicroBatcher::submit(const Tensor& request) {
+    const bool scalar = request.getShape().empty();
+    Tensor rows = scalar ? request.reshape({1}) : request;
+    const std::vector<size_t>& shape = rows.getShape();
+    Key key(rows.dtype(), std::vector<size_t>(shape.begin() + 1, shape.end()));
+
+    std::promise<Tensor> result;
+    std::future<Tensor> future = result.get_future();
+    std::vector<Pending> ready;
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++counts.requests;
+        Pending& group = pending[key];
+        if (!group.requests.empty() && group.rows + shape[0] > options.maxBatchRows) {
+            // This request would overflow the batch: send what is there
+            ready.push_back(std::move(group));
+            group = Pending();
+        }
+        if (group.requests.empty()) {
+            group.deadline = std::chrono::steady_clock::now() + options.maxWait;
+            first = true;
+        }
+        group.rows += shape[0];
+        group.requests.push_back(std::move(rows));
+        group.results.push_back(std::move(result));
+        group.scalars.push_back(scalar);
+        if (group.rows >= options.maxBatchRows) {
+            ready.push_back(std::move(group));
+            pending.erase(key);
+            first = false;
+        }
+    }
+    for (Pending& batch : ready) dispatch(std::move(batch));
+    if (first) {
+        wake.notify_one(); // the timer may need an earlier deadline
+    }
+    return future;
+}
+
+void MicroBatcher::flush() {
+    std::map<Key, Pending> waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        waiting.swap(pending);
+    }
+    for (auto& entry : waiting) dispatch(std::move(entry.second));
+}
+
+void MicroBatcher::setOptions(const BatchOptions& newOptions) {
+    std::lock_guard<std::mutex> lock(mutex);
+    options = newOptions;
+}
+
+BatchStats MicroBatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counts;
+}
+
+void MicroBatcher::timerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        const auto now = std::chrono::steady_clock::now();
+        auto next = std::chrono::steady_clock::time_point::max();
+        std::vector<Pending> due;
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->second.deadline <= now) {
+                due.push_back(std::move(it->second));
+                it = pending.erase(it);
+            } else {
+                next = std::min(next, it->second.deadline);
+                ++it;
+            }
+        }
+        if (!due.empty()) {
+            lock.unlock();
+            for (Pending& batch : due) dispatch(std::move(batch));
+            lock.lock();
+            continue;
+        }
+        if (next == std::chrono::steady_clock::time_point::max()) {
+            wake.wait(lock);
+        } else {
+            wake.wait_until(lock, next);
+        }
+    }
+}
+
+void MicroBatcher::dispatch(Pending batch) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++counts.batches;
+    }
+    auto state = std::make_shared<Pending>(std::move(batch));
+
+    Task task;
+    task.type = TaskType::COMPUTE;
+    task.name = "Batch";
+    std::vector<size_t> rows;
+    for (const Tensor& request : state->requests) rows.push_back(request.getShape()[0]);
+    if (state->requests.size() == 1) {
+        task.tensor = state->requests[0];
+    } else {
+        // Concatenate along the leading axis
+        std::vector<size_t> shape = state->requests[0].getShape();
+        shape[0] = state->rows;
+        task.tensor = Tensor::uninitialized(shape, state->requests[0].dtype());
+        char* out = static_cast<char*>(task.tensor.rawData());
+        for (const Tensor& request : state->requests) {
+            request.gather(0, request.size(), out);
+            out += request.nbytes();
+        }
+    }
+    state->requests.clear(); // the batch holds the data now
+
+    task.work = [work = work, state, rows](const Tensor& input) {
+        Tensor output;
+        try {
+            output = work(input, rows);
+            if (output.getShape().empty() || output.getShape()[0] != state->rows) {
+                throw std::runtime_error("Batch result must keep the batch's leading axis");
+            }
+        } catch (...) {
+            for (std::promise<Tensor>& result : state->results) result.set_exception(std::current_exception());
+            return;
+        }
+        size_t first = 0;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            Tensor slice = output.slice(0, first, first + rows[i]);
+            if (state->scalars[i]) {
+                // Back to the request's rank: its one row without the leading axis
+                const std::vector<size_t>& shape = slice.getShape();
+                slice = slice.reshape(std::vector<size_t>(shape.begin() + 1, shape.end()));
+            }
+            state->results[i].set_value(std::move(slice));
+            first += rows[i];
+        }
+    };
+    if (!scheduler.submitTask(task)) {
+        auto rejected = std::make_exception_ptr(std::runtime_error("Scheduler rejected the batch"));
+        for (std::promise<Tensor>& result : state->results) result.set_exception(rejected);
+    }
+}
@@ -7,41 +7,134 @@
 #include <thread>
 #include <chrono>
 #include "Tensor.h"
+#include "TensorWire.h"
+#include "ThreadPool.h"
 #include <algorithm>
+#include <cerrno>
+#include <stdexcept>
 
-Node::Node(int port, size_t numThreads, int nodeId)
+static constexpr size_t SNAPSHOT_IO_THREADS = 4;
+
+static SchedulerOptions instrumentedScheduler(size_t numThreads, MetricsRegistry& metrics) {
+    SchedulerOptions options;
+    options.computeThreads = numThreads;
+    options.metrics = &metrics;
+    return options;
+}
+
+Node::Stages::Stages(MetricsRegistry& registry)
+        : receive(registry.histogram("node.receive")),
+            deserialize(registry.histogram("node.deserialize")),
+            submit(registry.histogram("node.submit")),
+            put(registry.histogram("node.kv_put")),
+            scheduleSave(registry.histogram("node.schedule_save")),
+            tensors(registry.counter("node.tensors_received")),
+            bytes(registry.counter("node.bytes_received")),
+            malformed(registry.counter("node.malformed_frames")),
+            batches(registry.counter("node.batches")),
+            batchedTensors(registry.counter("node.batched_tensors")) {}
+
+Node::Node(int port, size_t numThreads, int nodeId, const std::string& snapshotPath)
         : port(port),
             serverSocket(-1),
             nodeId(nodeId),
+            snapshotPath(snapshotPath),
             running(false),
-            scheduler(numThreads) {
-    // Attempt to restore checkpoint on startup
-    kvStore.loadFromDisk("latest_tensor");
+            stages(metricsRegistry),
+            scheduler(instrumentedScheduler(numThreads, metricsRegistry)),
+            batcher(scheduler, [this](const Tensor& batch, const std::vector<size_t>& rows) {
+                return runBatch(batch, rows);
+            }) {
+    // Restore the whole store from the snapshot written at the last
+    // shutdown, then the latest per-key checkpoint, which is never older.
+    // Mapping them makes startup independent of their size; pages load on
+    // first access.
+    if (!snapshotPath.empty()) kvStore.loadSnapshot(snapshotPath, LoadMode::MMAP);
+    kvStore.loadFromDisk("latest_tensor", LoadMode::MMAP);
+    // Checkpoints are written behind ingestion, coalescing bursts of puts,
+    // and only the chunks a put changed are rewritten
+    CheckpointConfig checkpoints;
+    checkpoints.metrics = &metricsRegistry;
+    checkpoints.incremental = true;
+    kvStore.startCheckpointing(checkpoints);
+
+    for (TaskType type : {TaskType::COMPUTE, TaskType::IO}) {
+        const std::string lane = type == TaskType::IO ? "scheduler.io" : "scheduler.compute";
+        metricsRegistry.gauge(lane + ".queued", [this, type] { return double(scheduler.stats(type).queued); });
+        metricsRegistry.gauge(lane + ".running", [this, type] { return double(scheduler.stats(type).running); });
+    }
+    metricsRegistry.gauge("node.connected_sockets", [this] {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        return double(clientSockets.size());
+    });
+    metricsRegistry.gauge("kvstore.bytes", [this] { return double(kvStore.bytes()); });
 }
 
 Node::~Node() {
     running = false;
+    if (reactor) {
+        reactor->stop();
+    }
     if (serverSocket != -1) {
-        close(serverSocket);
+        // Wakes a blocking accept() in the thread-per-connection loop
+        shutdown(serverSocket, SHUT_RDWR);
     }
     if (serverThread.joinable()) {
         serverThread.join();
     }
+    if (serverSocket != -1) {
+        close(serverSocket);
+    }
+    {
+        // Detached handlers of the thread-per-connection loop block in recv()
+        // for as long as their peer stays connected; wake them and wait
+        std::unique_lock<std::mutex> lock(clientsMutex);
+        if (clientHandlers > 0) {
+            for (int sock : clientSockets) shutdown(sock, SHUT_RDWR);
+            handlersDone.wait(lock, [this] { return clientHandlers == 0; });
+        }
+    }
+    // Nothing new arrives now; hand the last partial batches to the
+    // scheduler and let them reach the store before it is persisted
+    batcher.flush();
+    scheduler.drain();
+    // Persist whatever is still pending before the store goes away
+    kvStore.stopCheckpointing();
+    if (!snapshotPath.empty()) {
+        ThreadPool io(SNAPSHOT_IO_THREADS);
+        kvStore.saveSnapshot(snapshotPath, &io);
+    }
+    // The gauges read members that are about to be destroyed
+    metricsRegistry.stopDump();
 }
 
-void Node::startServer() {
+void Node::startServer(const ServerOptions& options) {
     running = true;
+    maxReceiveBytes = options.maxFrameBytes;
+    serverSocket = openListenSocket(options.backlog);
+    if (serverSocket < 0) return;
+
+    if (options.useEventLoop && Reactor::supported()) {
+        reactor.reset(new Reactor(
+            options,
+            [this](int, std::shared_ptr<std::vector<char>> payload) { handleFrame(std::move(payload)); },
+            [this](int fd, bool open) { trackClient(fd, open); }));
+        if (reactor->start(serverSocket)) {
+            std::cout << "Node listening on port " << port << " (" << options.ioThreads << " I/O threads)" << std::endl;
+            return;
+        }
+        reactor.reset();
+    }
+
+    std::cout << "Node listening on port " << port << std::endl;
     serverThread = std::thread(&Node::serverLoop, this);
 }
 
-void Node::serverLoop() {
-    // NOTE: Server runs indefinitely; clean shutdown not yet implemented.
-    // accept() blocks — this is acceptable for the prototype. We'll add
-    // signal handling, control messages, or lifecycle management later.
-    serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket < 0) {
+int Node::openListenSocket(int backlog) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
         std::cerr << "Failed to create socket\n";
-        return;
+        return -1;
     }
 
     sockaddr_in serverAddr{};
@@ -50,33 +143,33 @@ void Node::serverLoop() {
     serverAddr.sin_port = htons(port);
 
     int opt = 1;
-    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
-    if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+    if (bind(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
         std::cerr << "Bind failed\n";
-        close(serverSocket);
-        serverSocket = -1;
-        return;
+        close(sock);
+        return -1;
     }
 
-    if (listen(serverSocket, 5) < 0) {
+    if (listen(sock, backlog) < 0) {
         std::cerr << "Listen failed\n";
-        close(serverSocket);
-        serverSocket = -1;
-        return;
+        close(sock);
+        return -1;
     }
+    return sock;
+}
 
-    std::cout << "Node listening on port " << port << std::endl;
-
-    while (true) {
+void Node::serverLoop() {
+    // Fallback server: one thread per connection, one tensor per connection
+    while (running) {
         int clientSocket = accept(serverSocket, nullptr, nullptr);
         if (clientSocket >= 0) {
             // Track client socket and dispatch handler thread
             {
-                std::lock_guard<std::mutex> lg(clientsMutex);
+                std::lock_guard<std::mutex> lock(clientsMutex);
                 clientSockets.push_back(clientSocket);
+                ++clientHandlers;
             }
-
             std::thread(&Node::handleClient, this, clientSocket).detach();
         } else {
             if (!running) break;
@@ -86,47 +179,97 @@ void Node::serverLoop() {
 }
 
 void Node::handleClient(int clientSocket) {
-    try {
-        Tensor received = receiveTensor(clientSocket);
-
-        kvStore.put("latest_tensor", received);
-        kvStore.saveToDisk("latest_tensor");
-
-        std::cout << "DEBUG: Submitting task for tensor of size " << received.size() << std::endl;
-
-        Task task;
-        task.type = TaskType::COMPUTE;
-        task.name = "TensorCompute";
-        task.tensor = received;
-
-        task.work = [this](const Tensor& t) {
-            Tensor restored;
-            if (kvStore.get("latest_tensor", restored)) {
-                float sum = 0.0f;
-                for (size_t i = 0; i < restored.size(); i++) {
-                    sum += restored[i];
-                }
-                std::cout << "KVStore tensor sum: " << sum << std::endl;
-                std::cout.flush();
-            } else {
-                std::cout << "Failed to retrieve from KVStore" << std::endl;
-            }
-        };
+    // Peers keep connections open, so read frames until the sender closes
+    while (running) {
+        char next;
+        ssize_t r = recv(clientSocket, &next, 1, MSG_PEEK);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        try {
+            const auto start = std::chrono::steady_clock::now();
+            Tensor received = receiveTensor(clientSocket);
+            stages.receive.recordSince(start);
+            stages.bytes.add(received.nbytes());
+            ingestTensor(received);
+        } catch (const std::exception& e) {
+            std::cerr << "receiveTensor failed: " << e.what() << std::endl;
+            break;
+        }
+    }
 
-        scheduler.submitTask(task);
+    // Closes the socket unless a failed broadcast already did
+    removeDeadSocket(clientSocket);
+    // Last use of the Node: ~Node may destroy it once this is zero
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    if (--clientHandlers == 0) handlersDone.notify_all();
+}
+
+void Node::handleFrame(std::shared_ptr<std::vector<char>> payload) {
+    try {
+        // The tensor views the frame buffer; no copy on the I/O thread
+        const char* bytes = payload->data();
+        size_t len = payload->size();
+        const auto start = std::chrono::steady_clock::now();
+        Tensor received = Tensor::viewBinary(std::move(payload), bytes, len);
+        stages.deserialize.recordSince(start);
+        stages.bytes.add(len);
+        ingestTensor(received);
     } catch (const std::exception& e) {
-        std::cerr << "receiveTensor failed: " << e.what() << std::endl;
-        removeDeadSocket(clientSocket);
+        // The frame boundary is known, so the connection stays usable
+        stages.malformed.add();
+        std::cerr << "Dropping malformed frame: " << e.what() << std::endl;
+    }
+}
+
+void Node::trackClient(int clientSocket, bool open) {
+    std::lock_guard<std::mutex> lg(clientsMutex);
+    if (open) {
+        clientSockets.push_back(clientSocket);
         return;
     }
+    auto it = std::find(clientSockets.begin(), clientSockets.end(), clientSocket);
+    if (it != clientSockets.end()) clientSockets.erase(it);
+}
 
-    close(clientSocket);
-    // remove from clientSockets tracking
+void Node::ingestTensor(const Tensor& received) {
+    // The result only matters to the batch task itself
+    stages.tensors.add();
+    ScopedTimer timer(stages.submit);
+    batcher.submit(received);
+}
+
+Tensor Node::runBatch(const Tensor& batch, const std::vector<size_t>& rows) {
+    // One store and one checkpoint per batch: the latest tensor is the
+    // batch's last request. Its rows are copied out; a slice would keep the
+    // whole batch alive in the store.
+    const size_t total = batch.getShape()[0];
+    const Tensor lastRows = batch.slice(0, total - rows.back(), total);
+    Tensor latest = Tensor::uninitialized(lastRows.getShape(), lastRows.dtype());
+    lastRows.gather(0, lastRows.size(), latest.rawData());
     {
-        std::lock_guard<std::mutex> lg(clientsMutex);
-        auto it = std::find(clientSockets.begin(), clientSockets.end(), clientSocket);
-        if (it != clientSockets.end()) clientSockets.erase(it);
+        ScopedTimer timer(stages.put);
+        kvStore.put("latest_tensor", latest);
     }
+    {
+        ScopedTimer timer(stages.scheduleSave);
+        kvStore.scheduleSave("latest_tensor");
+    }
+
+    stages.batches.add();
+    stages.batchedTensors.add(rows.size());
+    return batch;
+}
+
+void Node::setBatchOptions(const BatchOptions& options) {
+    batcher.setOptions(options);
+}
+
+MetricsRegistry& Node::metrics() {
+    return metricsRegistry;
+}
+
+void Node::startMetricsDump(const std::string& path, std::chrono::milliseconds interval) {
+    metricsRegistry.startDump(path, interval);
 }
 
 void Node::removeDeadSocket(int sock) {
@@ -158,35 +301,14 @@ void Node::sendTask(const std::string& message) {
     }
 
     // Send 8-byte big-endian length prefix followed by payload
-    uint64_t len = message.size();
-    uint8_t lenbuf[8];
-    for (int i = 7; i >= 0; --i) {
-        lenbuf[i] = static_cast<uint8_t>(len & 0xFF);
-        len >>= 8;
-    }
-
-    size_t sent = 0;
-    while (sent < 8) {
-        ssize_t s = ::send(sock, lenbuf + sent, 8 - sent, 0);
-        if (s <= 0) break;
-        sent += static_cast<size_t>(s);
-    }
-
-    sent = 0;
-    const char* data = message.data();
-    size_t tosend = message.size();
-    while (sent < tosend) {
-        ssize_t s = ::send(sock, data + sent, tosend - sent, 0);
-        if (s <= 0) break;
-        sent += static_cast<size_t>(s);
-    }
+    sendFrame(sock, message.data(), message.size());
 
     close(sock);
 }
 
 void Node::broadcastTensor(const Tensor& tensor) {
-    auto buffer = tensor.serializeBinary();
-    uint64_t size = static_cast<uint64_t>(buffer.size());
+    // Encode the frame header once; every peer gets the same bytes
+    WireHeader header = encodeWireHeader(tensor);
 
     std::vector<int> socketsCopy;
     {
@@ -195,14 +317,7 @@ void Node::broadcastTensor(const Tensor& tensor) {
     }
 
     for (int sock : socketsCopy) {
-        ssize_t sent = send(sock, &size, sizeof(uint64_t), 0);
-        if (sent <= 0) {
-            removeDeadSocket(sock);
-            continue;
-        }
-
-        sent = send(sock, buffer.data(), size, 0);
-        if (sent <= 0) {
+        if (!sendTensor(sock, header, tensor)) {
             removeDeadSocket(sock);
         }
     }
@@ -210,84 +325,38 @@ void Node::broadcastTensor(const Tensor& tensor) {
 
 // RPC-style sendTensor removed — broadcasting uses tracked clientSockets now.
 
-void Node::broadcastTensor(const Tensor& tensor, const std::vector<int>& destPorts) {
-    for (int p : destPorts) {
-        try {
-            // RPC-style send to destPort
-            std::vector<char> data = tensor.serializeBinary();
-
-            int sock = socket(AF_INET, SOCK_STREAM, 0);
-            if (sock < 0) {
-                std::cerr << "Socket create failed\n";
-                continue;
-            }
-
-            sockaddr_in serverAddr{};
-            serverAddr.sin_family = AF_INET;
-            serverAddr.sin_port = htons(p);
-            serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-
-            if (connect(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-                std::cerr << "Connection failed to port " << p << "\n";
-                close(sock);
-                continue;
-            }
+void Node::broadcastTensor(const Tensor& tensor, const std::vector<int>& destPorts, WireEncoding encoding) {
+    // Serialize the header once for all destinations; float32 data is
+    // gathered straight from the tensor's storage on each send, other
+    // encodings are converted once. Connections persist across calls and
+    // all peers are written concurrently.
+    WireHeader header = encodeWireHeader(tensor, encoding);
 
-            uint64_t len = data.size();
-            uint8_t lenbuf[8];
-            for (int i = 7; i >= 0; --i) {
-                lenbuf[i] = static_cast<uint8_t>(len & 0xFF);
-                len >>= 8;
-            }
-
-            size_t sent = 0;
-            while (sent < 8) {
-                ssize_t s = ::send(sock, lenbuf + sent, 8 - sent, 0);
-                if (s <= 0) break;
-                sent += static_cast<size_t>(s);
-            }
-
-            sent = 0;
-            const char* bytes = data.data();
-            size_t tosend = data.size();
-            while (sent < tosend) {
-                ssize_t s = ::send(sock, bytes + sent, tosend - sent, 0);
-                if (s <= 0) break;
-                sent += static_cast<size_t>(s);
-            }
-
-            close(sock);
-        } catch (...) {
-            std::cerr << "broadcast: failed to send to port " << p << std::endl;
-        }
+    for (int p : peers.broadcast(header, tensor, destPorts)) {
+        std::cerr << "broadcast: failed to send to port " << p << std::endl;
     }
 }
 
-Tensor Node::receiveTensor(int clientSocket) {
-    // Read 8-byte big-endian length prefix
-    uint8_t lenbuf[8];
-    size_t have = 0;
-    while (have < 8) {
-        ssize_t r = ::read(clientSocket, lenbuf + have, 8 - have);
-        if (r <= 0) throw std::runtime_error("Failed reading length prefix");
-        have += static_cast<size_t>(r);
-    }
+void Node::setPeerEncoding(int port, WireEncoding encoding) {
+    peers.setEncoding(port, encoding);
+}
 
-    uint64_t len = 0;
-    for (int i = 0; i < 8; ++i) {
-        len = (len << 8) | static_cast<uint8_t>(lenbuf[i]);
-    }
+void Node::joinCollectives(int rank, int worldSize, int basePort, const CommOptions& options) {
+    std::unique_ptr<Communicator> group(new Communicator(rank, worldSize, basePort, options));
+    group->connect();
+    communicator = std::move(group);
+}
 
-    std::vector<char> payload;
-    payload.resize(len);
-    size_t received = 0;
-    while (received < len) {
-        ssize_t r = ::read(clientSocket, payload.data() + received, static_cast<size_t>(len) - received);
-        if (r <= 0) throw std::runtime_error("Failed reading tensor payload");
-        received += static_cast<size_t>(r);
-    }
+Communicator& Node::collectives() {
+    if (!communicator) throw std::runtime_error("Node has not joined a collective group");
+    return *communicator;
+}
 
-    return Tensor::deserializeBinary(payload);
+Tensor Node::receiveTensor(int clientSocket) {
+    // Length prefix and header are validated, against the same limit as the
+    // Reactor's frames, before the payload is read directly into the new
+    // tensor's storage
+    return recvTensor(clientSocket, maxReceiveBytes);
 }
 
 void Node::broadcastToPeers(const Tensor& tensor) {
@@ -0,0 +1,253 @@
+#include "PeerPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// True if the peer has closed its end (or the socket is in error). Peers
+// never send to us, so any readable data also means the stream is unusable.
+bool peerClosed(int fd) {
+    pollfd pfd{fd, POLLIN, 0};
+    if (::poll(&pfd, 1, 0) <= 0) return false;
+    return (pfd.revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
+
+// One frame in flight to one peer; iov[next..] is still unsent
+struct Outgoing {
+    size_t peer;
+    int fd;
+    std::vector<struct iovec> iov;
+    size_t next;
+    std::chrono::steady_clock::time_point lastProgress;
+};
+
+// Writes as much as the socket accepts, noting the time of any progress.
+// Returns false on a hard error.
+bool advance(Outgoing& out) {
+    while (out.next < out.iov.size()) {
+        msghdr msg{};
+        msg.msg_iov = out.iov.data() + out.next;
+        msg.msg_iovlen = std::min<size_t>(out.iov.size() - out.next, IOV_MAX);
+        ssize_t sent = ::sendmsg(out.fd, &msg, SEND_FLAGS | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (sent > 0) out.lastProgress = std::chrono::steady_clock::now();
+        size_t left = static_cast<size_t>(sent);
+        while (out.next < out.iov.size() && left >= out.iov[out.next].iov_len) {
+            left -= out.iov[out.next].iov_len;
+            ++out.next;
+        }
+        if (out.next < out.iov.size()) {
+            out.iov[out.next].iov_base = static_cast<char*>(out.iov[out.next].iov_base) + left;
+            out.iov[out.next].iov_len -= left;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+PeerPool::PeerPool(const PeerOptions& options) : options(options) {}
+
+PeerPool::~PeerPool() {
+    for (auto& entry : peers) {
+        if (entry.second.fd >= 0) close(entry.second.fd);
+    }
+}
+
+size_t PeerPool::connectedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t n = 0;
+    for (const auto& entry : peers) {
+        if (entry.second.fd >= 0) ++n;
+    }
+    return n;
+}
+
+void PeerPool::fail(Peer& peer) {
+    if (peer.fd >= 0) {
+        close(peer.fd);
+        peer.fd = -1;
+    }
+    peer.backoff = peer.backoff.count() == 0 ? options.initialBackoff
+                                             : std::min(peer.backoff * 2, options.maxBackoff);
+    peer.nextAttempt = std::chrono::steady_clock::now() + peer.backoff;
+}
+
+void PeerPool::setEncoding(int port, WireEncoding encoding) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Peer& peer = peers[port];
+    peer.hasEncoding = true;
+    peer.encoding = encoding;
+}
+
+void PeerPool::clearEncoding(int port) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = peers.find(port);
+    if (it != peers.end()) it->second.hasEncoding = false;
+}
+
+// Returns a connected socket for the peer, reconnecting if needed, or -1
+int PeerPool::acquire(int port, Peer& peer) {
+    if (peer.fd >= 0 && !peerClosed(peer.fd)) return peer.fd;
+    if (peer.fd >= 0) {
+        // Dropped since the last broadcast: reconnect right away
+        close(peer.fd);
+        peer.fd = -1;
+    } else if (std::chrono::steady_clock::now() < peer.nextAttempt) {
+        return -1;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        fail(peer);
+        return -1;
+    }
+
+    int one = 1;
+    if (options.noDelay) setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (options.sendBufferBytes > 0)
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &options.sendBufferBytes, sizeof(options.sendBufferBytes));
+    if (options.recvBufferBytes > 0)
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &options.recvBufferBytes, sizeof(options.recvBufferBytes));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        fail(peer);
+        return -1;
+    }
+
+    peer.fd = sock;
+    peer.backoff = std::chrono::milliseconds(0);
+    return sock;
+}
+
+// Large tensors are streamed in chunks so receivers can consume them while
+// in flight. Encoded data is produced in full, once, into frame.encoded
+// (see PeerPool.h). frame.header must already be set.
+void PeerPool::buildFrame(Frame& frame, const Tensor& tensor) const {
+    const WireEncoding encoding = frame.header.encoding;
+    const char* data = static_cast<const char*>(tensor.rawData());
+    uint64_t dataBytes = tensor.nbytes();
+    if (encoding != WireEncoding::FLOAT32) {
+        dataBytes = encodedBytes(encoding, tensor.size());
+        frame.encoded.resize(static_cast<size_t>(dataBytes));
+        encodeFloats(encoding, tensor.dataPtr(), frame.encoded.data(), tensor.size());
+        data = frame.encoded.data();
+    }
+
+    if (options.streamThresholdBytes > 0 && dataBytes >= options.streamThresholdBytes) {
+        encodeLengthPrefix(STREAM_FLAG | (frame.header.size - 8), frame.header.bytes);
+        frame.iov.push_back(iovec{frame.header.bytes, frame.header.size});
+        frame.chunkHeaders = encodeChunkHeaders(dataBytes, options.streamChunkBytes, encodingUnitBytes(encoding));
+        uint64_t offset = 0;
+        for (size_t c = 0; c < frame.chunkHeaders.size(); c += CHUNK_HEADER_SIZE) {
+            uint64_t at;
+            uint32_t len;
+            decodeChunkHeader(frame.chunkHeaders.data() + c, at, len);
+            frame.iov.push_back(iovec{frame.chunkHeaders.data() + c, CHUNK_HEADER_SIZE});
+            frame.iov.push_back(iovec{const_cast<char*>(data + offset), len});
+            offset += len;
+        }
+    } else {
+        frame.iov.push_back(iovec{frame.header.bytes, frame.header.size});
+        if (dataBytes > 0) frame.iov.push_back(iovec{const_cast<char*>(data), static_cast<size_t>(dataBytes)});
+    }
+}
+
+std::vector<int> PeerPool::broadcast(const WireHeader& header, const Tensor& tensor, const std::vector<int>& ports) {
+    if (!tensor.isContiguous()) return broadcast(header, tensor.contiguous(), ports);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<int> failed;
+
+    // Built on first use; map nodes stay put, so the gather lists stay valid
+    std::map<WireEncoding, Frame> frames;
+    auto frameFor = [&](WireEncoding encoding) -> const std::vector<struct iovec>& {
+        auto it = frames.find(encoding);
+        if (it == frames.end()) {
+            it = frames.emplace(encoding, Frame()).first;
+            it->second.header = encoding == header.encoding ? header : encodeWireHeader(tensor, encoding);
+            buildFrame(it->second, tensor);
+        }
+        return it->second.iov;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Outgoing> outgoing;
+    outgoing.reserve(ports.size());
+    for (size_t i = 0; i < ports.size(); ++i) {
+        // A repeated port would interleave two frames on one stream
+        if (std::find(ports.begin(), ports.begin() + i, ports[i]) != ports.begin() + i) continue;
+        Peer& peer = peers[ports[i]];
+        int fd = acquire(ports[i], peer);
+        if (fd < 0) {
+            failed.push_back(ports[i]);
+            continue;
+        }
+        outgoing.push_back(Outgoing{i, fd, frameFor(peer.hasEncoding ? peer.encoding : header.encoding), 0, start});
+    }
+
+    // Write to whichever peers have buffer space until every frame is out,
+    // dropping peers that stall for the whole stallTimeout
+    const bool bounded = options.stallTimeout.count() > 0;
+    std::vector<pollfd> pfds;
+    while (!outgoing.empty()) {
+        auto wake = std::chrono::steady_clock::time_point::max();
+        for (size_t k = 0; k < outgoing.size();) {
+            Outgoing& out = outgoing[k];
+            if (!advance(out)) {
+                failed.push_back(ports[out.peer]);
+                fail(peers[ports[out.peer]]);
+            } else if (out.next < out.iov.size()) {
+                const auto stalledAt = out.lastProgress + options.stallTimeout;
+                if (!bounded || std::chrono::steady_clock::now() < stalledAt) {
+                    if (bounded) wake = std::min(wake, stalledAt);
+                    ++k;
+                    continue;
+                }
+                failed.push_back(ports[out.peer]);
+                fail(peers[ports[out.peer]]);
+            }
+            outgoing[k] = std::move(outgoing.back());
+            outgoing.pop_back();
+        }
+        if (outgoing.empty()) break;
+
+        int waitMs = -1;
+        if (bounded) {
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(wake - std::chrono::steady_clock::now());
+            waitMs = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(left.count(), INT_MAX)));
+        }
+
+        pfds.clear();
+        for (const Outgoing& out : outgoing) pfds.push_back(pollfd{out.fd, POLLOUT, 0});
+        if (::poll(pfds.data(), pfds.size(), waitMs) < 0 && errno != EINTR) {
+            for (const Outgoing& out : outgoing) {
+                failed.push_back(ports[out.peer]);
+                fail(peers[ports[out.peer]]);
+            }
+            break;
+        }
+    }
+    return failed;
+}
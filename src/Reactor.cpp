@@ -0,0 +1,378 @@
+#include "Reactor.h"
+#include "TensorWire.h"
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#define REACTOR_EPOLL 1
+#endif
+
+namespace {
+// Frame buffers grow by at most this much ahead of the bytes received
+constexpr size_t READ_STEP = size_t(64) << 10;
+}
+
+// Per-connection read state: the length prefix, then the payload it
+// announces, in a buffer that grows as the payload arrives. Streamed
+// frames (STREAM_FLAG, TensorWire.h) read the TENS header into the payload
+// and then land each chunk at its offset, growing the buffer with the
+// chunks, so both kinds reach the FrameHandler as one contiguous TENS
+// payload.
+struct Reactor::Connection {
+    char prefix[8];
+    size_t prefixHave = 0;
+    std::shared_ptr<std::vector<char>> payload; // null while reading the prefix
+    size_t payloadHave = 0;
+    uint64_t frameBytes = 0; // payload size once complete
+    size_t accounted = 0;    // payload capacity counted in Reactor::buffered
+
+    bool streaming = false;
+    bool headerParsed = false;
+    size_t headerBytes = 0;
+    char chunkHeader[CHUNK_HEADER_SIZE];
+    size_t chunkHave = 0;
+    uint64_t chunkRemaining = 0; // 0 while reading a chunk header
+    uint64_t dataReceived = 0;
+
+    // Where the next bytes read from the socket belong
+    void nextTarget(char*& dst, size_t& want) {
+        if (!payload) {
+            dst = prefix + prefixHave;
+            want = sizeof(prefix) - prefixHave;
+        } else if (!streaming || !headerParsed) {
+            // Reactor::prepareRead() has grown the payload past payloadHave
+            dst = payload->data() + payloadHave;
+            want = payload->size() - payloadHave;
+        } else if (chunkRemaining == 0) {
+            dst = chunkHeader + chunkHave;
+            want = CHUNK_HEADER_SIZE - chunkHave;
+        } else {
+            const size_t at = headerBytes + static_cast<size_t>(dataReceived);
+            dst = payload->data() + at;
+            want = static_cast<size_t>(std::min<uint64_t>(chunkRemaining, payload->size() - at));
+        }
+    }
+};
+
+struct Reactor::Loop {
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::thread thread;
+    // Only touched by this loop's thread
+    std::unordered_map<int, Connection> connections;
+};
+
+Reactor::Reactor(const ServerOptions& options, FrameHandler onFrame, ConnectionHandler onConnection)
+    : options(options), onFrame(std::move(onFrame)), onConnection(std::move(onConnection)) {
+    if (this->options.ioThreads == 0) this->options.ioThreads = 1;
+}
+
+Reactor::~Reactor() {
+    stop();
+}
+
+bool Reactor::supported() {
+#ifdef REACTOR_EPOLL
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef REACTOR_EPOLL
+
+bool Reactor::start(int fd) {
+    if (!loops.empty()) return false;
+    listenFd = fd;
+    int flags = fcntl(listenFd, F_GETFL, 0);
+    if (flags < 0 || fcntl(listenFd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        std::cerr << "Reactor: cannot make listening socket non-blocking\n";
+        return false;
+    }
+
+    for (size_t i = 0; i < options.ioThreads; ++i) {
+        std::unique_ptr<Loop> loop(new Loop());
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event wake{};
+        wake.events = EPOLLIN;
+        wake.data.fd = loop->wakeFd;
+        // Level-triggered accept; EPOLLEXCLUSIVE wakes one loop per
+        // connection instead of all of them
+        epoll_event accept{};
+        accept.events = EPOLLIN;
+        if (options.ioThreads > 1) accept.events |= EPOLLEXCLUSIVE;
+        accept.data.fd = listenFd;
+
+        if (loop->epollFd < 0 || loop->wakeFd < 0 ||
+            epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &wake) < 0 ||
+            epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, listenFd, &accept) < 0) {
+            std::cerr << "Reactor: epoll setup failed\n";
+            if (loop->epollFd >= 0) close(loop->epollFd);
+            if (loop->wakeFd >= 0) close(loop->wakeFd);
+            stop();
+            return false;
+        }
+        loops.push_back(std::move(loop));
+    }
+
+    for (auto& loop : loops) {
+        Loop* l = loop.get();
+        l->thread = std::thread([this, l] { run(*l); });
+    }
+    return true;
+}
+
+void Reactor::stop() {
+    for (auto& loop : loops) {
+        uint64_t one = 1;
+        if (loop->thread.joinable() && write(loop->wakeFd, &one, sizeof(one)) < 0) {
+            std::cerr << "Reactor: wake-up failed\n";
+        }
+    }
+    for (auto& loop : loops) {
+        if (loop->thread.joinable()) loop->thread.join();
+        while (!loop->connections.empty()) {
+            closeConnection(*loop, loop->connections.begin()->first);
+        }
+        close(loop->epollFd);
+        close(loop->wakeFd);
+    }
+    loops.clear();
+}
+
+void Reactor::run(Loop& loop) {
+    epoll_event events[64];
+    while (true) {
+        int n = epoll_wait(loop.epollFd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Reactor: epoll_wait failed\n";
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == loop.wakeFd) return;
+            if (fd == listenFd) {
+                acceptAll(loop);
+            } else if (!readFrames(loop, fd)) {
+                closeConnection(loop, fd);
+            }
+        }
+    }
+}
+
+void Reactor::acceptAll(Loop& loop) {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // EAGAIN: drained. EMFILE and friends: retried on the next event
+            if (errno != EAGAIN && errno != EWOULDBLOCK) std::cerr << "Reactor: accept failed\n";
+            return;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
+        }
+        loop.connections.emplace(fd, Connection());
+        if (onConnection) onConnection(fd, true);
+    }
+}
+
+// Edge-triggered: read until EAGAIN. Returns false when the connection
+// should be closed (EOF, error or an oversized frame).
+bool Reactor::readFrames(Loop& loop, int fd) {
+    auto it = loop.connections.find(fd);
+    if (it == loop.connections.end()) return true;
+    Connection& conn = it->second;
+
+    while (true) {
+        if (!prepareRead(conn)) return false;
+        char* dst;
+        size_t want;
+        conn.nextTarget(dst, want);
+
+        ssize_t r = ::read(fd, dst, want);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (r == 0) return false;
+        if (!consume(conn, fd, static_cast<size_t>(r))) return false;
+    }
+}
+
+// Makes room in the payload for the next read, a READ_STEP at most, so
+// memory follows the bytes that actually arrive rather than the announced
+// length. Returns false if the connection must close.
+bool Reactor::prepareRead(Connection& c) {
+    if (!c.payload) return true;
+    uint64_t at = c.payloadHave, end = c.frameBytes;
+    if (c.streaming) {
+        // The header was sized up front; chunk data grows with each chunk
+        if (!c.headerParsed || c.chunkRemaining == 0) return true;
+        at = c.headerBytes + c.dataReceived;
+        end = at + c.chunkRemaining;
+    }
+    if (c.payload->size() > at) return true;
+    return grow(c, static_cast<size_t>(std::min(end, at + READ_STEP)));
+}
+
+// Resizes the payload to `bytes` (at most frameBytes). Capacity at least
+// doubles so copies stay amortised, and counts against maxBufferedBytes.
+bool Reactor::grow(Connection& c, size_t bytes) {
+    if (c.payload->capacity() < bytes) {
+        const size_t capacity = static_cast<size_t>(
+            std::min<uint64_t>(c.frameBytes, std::max<uint64_t>(bytes, uint64_t(c.payload->capacity()) * 2)));
+        const uint64_t added = capacity - c.accounted;
+        if (buffered.fetch_add(added) + added > options.maxBufferedBytes) {
+            buffered.fetch_sub(added);
+            std::cerr << "Reactor: receive buffers over " << options.maxBufferedBytes
+                      << " bytes, closing connection\n";
+            return false;
+        }
+        c.accounted = capacity;
+        c.payload->reserve(capacity);
+    }
+    c.payload->resize(bytes);
+    return true;
+}
+
+void Reactor::releaseBuffer(Connection& c) {
+    buffered.fetch_sub(c.accounted);
+    c.accounted = 0;
+}
+
+// Accounts for n bytes just read into Connection::nextTarget(); delivers completed
+// frames. Returns false if the stream is malformed or over the limit.
+bool Reactor::consume(Connection& c, int fd, size_t n) {
+    if (!c.payload) {
+        c.prefixHave += n;
+        if (c.prefixHave < sizeof(c.prefix)) return true;
+        c.prefixHave = 0;
+        uint64_t len = decodeLengthPrefix(c.prefix);
+        c.payloadHave = 0;
+        if (len & STREAM_FLAG) {
+            len &= ~STREAM_FLAG;
+            if (len < 16 || len > MAX_WIRE_HEADER - 8) {
+                std::cerr << "Reactor: bad stream header size, closing connection\n";
+                return false;
+            }
+            c.streaming = true;
+            c.headerParsed = false;
+            c.headerBytes = static_cast<size_t>(len);
+            c.chunkHave = 0;
+            c.chunkRemaining = 0;
+            c.dataReceived = 0;
+        } else {
+            if (len > options.maxFrameBytes) {
+                std::cerr << "Reactor: frame of " << len << " bytes exceeds limit, closing connection\n";
+                return false;
+            }
+            c.streaming = false;
+        }
+        c.frameBytes = len;
+        c.payload = std::make_shared<std::vector<char>>();
+        if (c.streaming) return grow(c, c.headerBytes);
+        if (len == 0) deliver(c, fd);
+        return true;
+    }
+
+    if (!c.streaming) {
+        c.payloadHave += n;
+        if (c.payloadHave == c.frameBytes) deliver(c, fd);
+        return true;
+    }
+
+    if (!c.headerParsed) {
+        c.payloadHave += n;
+        if (c.payloadHave < c.headerBytes) return true;
+        std::vector<size_t> shape;
+        uint64_t nelems = 0;
+        BinaryFormat format;
+        if (Tensor::parseBinaryHeader(c.payload->data(), c.headerBytes, shape, nelems, &format) != c.headerBytes ||
+            nelems > (options.maxFrameBytes - std::min<uint64_t>(options.maxFrameBytes, c.headerBytes)) /
+                         dtypeSize(format.dtype)) {
+            std::cerr << "Reactor: bad or oversized tensor stream, closing connection\n";
+            return false;
+        }
+        // The (still encoded) tensor is assembled in the payload as chunks
+        // arrive; the frame handler decodes it like a plain frame
+        c.frameBytes = c.headerBytes + format.dataBytes(nelems);
+        c.headerParsed = true;
+        if (nelems == 0) deliver(c, fd);
+        return true;
+    }
+
+    const uint64_t dataBytes = c.frameBytes - c.headerBytes;
+    if (c.chunkRemaining == 0) {
+        c.chunkHave += n;
+        if (c.chunkHave < CHUNK_HEADER_SIZE) return true;
+        c.chunkHave = 0;
+        uint64_t offset;
+        uint32_t len;
+        if (!decodeChunkHeader(c.chunkHeader, offset, len) || offset != c.dataReceived || len == 0 ||
+            len > dataBytes - c.dataReceived) {
+            std::cerr << "Reactor: malformed tensor chunk, closing connection\n";
+            return false;
+        }
+        c.chunkRemaining = len;
+        return true;
+    }
+
+    c.chunkRemaining -= n;
+    c.dataReceived += n;
+    if (c.dataReceived == dataBytes) deliver(c, fd);
+    return true;
+}
+
+void Reactor::deliver(Connection& c, int fd) {
+    releaseBuffer(c);
+    std::shared_ptr<std::vector<char>> frame = std::move(c.payload);
+    c.payload.reset();
+    c.streaming = false;
+    onFrame(fd, std::move(frame));
+}
+
+void Reactor::closeConnection(Loop& loop, int fd) {
+    if (onConnection) onConnection(fd, false);
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    auto it = loop.connections.find(fd);
+    if (it == loop.connections.end()) return;
+    releaseBuffer(it->second);
+    loop.connections.erase(it);
+}
+
+#else // !REACTOR_EPOLL
+
+bool Reactor::start(int) {
+    return false;
+}
+
+void Reactor::stop() {}
+void Reactor::run(Loop&) {}
+void Reactor::acceptAll(Loop&) {}
+bool Reactor::readFrames(Loop&, int) { return false; }
+bool Reactor::prepareRead(Connection&) { return false; }
+bool Reactor::grow(Connection&, size_t) { return false; }
+void Reactor::releaseBuffer(Connection&) {}
+bool Reactor::consume(Connection&, int, size_t) { return false; }
+void Reactor::deliver(Connection&, int) {}
+void Reactor::closeConnection(Loop&, int) {}
+
+#endif // REACTOR_EPOLL
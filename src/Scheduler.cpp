@@ -1,13 +1,195 @@
 #include "Scheduler.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
 
-Scheduler::Scheduler(size_t numThreads) : threadPool(numThreads) {}
+static SchedulerOptions withComputeThreads(size_t numThreads) {
+    SchedulerOptions options;
+    options.computeThreads = numThreads;
+    return options;
+}
+
+Scheduler::Scheduler(size_t numThreads) : Scheduler(withComputeThreads(numThreads)) {}
+
+Scheduler::Scheduler(const SchedulerOptions& options) : options(options) {
+    startLane(compute, "compute", options.computeThreads, options.maxQueuedCompute);
+    startLane(io, "io", options.ioThreads, options.maxQueuedIo);
+}
 
 Scheduler::~Scheduler() {
-    // ThreadPool destructor handles stopping threads
+    stopLane(compute);
+    stopLane(io);
+}
+
+bool Scheduler::RunsLater::operator()(const std::shared_ptr<Entry>& a, const std::shared_ptr<Entry>& b) const {
+    if (a->task.priority != b->task.priority) return a->task.priority < b->task.priority;
+    if (a->task.deadline != b->task.deadline) return a->task.deadline > b->task.deadline;
+    return a->sequence > b->sequence;
+}
+
+Scheduler::Lane& Scheduler::laneFor(TaskType type) {
+    return type == TaskType::IO ? io : compute;
+}
+
+const Scheduler::Lane& Scheduler::laneFor(TaskType type) const {
+    return type == TaskType::IO ? io : compute;
+}
+
+void Scheduler::startLane(Lane& lane, const char* name, size_t threads, size_t maxQueued) {
+    if (threads == 0) throw std::runtime_error("Scheduler lanes need at least one thread");
+    lane.maxQueued = maxQueued;
+    if (options.metrics) {
+        const std::string prefix = std::string("scheduler.") + name;
+        lane.queueWait = &options.metrics->histogram(prefix + ".queue_wait");
+        lane.execute = &options.metrics->histogram(prefix + ".execute");
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        lane.workers.emplace_back(&Scheduler::workerLoop, this, std::ref(lane));
+    }
+}
+
+void Scheduler::stopLane(Lane& lane) {
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.stop = true;
+    }
+    lane.ready.notify_all();
+    lane.space.notify_all();
+    for (std::thread& worker : lane.workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+bool Scheduler::submitTask(const Task& task) {
+    Lane& lane = laneFor(task.type);
+    auto entry = std::make_shared<Entry>(Entry{task, nextSequence.fetch_add(1), std::chrono::steady_clock::now()});
+    {
+        std::unique_lock<std::mutex> lock(lane.mutex);
+        auto full = [&lane] { return lane.maxQueued > 0 && lane.queue.size() >= lane.maxQueued; };
+        // Expired entries give their slots back before the lane counts as full
+        auto purge = [this, &lane, &full] {
+            const auto now = std::chrono::steady_clock::now();
+            if (full() && now >= lane.earliestDeadline && purgeExpired(lane, now) > 0) lane.ready.notify_all();
+        };
+        purge();
+        if (full()) {
+            while (options.blockWhenFull && !lane.stop && full()) {
+                if (lane.earliestDeadline == std::chrono::steady_clock::time_point::max()) {
+                    lane.space.wait(lock);
+                } else {
+                    lane.space.wait_until(lock, lane.earliestDeadline);
+                }
+                purge();
+            }
+            if (lane.stop || full()) {
+                ++lane.stats.rejected;
+                return false;
+            }
+        }
+        if (lane.stop) return false;
+        lane.earliestDeadline = std::min(lane.earliestDeadline, entry->task.deadline);
+        lane.queue.push_back(std::move(entry));
+        std::push_heap(lane.queue.begin(), lane.queue.end(), RunsLater());
+        lane.stats.queued = lane.queue.size() + lane.expired.size();
+    }
+    lane.ready.notify_one();
+    return true;
+}
+
+size_t Scheduler::purgeExpired(Lane& lane, std::chrono::steady_clock::time_point now) {
+    auto live = std::partition(lane.queue.begin(), lane.queue.end(),
+                               [now](const std::shared_ptr<Entry>& e) { return now < e->task.deadline; });
+    const size_t moved = static_cast<size_t>(lane.queue.end() - live);
+    lane.expired.insert(lane.expired.end(), live, lane.queue.end());
+    lane.queue.erase(live, lane.queue.end());
+    std::make_heap(lane.queue.begin(), lane.queue.end(), RunsLater());
+    lane.earliestDeadline = std::chrono::steady_clock::time_point::max();
+    for (const auto& e : lane.queue) lane.earliestDeadline = std::min(lane.earliestDeadline, e->task.deadline);
+    return moved;
+}
+
+void Scheduler::drain() {
+    // A task may submit to the other lane, so wait until one pass finds
+    // both idle without waiting
+    while (true) {
+        const bool computeWasIdle = waitIdle(compute);
+        const bool ioWasIdle = waitIdle(io);
+        if (computeWasIdle && ioWasIdle) return;
+    }
 }
 
-void Scheduler::submitTask(const Task& task) {
-    threadPool.enqueue([task]() {
-        task.work(task.tensor);
-    });
+bool Scheduler::waitIdle(Lane& lane) {
+    std::unique_lock<std::mutex> lock(lane.mutex);
+    auto idle = [&lane] { return lane.queue.empty() && lane.expired.empty() && lane.stats.running == 0; };
+    if (idle()) return true;
+    lane.idle.wait(lock, idle);
+    return false;
+}
+
+SchedulerStats Scheduler::stats(TaskType type) const {
+    const Lane& lane = laneFor(type);
+    std::lock_guard<std::mutex> lock(lane.mutex);
+    return lane.stats;
+}
+
+void Scheduler::workerLoop(Lane& lane) {
+    while (true) {
+        std::shared_ptr<Entry> entry;
+        bool purged = false;
+        {
+            std::unique_lock<std::mutex> lock(lane.mutex);
+            lane.ready.wait(lock, [&lane] { return lane.stop || !lane.queue.empty() || !lane.expired.empty(); });
+            // Expired entries go first, so low priorities cannot starve them
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= lane.earliestDeadline) purged = purgeExpired(lane, now) > 0;
+            if (!lane.expired.empty()) {
+                entry = std::move(lane.expired.front());
+                lane.expired.pop_front();
+            } else if (lane.queue.empty()) {
+                return; // stopping and drained
+            } else {
+                std::pop_heap(lane.queue.begin(), lane.queue.end(), RunsLater());
+                entry = std::move(lane.queue.back());
+                lane.queue.pop_back();
+            }
+            lane.stats.queued = lane.queue.size() + lane.expired.size();
+            ++lane.stats.running;
+        }
+        if (purged) {
+            lane.space.notify_all();
+            lane.ready.notify_all();
+        } else {
+            lane.space.notify_one();
+        }
+
+        Task& task = entry->task;
+        const auto started = std::chrono::steady_clock::now();
+        const bool expired = started >= task.deadline;
+        if (lane.queueWait) {
+            lane.queueWait->record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(started - entry->enqueued).count()));
+        }
+        try {
+            if (expired) {
+                if (task.onExpired) task.onExpired();
+            } else if (task.work) {
+                task.work(task.tensor);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Task " << task.name << " failed: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Task " << task.name << " failed" << std::endl;
+        }
+        if (lane.execute && !expired) lane.execute->recordSince(started);
+
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        --lane.stats.running;
+        if (expired) {
+            ++lane.stats.expired;
+        } else {
+            ++lane.stats.completed;
+        }
+        if (lane.queue.empty() && lane.expired.empty() && lane.stats.running == 0) lane.idle.notify_all();
+    }
 }
@@ -1,22 +1,82 @@
 #include "Tensor.h"
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
 #include <sstream>
+#include <cstring>
+#include <stdexcept>
 
 Tensor::Tensor() {}
 
-Tensor::Tensor(const std::vector<size_t>& shape) : shape(shape) {
+// Row-major strides for `shape`
+static std::vector<size_t> rowMajorStrides(const std::vector<size_t>& shape) {
+    std::vector<size_t> strides(shape.size());
+    size_t step = 1;
+    for (size_t d = shape.size(); d-- > 0;) {
+        strides[d] = step;
+        step *= shape[d];
+    }
+    return strides;
+}
+
+Tensor::Tensor(const std::vector<size_t>& shape, DType dtype)
+    : shape(shape), strides(rowMajorStrides(shape)), type(dtype) {
     size_t totalSize = 1;
     for (size_t dim : shape) {
         totalSize *= dim;
     }
-    data.resize(totalSize, 0.0f);
+    numel = totalSize;
+    storage = TensorStorage::allocate(totalSize * dtypeSize(dtype));
+}
+
+Tensor Tensor::uninitialized(const std::vector<size_t>& shape, DType dtype) {
+    Tensor t;
+    t.shape = shape;
+    t.strides = rowMajorStrides(shape);
+    t.type = dtype;
+    t.numel = 1;
+    for (size_t dim : shape) t.numel *= dim;
+    t.storage = TensorStorage::allocateUninitialized(t.numel * dtypeSize(dtype));
+    return t;
+}
+
+Tensor Tensor::reuse(Tensor&& buffer, const std::vector<size_t>& shape, DType dtype) {
+    size_t count = 1;
+    for (size_t dim : shape) count *= dim;
+    std::shared_ptr<TensorStorage> storage = std::move(buffer.storage);
+    buffer = Tensor();
+    if (!storage || !storage->writable() || storage.use_count() != 1 || storage->bytes() < count * dtypeSize(dtype)) {
+        return uninitialized(shape, dtype);
+    }
+    Tensor t;
+    t.shape = shape;
+    t.strides = rowMajorStrides(shape);
+    t.type = dtype;
+    t.numel = count;
+    t.storage = std::move(storage);
+    return t;
+}
+
+static void requireFloat(DType dtype) {
+    if (dtype != DType::FLOAT32) {
+        throw std::runtime_error(std::string("Float access to a ") + dtypeName(dtype) + " tensor");
+    }
 }
 
-float& Tensor::operator[](size_t index) {
-    return data[index];
+float& Tensor::mutableElement(size_t index) {
+    return dataPtr()[index];
 }
 
 const float& Tensor::operator[](size_t index) const {
-    return data[index];
+    if (packed) return dataPtr()[index];
+    requireFloat(type);
+    size_t at = 0;
+    for (size_t d = shape.size(); d-- > 0;) {
+        at += index % shape[d] * strides[d];
+        index /= shape[d];
+    }
+    return reinterpret_cast<const float*>(base())[at];
 }
 
 const std::vector<size_t>& Tensor::getShape() const {
@@ -24,92 +84,566 @@ const std::vector<size_t>& Tensor::getShape() const {
 }
 
 size_t Tensor::size() const {
-    return data.size();
+    return numel;
+}
+
+DType Tensor::dtype() const {
+    return type;
+}
+
+size_t Tensor::nbytes() const {
+    return numel * dtypeSize(type);
+}
+
+float* Tensor::dataPtr() {
+    requireFloat(type);
+    return static_cast<float*>(rawData());
+}
+
+const float* Tensor::dataPtr() const {
+    requireFloat(type);
+    return static_cast<const float*>(rawData());
+}
+
+void* Tensor::rawData() {
+    detach();
+    return storage ? base() : nullptr;
+}
+
+const void* Tensor::rawData() const {
+    if (!packed) throw std::runtime_error("Tensor view is not contiguous");
+    return storage ? base() : nullptr;
+}
+
+char* Tensor::base() const {
+    return static_cast<char*>(storage->data()) + storageOffset * dtypeSize(type);
+}
+
+bool Tensor::isReadOnlyView() const {
+    return storage && !storage->writable();
+}
+
+void Tensor::detach() {
+    if (!storage) return;
+    if (storage->writable() && storage.use_count() == 1 && packed) return;
+
+    std::shared_ptr<TensorStorage> copy = TensorStorage::allocateUninitialized(nbytes());
+    gather(0, numel, copy->data());
+    storage = std::move(copy);
+    storageOffset = 0;
+    strides = rowMajorStrides(shape);
+    packed = true;
+}
+
+// Copies `count` elements starting at multi-index `index` (row-major
+// order) of a strided layout, a row at a time
+template <typename T>
+static void gatherStrided(const T* base, const std::vector<size_t>& shape, const std::vector<size_t>& strides,
+                          std::vector<size_t>& index, size_t count, T* out) {
+    const size_t rank = shape.size();
+    const size_t inner = shape[rank - 1];
+    const size_t innerStride = strides[rank - 1];
+    while (count > 0) {
+        size_t at = 0;
+        for (size_t d = 0; d < rank; ++d) at += index[d] * strides[d];
+        const size_t run = std::min(count, inner - index[rank - 1]);
+        const T* src = base + at;
+        if (innerStride == 1) {
+            std::memcpy(out, src, run * sizeof(T));
+        } else {
+            for (size_t i = 0; i < run; ++i) out[i] = src[i * innerStride];
+        }
+        out += run;
+        count -= run;
+
+        index[rank - 1] = 0;
+        for (size_t d = rank - 1; d-- > 0;) {
+            if (++index[d] < shape[d]) break;
+            index[d] = 0;
+        }
+    }
+}
+
+void Tensor::gather(size_t first, size_t count, void* out) const {
+    if (count == 0) return;
+    if (first > numel || count > numel - first) throw std::runtime_error("Tensor gather out of range");
+    const size_t elemSize = dtypeSize(type);
+    if (packed) {
+        std::memcpy(out, base() + first * elemSize, count * elemSize);
+        return;
+    }
+
+    // Non-contiguous layouts have rank >= 1 and no empty axes
+    std::vector<size_t> index(shape.size());
+    for (size_t d = shape.size(); d-- > 0;) {
+        index[d] = first % shape[d];
+        first /= shape[d];
+    }
+    switch (elemSize) {
+    case 1:
+        gatherStrided(reinterpret_cast<const uint8_t*>(base()), shape, strides, index, count,
+                      static_cast<uint8_t*>(out));
+        break;
+    case 2:
+        gatherStrided(reinterpret_cast<const uint16_t*>(base()), shape, strides, index, count,
+                      static_cast<uint16_t*>(out));
+        break;
+    case 4:
+        gatherStrided(reinterpret_cast<const uint32_t*>(base()), shape, strides, index, count,
+                      static_cast<uint32_t*>(out));
+        break;
+    default:
+        gatherStrided(reinterpret_cast<const uint64_t*>(base()), shape, strides, index, count,
+                      static_cast<uint64_t*>(out));
+        break;
+    }
+}
+
+const std::vector<size_t>& Tensor::getStrides() const {
+    return strides;
+}
+
+bool Tensor::isContiguous() const {
+    return packed;
+}
+
+void Tensor::refreshLayout() {
+    numel = 1;
+    for (size_t dim : shape) numel *= dim;
+    // Size-1 axes are never stepped along, so their strides don't matter;
+    // empty tensors have nothing to lay out
+    packed = true;
+    size_t step = 1;
+    for (size_t d = shape.size(); d-- > 0 && numel > 0;) {
+        if (shape[d] != 1 && strides[d] != step) {
+            packed = false;
+            break;
+        }
+        step *= shape[d];
+    }
+}
+
+Tensor Tensor::contiguous() const {
+    if (packed) return *this;
+    Tensor out = uninitialized(shape, type);
+    gather(0, numel, out.rawData());
+    return out;
+}
+
+Tensor Tensor::reshape(const std::vector<size_t>& newShape) const {
+    size_t count = 1;
+    for (size_t dim : newShape) count *= dim;
+    if (count != numel) throw std::runtime_error("reshape: element count differs");
+    if (!packed) return contiguous().reshape(newShape);
+
+    Tensor view = *this;
+    view.shape = newShape;
+    view.strides = rowMajorStrides(newShape);
+    return view;
+}
+
+Tensor Tensor::slice(size_t axis, size_t start, size_t end, size_t step) const {
+    if (axis >= shape.size()) throw std::runtime_error("slice: axis out of range");
+    if (start > end || end > shape[axis] || step == 0) throw std::runtime_error("slice: invalid range");
+
+    Tensor view = *this;
+    view.shape[axis] = (end - start + step - 1) / step;
+    if (view.shape[axis] > 0) view.storageOffset += start * strides[axis];
+    view.strides[axis] *= step;
+    view.refreshLayout();
+    return view;
+}
+
+Tensor Tensor::transpose(size_t axis0, size_t axis1) const {
+    if (axis0 >= shape.size() || axis1 >= shape.size()) throw std::runtime_error("transpose: axis out of range");
+    std::vector<size_t> order(shape.size());
+    for (size_t d = 0; d < order.size(); ++d) order[d] = d;
+    std::swap(order[axis0], order[axis1]);
+    return permute(order);
+}
+
+Tensor Tensor::permute(const std::vector<size_t>& order) const {
+    if (order.size() != shape.size()) throw std::runtime_error("permute: order must name every axis");
+    std::vector<bool> seen(shape.size(), false);
+    Tensor view = *this;
+    for (size_t d = 0; d < order.size(); ++d) {
+        if (order[d] >= shape.size() || seen[order[d]]) throw std::runtime_error("permute: invalid axis order");
+        seen[order[d]] = true;
+        view.shape[d] = shape[order[d]];
+        view.strides[d] = strides[order[d]];
+    }
+    view.refreshLayout();
+    return view;
+}
+
+Tensor Tensor::broadcastTo(const std::vector<size_t>& target) const {
+    if (target.size() < shape.size()) throw std::runtime_error("broadcastTo: target has fewer axes");
+    const size_t lead = target.size() - shape.size();
+    Tensor view = *this;
+    view.shape = target;
+    view.strides.assign(target.size(), 0);
+    for (size_t d = 0; d < shape.size(); ++d) {
+        if (shape[d] == target[lead + d]) {
+            view.strides[lead + d] = strides[d];
+        } else if (shape[d] != 1) {
+            throw std::runtime_error("broadcastTo: shapes are not compatible");
+        }
+    }
+    view.refreshLayout();
+    // Repeating nothing is still nothing
+    if (view.numel > 0 && numel == 0) throw std::runtime_error("broadcastTo: shapes are not compatible");
+    return view;
+}
+
+// Non-float32 operands and non-contiguous views are gathered into stack
+// buffers of this many floats, run through the float32 kernel and the
+// result narrowed back
+static constexpr size_t CAST_BLOCK = 1024;
+
+Tensor Tensor::cast(DType dtype) const {
+    if (dtype == type) return *this;
+    Tensor out = uninitialized(shape, dtype);
+    char* dst = static_cast<char*>(out.rawData());
+    if (packed) {
+        convertElements(type, rawData(), dtype, dst, numel);
+        return out;
+    }
+    alignas(8) char block[CAST_BLOCK * sizeof(double)];
+    for (size_t i = 0; i < numel; i += CAST_BLOCK) {
+        const size_t len = std::min(CAST_BLOCK, numel - i);
+        gather(i, len, block);
+        convertElements(type, block, dtype, dst + i * dtypeSize(dtype), len);
+    }
+    return out;
+}
+
+// Floats [first, first + len) of t: in place for contiguous float32, else
+// gathered and/or widened into `buffer`
+static const float* widen(const Tensor& t, size_t first, size_t len, float* buffer) {
+    if (t.isContiguous()) {
+        if (t.dtype() == DType::FLOAT32) return t.dataPtr() + first;
+        const char* bytes = static_cast<const char*>(t.rawData()) + first * dtypeSize(t.dtype());
+        convertElements(t.dtype(), bytes, DType::FLOAT32, buffer, len);
+        return buffer;
+    }
+    if (t.dtype() == DType::FLOAT32) {
+        t.gather(first, len, buffer);
+        return buffer;
+    }
+    alignas(8) char raw[CAST_BLOCK * sizeof(double)];
+    t.gather(first, len, raw);
+    convertElements(t.dtype(), raw, DType::FLOAT32, buffer, len);
+    return buffer;
+}
+
+// Contiguous float32 operands go straight to the kernel
+static bool direct(const Tensor* t) {
+    return !t || (t->dtype() == DType::FLOAT32 && t->isContiguous());
+}
+
+// Tensors below this many elements are not worth splitting across a pool
+static constexpr size_t PARALLEL_MIN_ELEMENTS = size_t(1) << 16;
+// Smallest chunk handed to a pool thread
+static constexpr size_t PARALLEL_GRAIN = size_t(1) << 14;
+
+static bool splitAcross(ThreadPool* pool, size_t n) {
+    return pool && n >= PARALLEL_MIN_ELEMENTS;
+}
+
+// out = fn(a, b, c) elementwise, with b and c optional. Results take a's
+// shape and dtype.
+template <typename Fn>
+static Tensor elementwise(const Tensor& a, const Tensor* b, const Tensor* c, Fn fn, ThreadPool* pool) {
+    Tensor out = Tensor::uninitialized(a.getShape(), a.dtype());
+    const size_t n = a.size();
+    char* outBytes = static_cast<char*>(out.rawData());
+    const bool fast = direct(&a) && direct(b) && direct(c);
+
+    auto range = [&](size_t first, size_t last) {
+        if (fast) {
+            fn(a.dataPtr() + first, b ? b->dataPtr() + first : nullptr, c ? c->dataPtr() + first : nullptr,
+               reinterpret_cast<float*>(outBytes) + first, last - first);
+            return;
+        }
+        float bufA[CAST_BLOCK], bufB[CAST_BLOCK], bufC[CAST_BLOCK], bufOut[CAST_BLOCK];
+        for (size_t i = first; i < last; i += CAST_BLOCK) {
+            const size_t len = std::min(CAST_BLOCK, last - i);
+            fn(widen(a, i, len, bufA), b ? widen(*b, i, len, bufB) : nullptr, c ? widen(*c, i, len, bufC) : nullptr,
+               bufOut, len);
+            convertElements(DType::FLOAT32, bufOut, out.dtype(), outBytes + i * dtypeSize(out.dtype()), len);
+        }
+    };
+    if (splitAcross(pool, n)) {
+        pool->parallel_for(0, n, PARALLEL_GRAIN, range);
+    } else {
+        range(0, n);
+    }
+    return out;
+}
+
+// Folds fn over blocks of a (and b): fn(pa, pb, len) gives each block's
+// partial result and combine merges them
+template <typename Fn, typename Combine>
+static float reduceBlocks(const Tensor& a, const Tensor* b, float init, Fn fn, Combine combine, ThreadPool* pool) {
+    const size_t n = a.size();
+    const bool fast = direct(&a) && direct(b);
+
+    auto range = [&](size_t first, size_t last) {
+        if (fast) return fn(a.dataPtr() + first, b ? b->dataPtr() + first : nullptr, last - first);
+        float bufA[CAST_BLOCK], bufB[CAST_BLOCK];
+        float acc = init;
+        for (size_t i = first; i < last; i += CAST_BLOCK) {
+            const size_t len = std::min(CAST_BLOCK, last - i);
+            acc = combine(acc, fn(widen(a, i, len, bufA), b ? widen(*b, i, len, bufB) : nullptr, len));
+        }
+        return acc;
+    };
+    if (splitAcross(pool, n)) return pool->parallel_reduce(size_t(0), n, PARALLEL_GRAIN, init, range, combine);
+    return range(0, n);
+}
+
+static void requireSameSize(const Tensor& a, const Tensor& b, const char* op) {
+    if (a.size() != b.size()) {
+        throw std::runtime_error(std::string("Tensor size mismatch in ") + op);
+    }
+}
+
+// b as an operand of a: as is with the same number of elements, else
+// broadcast to a's shape
+static Tensor operand(const Tensor& a, const Tensor& b, const char* op) {
+    if (a.size() == b.size()) return b;
+    try {
+        return b.broadcastTo(a.getShape());
+    } catch (const std::runtime_error&) {
+        throw std::runtime_error(std::string("Tensor size mismatch in ") + op);
+    }
+}
+
+Tensor Tensor::add(const Tensor& other, ThreadPool* pool) const {
+    const Tensor rhs = operand(*this, other, "add");
+    return elementwise(*this, &rhs, nullptr, [](const float* a, const float* b, const float*, float* out, size_t n) {
+        kernels::add(a, b, out, n);
+    }, pool);
+}
+
+Tensor Tensor::mul(const Tensor& other, ThreadPool* pool) const {
+    const Tensor rhs = operand(*this, other, "mul");
+    return elementwise(*this, &rhs, nullptr, [](const float* a, const float* b, const float*, float* out, size_t n) {
+        kernels::mul(a, b, out, n);
+    }, pool);
+}
+
+Tensor Tensor::scale(float factor, ThreadPool* pool) const {
+    return elementwise(*this, nullptr, nullptr, [factor](const float* a, const float*, const float*, float* out, size_t n) {
+        kernels::scale(a, factor, out, n);
+    }, pool);
+}
+
+Tensor Tensor::fma(const Tensor& b, const Tensor& c, ThreadPool* pool) const {
+    const Tensor y = operand(*this, b, "fma");
+    const Tensor z = operand(*this, c, "fma");
+    return elementwise(*this, &y, &z, [](const float* x, const float* y, const float* z, float* out, size_t n) {
+        kernels::fma(x, y, z, out, n);
+    }, pool);
+}
+
+Tensor Tensor::relu(ThreadPool* pool) const {
+    return elementwise(*this, nullptr, nullptr, [](const float* a, const float*, const float*, float* out, size_t n) {
+        kernels::relu(a, out, n);
+    }, pool);
+}
+
+Tensor Tensor::gelu(ThreadPool* pool) const {
+    return elementwise(*this, nullptr, nullptr, [](const float* a, const float*, const float*, float* out, size_t n) {
+        kernels::gelu(a, out, n);
+    }, pool);
+}
+
+float Tensor::sum(ThreadPool* pool) const {
+    return reduceBlocks(*this, nullptr, 0.0f, [](const float* a, const float*, size_t n) { return kernels::sum(a, n); },
+                        [](float x, float y) { return x + y; }, pool);
+}
+
+float Tensor::max(ThreadPool* pool) const {
+    return reduceBlocks(*this, nullptr, -INFINITY, [](const float* a, const float*, size_t n) { return kernels::max(a, n); },
+                        [](float x, float y) { return std::max(x, y); }, pool);
+}
+
+float Tensor::mean(ThreadPool* pool) const {
+    if (numel == 0) return 0.0f;
+    return sum(pool) / static_cast<float>(size());
+}
+
+float Tensor::dot(const Tensor& other, ThreadPool* pool) const {
+    requireSameSize(*this, other, "dot");
+    return reduceBlocks(*this, &other, 0.0f, [](const float* a, const float* b, size_t n) { return kernels::dot(a, b, n); },
+                        [](float x, float y) { return x + y; }, pool);
 }
 
 // Compact binary format:
 //  - 4 bytes magic: 'TENS'
 //  - 1 byte version (1)
-//  - 1 byte dtype (1 = float32)
-//  - 2 bytes reserved
+//  - 1 byte dtype (DType, or WireEncoding of float32 data)
+//  - 1 byte decoded dtype: 0 = the data's own dtype, 1 = float32 encoded
+//    as the dtype byte says (see BinaryFormat)
+//  - 1 byte reserved
 //  - uint64_t dims (little-endian)
 //  - dims * uint64_t shape entries (little-endian)
 //  - uint64_t nelems (little-endian)
-//  - raw float bytes (little-endian float32)
-std::vector<char> Tensor::serializeBinary() const {
-    std::vector<char> out;
-
-    // header
-    out.push_back('T'); out.push_back('E'); out.push_back('N'); out.push_back('S');
-    out.push_back(1); // version
-    out.push_back(1); // dtype = float32
-    out.push_back(0); out.push_back(0); // reserved
-
-    auto append_u64_le = [&](uint64_t v) {
-        for (int i = 0; i < 8; ++i) {
-            out.push_back(static_cast<char>(v & 0xFF));
-            v >>= 8;
-        }
-    };
-
-    append_u64_le(static_cast<uint64_t>(shape.size()));
-    for (size_t d : shape) append_u64_le(static_cast<uint64_t>(d));
-    append_u64_le(static_cast<uint64_t>(data.size()));
+//  - data bytes (little-endian)
+static void write_u64_le(char* out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<char>(v & 0xFF);
+        v >>= 8;
+    }
+}
 
-    if (!data.empty()) {
-        const char* bytes = reinterpret_cast<const char*>(data.data());
-        out.insert(out.end(), bytes, bytes + data.size() * sizeof(float));
+static uint64_t read_u64_le(const char* in) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | static_cast<uint8_t>(in[i]);
     }
+    return v;
+}
 
-    return out;
+size_t Tensor::binaryHeaderSize() const {
+    return 8 + 8 + shape.size() * 8 + 8;
 }
 
-Tensor Tensor::deserializeBinary(const std::vector<char>& bytes) {
-    size_t offset = 0;
-    auto need = [&](size_t n) { return offset + n <= bytes.size(); };
+uint64_t BinaryFormat::dataBytes(uint64_t nelems) const {
+    if (encoding != WireEncoding::FLOAT32) return encodedBytes(encoding, nelems);
+    return nelems * dtypeSize(dtype);
+}
+
+size_t Tensor::writeBinaryHeader(char* out, WireEncoding encoding) const {
+    if (shape.size() > MAX_DIMS) throw std::runtime_error("Tensor rank exceeds binary format limit");
+
+    out[0] = 'T'; out[1] = 'E'; out[2] = 'N'; out[3] = 'S';
+    out[4] = 1; // version
+    if (encoding != WireEncoding::FLOAT32 && type == DType::FLOAT32) {
+        out[5] = static_cast<char>(encoding);
+        out[6] = static_cast<char>(DType::FLOAT32);
+    } else {
+        out[5] = static_cast<char>(type);
+        out[6] = 0;
+    }
+    out[7] = 0; // reserved
+
+    size_t offset = 8;
+    write_u64_le(out + offset, static_cast<uint64_t>(shape.size()));
+    offset += 8;
+    for (size_t d : shape) {
+        write_u64_le(out + offset, static_cast<uint64_t>(d));
+        offset += 8;
+    }
+    write_u64_le(out + offset, static_cast<uint64_t>(numel));
+    return offset + 8;
+}
 
-    if (!need(8)) throw std::runtime_error("Invalid serialized tensor (header)");
+size_t Tensor::parseBinaryHeader(const char* bytes, size_t len,
+                                 std::vector<size_t>& shapeOut, uint64_t& nelems,
+                                 BinaryFormat* format) {
+    if (len < 16) return 0;
     if (bytes[0] != 'T' || bytes[1] != 'E' || bytes[2] != 'N' || bytes[3] != 'S')
         throw std::runtime_error("Invalid tensor magic");
     uint8_t version = static_cast<uint8_t>(bytes[4]);
     if (version != 1) throw std::runtime_error("Unsupported tensor version");
-    uint8_t dtype = static_cast<uint8_t>(bytes[5]);
-    if (dtype != 1) throw std::runtime_error("Unsupported tensor dtype");
-    offset = 8;
-
-    auto read_u64_le = [&](uint64_t &out) -> bool {
-        if (!need(8)) return false;
-        uint64_t v = 0;
-        for (int i = 7; i >= 0; --i) {
-            v = (v << 8) | static_cast<uint8_t>(bytes[offset + i]);
-        }
-        out = v;
-        offset += 8;
-        return true;
-    };
+    const uint8_t code = static_cast<uint8_t>(bytes[5]);
+    const uint8_t decoded = static_cast<uint8_t>(bytes[6]);
+    BinaryFormat parsed;
+    if (decoded == 0 && isDType(code)) {
+        parsed.dtype = static_cast<DType>(code);
+    } else if ((decoded == static_cast<uint8_t>(DType::FLOAT32) && isWireEncoding(code)) ||
+               (decoded == 0 && code == static_cast<uint8_t>(WireEncoding::QINT8))) {
+        parsed.encoding = static_cast<WireEncoding>(code);
+    } else {
+        throw std::runtime_error("Unsupported tensor dtype");
+    }
+    if (!format && (parsed.dtype != DType::FLOAT32 || parsed.encoding != WireEncoding::FLOAT32))
+        throw std::runtime_error("Unsupported tensor dtype");
 
-    uint64_t dims = 0;
-    if (!read_u64_le(dims)) throw std::runtime_error("Invalid serialized tensor (dims)");
+    uint64_t dims = read_u64_le(bytes + 8);
+    if (dims > MAX_DIMS) throw std::runtime_error("Invalid serialized tensor (dims)");
+    size_t headerSize = 16 + static_cast<size_t>(dims) * 8 + 8;
+    if (len < headerSize) return 0;
 
-    std::vector<size_t> shape;
+    shapeOut.clear();
+    uint64_t expected = 1;
     for (uint64_t i = 0; i < dims; ++i) {
-        uint64_t v = 0;
-        if (!read_u64_le(v)) throw std::runtime_error("Invalid serialized tensor (shape)");
-        shape.push_back(static_cast<size_t>(v));
+        uint64_t v = read_u64_le(bytes + 16 + i * 8);
+        if (v != 0 && expected > UINT64_MAX / sizeof(double) / v) // room for the widest dtype
+            throw std::runtime_error("Invalid serialized tensor (shape)");
+        expected *= v;
+        shapeOut.push_back(static_cast<size_t>(v));
+    }
+
+    nelems = read_u64_le(bytes + headerSize - 8);
+    if (nelems != expected) throw std::runtime_error("Invalid serialized tensor (nelems)");
+    if (format) *format = parsed;
+    return headerSize;
+}
+
+std::vector<char> Tensor::serializeBinary(WireEncoding encoding) const {
+    if (!packed) return contiguous().serializeBinary(encoding);
+    if (type != DType::FLOAT32) encoding = WireEncoding::FLOAT32;
+    const size_t dataBytes = static_cast<size_t>(encoding == WireEncoding::FLOAT32 ? nbytes()
+                                                                                   : encodedBytes(encoding, numel));
+    std::vector<char> out(binaryHeaderSize() + dataBytes);
+
+    size_t offset = writeBinaryHeader(out.data(), encoding);
+    if (dataBytes > 0) {
+        if (encoding == WireEncoding::FLOAT32) std::memcpy(out.data() + offset, rawData(), dataBytes);
+        else encodeFloats(encoding, dataPtr(), out.data() + offset, numel);
     }
+    return out;
+}
 
+Tensor Tensor::deserializeBinary(const std::vector<char>& bytes) {
+    return deserializeBinary(bytes.data(), bytes.size());
+}
+
+Tensor Tensor::deserializeBinary(const char* bytes, size_t len) {
+    std::vector<size_t> shape;
     uint64_t nelems = 0;
-    if (!read_u64_le(nelems)) throw std::runtime_error("Invalid serialized tensor (nelems)");
+    BinaryFormat format;
+    size_t offset = parseBinaryHeader(bytes, len, shape, nelems, &format);
+    if (offset == 0) throw std::runtime_error("Invalid serialized tensor (header)");
 
-    Tensor t(shape);
-    size_t expected_bytes = static_cast<size_t>(nelems) * sizeof(float);
-    if (!need(expected_bytes)) throw std::runtime_error("Invalid serialized tensor (data)");
+    size_t expected_bytes = static_cast<size_t>(format.dataBytes(nelems));
+    if (len - offset < expected_bytes) throw std::runtime_error("Invalid serialized tensor (data)");
 
+    Tensor t = uninitialized(shape, format.dtype);
     if (nelems > 0) {
-        std::memcpy(t.data.data(), bytes.data() + offset, expected_bytes);
-        offset += expected_bytes;
+        if (format.encoding == WireEncoding::FLOAT32) std::memcpy(t.rawData(), bytes + offset, expected_bytes);
+        else decodeFloats(format.encoding, bytes + offset, t.dataPtr(), static_cast<size_t>(nelems));
+    }
+    return t;
+}
+
+Tensor Tensor::viewBinary(std::shared_ptr<const void> owner, const char* bytes, size_t len) {
+    std::vector<size_t> shape;
+    uint64_t nelems = 0;
+    BinaryFormat format;
+    size_t offset = parseBinaryHeader(bytes, len, shape, nelems, &format);
+    if (offset == 0) throw std::runtime_error("Invalid serialized tensor (header)");
+    if (format.encoding != WireEncoding::FLOAT32) return deserializeBinary(bytes, len);
+
+    size_t expected_bytes = static_cast<size_t>(format.dataBytes(nelems));
+    if (len - offset < expected_bytes) throw std::runtime_error("Invalid serialized tensor (data)");
+
+    // Headers are a multiple of 8 bytes, so data in a page-aligned mapping is
+    // aligned for every dtype; anything else falls back to a copy.
+    const char* payload = bytes + offset;
+    if (reinterpret_cast<uintptr_t>(payload) % dtypeSize(format.dtype) != 0) {
+        return deserializeBinary(bytes, len);
     }
 
+    Tensor t;
+    t.shape = std::move(shape);
+    t.strides = rowMajorStrides(t.shape);
+    t.numel = static_cast<size_t>(nelems);
+    t.type = format.dtype;
+    t.storage = TensorStorage::wrapReadOnly(std::move(owner), payload, expected_bytes);
     return t;
 }
 
@@ -124,10 +658,12 @@ std::string Tensor::serialize() const {
         out << dim << " ";
     }
 
-    // Write data
-    out << data.size() << " ";
-    for (float v : data) {
-        out << v << " ";
+    // Write data (as float32 whatever the dtype)
+    out << numel << " ";
+    const Tensor floats = cast(DType::FLOAT32).contiguous();
+    const float* values = floats.dataPtr();
+    for (size_t i = 0; i < numel; ++i) {
+        out << values[i] << " ";
     }
 
     return out.str();
@@ -149,8 +685,10 @@ Tensor Tensor::deserialize(const std::string& buffer) {
     size_t dataSize;
     in >> dataSize;
 
+    if (dataSize > tensor.size()) throw std::runtime_error("Invalid serialized tensor (text data)");
+    float* values = tensor.dataPtr();
     for (size_t i = 0; i < dataSize; i++) {
-        in >> tensor.data[i];
+        in >> values[i];
     }
 
     return tensor;
@@ -0,0 +1,31 @@
+#include "TensorStorage.h"
+#include "BufferPool.h"
+#include <cstring>
+
+std::shared_ptr<TensorStorage> TensorStorage::allocate(size_t bytes) {
+    std::shared_ptr<TensorStorage> storage = allocateUninitialized(bytes);
+    if (bytes > 0) std::memset(storage->ptr, 0, bytes);
+    return storage;
+}
+
+std::shared_ptr<TensorStorage> TensorStorage::allocateUninitialized(size_t bytes) {
+    std::shared_ptr<TensorStorage> storage(new TensorStorage());
+    storage->ptr = BufferPool::instance().allocate(bytes);
+    storage->size = bytes;
+    storage->ownsMemory = true;
+    return storage;
+}
+
+std::shared_ptr<TensorStorage> TensorStorage::wrapReadOnly(std::shared_ptr<const void> owner,
+                                                           const void* data, size_t bytes) {
+    std::shared_ptr<TensorStorage> storage(new TensorStorage());
+    storage->ptr = const_cast<void*>(data);
+    storage->size = bytes;
+    storage->ownsMemory = false;
+    storage->owner = std::move(owner);
+    return storage;
+}
+
+TensorStorage::~TensorStorage() {
+    if (ownsMemory) BufferPool::instance().release(ptr, size);
+}
@@ -0,0 +1,360 @@
+#include "TensorWire.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL; // report EPIPE instead of raising SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// Write every iovec, advancing through partial writes
+bool sendIov(int sock, struct iovec* iov, int count) {
+    while (count > 0) {
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t sent = ::sendmsg(sock, &msg, SEND_FLAGS);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Non-blocking socket (e.g. one owned by the Reactor): wait
+                // for buffer space instead of failing the send
+                pollfd pfd{sock, POLLOUT, 0};
+                if (::poll(&pfd, 1, -1) < 0 && errno != EINTR) return false;
+                continue;
+            }
+            return false;
+        }
+        size_t left = static_cast<size_t>(sent);
+        while (count > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void encodeLengthPrefix(uint64_t len, char out[8]) {
+    for (int i = 7; i >= 0; --i) {
+        out[i] = static_cast<char>(len & 0xFF);
+        len >>= 8;
+    }
+}
+
+uint64_t decodeLengthPrefix(const char in[8]) {
+    uint64_t len = 0;
+    for (int i = 0; i < 8; ++i) {
+        len = (len << 8) | static_cast<uint8_t>(in[i]);
+    }
+    return len;
+}
+
+WireHeader encodeWireHeader(const Tensor& tensor, WireEncoding encoding) {
+    if (tensor.dtype() != DType::FLOAT32) encoding = WireEncoding::FLOAT32;
+    WireHeader header;
+    size_t tensHeader = tensor.writeBinaryHeader(header.bytes + 8, encoding);
+    header.payloadSize = tensHeader + (encoding == WireEncoding::FLOAT32 ? tensor.nbytes()
+                                                                          : encodedBytes(encoding, tensor.size()));
+    encodeLengthPrefix(header.payloadSize, header.bytes);
+    header.size = 8 + tensHeader;
+    header.encoding = encoding;
+    return header;
+}
+
+bool sendTensor(int sock, const Tensor& tensor, WireEncoding encoding) {
+    return sendTensor(sock, encodeWireHeader(tensor, encoding), tensor);
+}
+
+namespace {
+
+// Whole encoding units that fit in about `bytes` (at least one), in elements
+size_t pieceElems(WireEncoding encoding, size_t bytes) {
+    return std::max<size_t>(1, bytes / encodingUnitBytes(encoding)) * encodingUnitElems(encoding);
+}
+
+// Element range covered by encoded bytes [offset, offset + len) of an
+// n-element tensor; throws unless the range holds whole encoding units
+void chunkElems(WireEncoding encoding, uint64_t n, uint64_t offset, uint64_t len, uint64_t& first, uint64_t& count) {
+    const uint64_t unitBytes = encodingUnitBytes(encoding);
+    const uint64_t unitElems = encodingUnitElems(encoding);
+    if (offset % unitBytes != 0 || len % unitBytes != 0) throw std::runtime_error("Malformed tensor chunk");
+    first = offset / unitBytes * unitElems;
+    count = std::min(n, (offset + len) / unitBytes * unitElems) - first;
+}
+
+} // namespace
+
+bool sendTensor(int sock, const WireHeader& header, const Tensor& tensor) {
+    if (!tensor.isContiguous()) return sendTensor(sock, header, tensor.contiguous());
+    if (header.encoding != WireEncoding::FLOAT32) {
+        // Encode a piece at a time; the frame header rides with the first
+        const size_t n = tensor.size();
+        const size_t step = pieceElems(header.encoding, DEFAULT_STREAM_CHUNK);
+        std::vector<char> buffer(static_cast<size_t>(encodedBytes(header.encoding, std::min(n, step))));
+        size_t first = 0;
+        do {
+            const size_t count = std::min(step, n - first);
+            struct iovec iov[2];
+            int parts = 0;
+            if (first == 0) iov[parts++] = iovec{const_cast<char*>(header.bytes), header.size};
+            if (count > 0) {
+                encodeFloats(header.encoding, tensor.dataPtr() + first, buffer.data(), count);
+                iov[parts++] = iovec{buffer.data(), static_cast<size_t>(encodedBytes(header.encoding, count))};
+            }
+            if (!sendIov(sock, iov, parts)) return false;
+            first += count;
+        } while (first < n);
+        return true;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<char*>(header.bytes);
+    iov[0].iov_len = header.size;
+    iov[1].iov_base = const_cast<void*>(tensor.rawData());
+    iov[1].iov_len = tensor.nbytes();
+    return sendIov(sock, iov, iov[1].iov_len > 0 ? 2 : 1);
+}
+
+bool sendFrame(int sock, const void* payload, size_t len) {
+    char prefix[8];
+    encodeLengthPrefix(len, prefix);
+    struct iovec iov[2];
+    iov[0].iov_base = prefix;
+    iov[0].iov_len = sizeof(prefix);
+    iov[1].iov_base = const_cast<void*>(payload);
+    iov[1].iov_len = len;
+    return sendIov(sock, iov, len > 0 ? 2 : 1);
+}
+
+bool sendAll(int sock, const void* data, size_t len) {
+    struct iovec iov;
+    iov.iov_base = const_cast<void*>(data);
+    iov.iov_len = len;
+    return len == 0 || sendIov(sock, &iov, 1);
+}
+
+bool readFull(int sock, void* data, size_t len) {
+    char* out = static_cast<char*>(data);
+    size_t have = 0;
+    while (have < len) {
+        ssize_t r = ::read(sock, out + have, len - have);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        have += static_cast<size_t>(r);
+    }
+    return true;
+}
+
+void encodeChunkHeader(uint64_t offset, uint32_t len, char out[CHUNK_HEADER_SIZE]) {
+    std::memcpy(out, "CHNK", 4);
+    for (int i = 0; i < 4; ++i) out[4 + i] = static_cast<char>((len >> (8 * i)) & 0xFF);
+    for (int i = 0; i < 8; ++i) out[8 + i] = static_cast<char>((offset >> (8 * i)) & 0xFF);
+}
+
+bool decodeChunkHeader(const char in[CHUNK_HEADER_SIZE], uint64_t& offset, uint32_t& len) {
+    if (std::memcmp(in, "CHNK", 4) != 0) return false;
+    len = 0;
+    offset = 0;
+    for (int i = 3; i >= 0; --i) len = (len << 8) | static_cast<uint8_t>(in[4 + i]);
+    for (int i = 7; i >= 0; --i) offset = (offset << 8) | static_cast<uint8_t>(in[8 + i]);
+    return true;
+}
+
+std::vector<char> encodeChunkHeaders(uint64_t dataBytes, size_t chunkBytes, size_t unitBytes) {
+    if (chunkBytes == 0 || chunkBytes > MAX_CHUNK_BYTES) chunkBytes = DEFAULT_STREAM_CHUNK;
+    if (unitBytes > 1) chunkBytes = std::max(unitBytes, chunkBytes - chunkBytes % unitBytes);
+    std::vector<char> headers;
+    headers.reserve(static_cast<size_t>((dataBytes + chunkBytes - 1) / chunkBytes) * CHUNK_HEADER_SIZE);
+    for (uint64_t offset = 0; offset < dataBytes; offset += chunkBytes) {
+        uint32_t len = static_cast<uint32_t>(std::min<uint64_t>(chunkBytes, dataBytes - offset));
+        headers.resize(headers.size() + CHUNK_HEADER_SIZE);
+        encodeChunkHeader(offset, len, headers.data() + headers.size() - CHUNK_HEADER_SIZE);
+    }
+    return headers;
+}
+
+bool sendTensorStream(int sock, const Tensor& tensor, size_t chunkBytes, WireEncoding encoding) {
+    if (!tensor.isContiguous()) return sendTensorStream(sock, tensor.contiguous(), chunkBytes, encoding);
+    if (tensor.dtype() != DType::FLOAT32) encoding = WireEncoding::FLOAT32;
+    char header[MAX_WIRE_HEADER];
+    size_t tensHeader = tensor.writeBinaryHeader(header + 8, encoding);
+    encodeLengthPrefix(STREAM_FLAG | tensHeader, header);
+    if (!sendAll(sock, header, 8 + tensHeader)) return false;
+
+    const bool raw = encoding == WireEncoding::FLOAT32;
+    const uint64_t dataBytes = raw ? tensor.nbytes() : encodedBytes(encoding, tensor.size());
+    const char* data = static_cast<const char*>(tensor.rawData());
+    std::vector<char> chunks = encodeChunkHeaders(dataBytes, chunkBytes, encodingUnitBytes(encoding));
+    std::vector<char> encoded; // one chunk, reused
+    uint64_t offset = 0;
+    for (size_t c = 0; c < chunks.size(); c += CHUNK_HEADER_SIZE) {
+        uint64_t at;
+        uint32_t len;
+        decodeChunkHeader(chunks.data() + c, at, len);
+        struct iovec iov[2];
+        iov[0].iov_base = chunks.data() + c;
+        iov[0].iov_len = CHUNK_HEADER_SIZE;
+        if (raw) {
+            iov[1].iov_base = const_cast<char*>(data + offset);
+        } else {
+            uint64_t first, count;
+            chunkElems(encoding, tensor.size(), at, len, first, count);
+            if (encoded.size() < len) encoded.resize(len);
+            encodeFloats(encoding, tensor.dataPtr() + first, encoded.data(), static_cast<size_t>(count));
+            iov[1].iov_base = encoded.data();
+        }
+        iov[1].iov_len = len;
+        if (!sendIov(sock, iov, 2)) return false;
+        offset += len;
+    }
+    return true;
+}
+
+namespace {
+
+// Reads and parses a TENS header that occupies at most `avail` bytes of the
+// frame. Returns the header size.
+size_t readTensorHeader(int sock, uint64_t avail, uint64_t maxTensorBytes,
+                        std::vector<size_t>& shape, uint64_t& nelems, BinaryFormat& format) {
+    // Fixed part first (it carries the rank), then the shape entries and
+    // element count
+    char header[MAX_WIRE_HEADER];
+    if (avail < 16 || !readFull(sock, header, 16)) throw std::runtime_error("Failed reading tensor header");
+    size_t headerSize = Tensor::parseBinaryHeader(header, 16, shape, nelems, &format);
+    if (headerSize == 0) {
+        // parseBinaryHeader has already checked the rank against MAX_DIMS
+        size_t dims = static_cast<size_t>(static_cast<uint8_t>(header[8]));
+        size_t want = 16 + dims * 8 + 8;
+        if (avail < want || !readFull(sock, header + 16, want - 16))
+            throw std::runtime_error("Failed reading tensor header");
+        headerSize = Tensor::parseBinaryHeader(header, want, shape, nelems, &format);
+    }
+    // Checked (on the decoded size) before anything is allocated for the data
+    if (nelems > maxTensorBytes / dtypeSize(format.dtype)) throw std::runtime_error("Tensor exceeds size limit");
+    return headerSize;
+}
+
+// Walks the chunk headers of a stream carrying dataBytes of data. land()
+// must consume exactly `len` bytes from the socket.
+void readChunks(int sock, uint64_t dataBytes, const std::function<void(uint64_t, uint32_t)>& land) {
+    uint64_t received = 0;
+    while (received < dataBytes) {
+        char chunk[CHUNK_HEADER_SIZE];
+        uint64_t offset;
+        uint32_t len;
+        if (!readFull(sock, chunk, sizeof(chunk))) throw std::runtime_error("Failed reading chunk header");
+        if (!decodeChunkHeader(chunk, offset, len) || offset != received || len == 0 ||
+            len > MAX_CHUNK_BYTES || len > dataBytes - received) {
+            throw std::runtime_error("Malformed tensor chunk");
+        }
+        land(offset, len);
+        received += len;
+    }
+}
+
+} // namespace
+
+Tensor recvTensor(int sock, uint64_t maxTensorBytes, const ChunkSink& onChunk) {
+    char prefix[8];
+    if (!readFull(sock, prefix, sizeof(prefix))) throw std::runtime_error("Failed reading length prefix");
+    uint64_t len = decodeLengthPrefix(prefix);
+    const bool streamed = (len & STREAM_FLAG) != 0;
+    len &= ~STREAM_FLAG;
+
+    std::vector<size_t> shape;
+    uint64_t nelems = 0;
+    BinaryFormat format;
+    size_t headerSize = readTensorHeader(sock, len, maxTensorBytes, shape, nelems, format);
+    const WireEncoding encoding = format.encoding;
+    const uint64_t dataBytes = format.dataBytes(nelems);
+    const bool raw = encoding == WireEncoding::FLOAT32;
+    std::vector<char> encoded; // staging for encoded data, one piece at a time
+
+    if (!streamed) {
+        if (len != headerSize + dataBytes) throw std::runtime_error("Tensor frame length mismatch");
+        Tensor tensor = Tensor::uninitialized(shape, format.dtype);
+        if (raw) {
+            if (dataBytes > 0 && !readFull(sock, tensor.rawData(), static_cast<size_t>(dataBytes)))
+                throw std::runtime_error("Failed reading tensor payload");
+        } else {
+            const size_t step = pieceElems(encoding, DEFAULT_STREAM_CHUNK);
+            for (size_t first = 0; first < nelems; first += step) {
+                const size_t count = std::min<size_t>(step, static_cast<size_t>(nelems) - first);
+                const size_t bytes = static_cast<size_t>(encodedBytes(encoding, count));
+                if (encoded.size() < bytes) encoded.resize(bytes);
+                if (!readFull(sock, encoded.data(), bytes)) throw std::runtime_error("Failed reading tensor payload");
+                decodeFloats(encoding, encoded.data(), tensor.dataPtr() + first, count);
+            }
+        }
+        if (onChunk && nelems > 0) onChunk(tensor, 0, tensor.nbytes());
+        return tensor;
+    }
+
+    if (len != headerSize) throw std::runtime_error("Tensor stream header mismatch");
+    Tensor tensor = Tensor::uninitialized(shape, format.dtype);
+    char* data = static_cast<char*>(tensor.rawData());
+    readChunks(sock, dataBytes, [&](uint64_t offset, uint32_t chunkLen) {
+        if (raw) {
+            if (!readFull(sock, data + offset, chunkLen)) throw std::runtime_error("Failed reading tensor chunk");
+            if (onChunk) onChunk(tensor, offset, chunkLen);
+            return;
+        }
+        uint64_t first, count;
+        chunkElems(encoding, nelems, offset, chunkLen, first, count);
+        if (encoded.size() < chunkLen) encoded.resize(chunkLen);
+        if (!readFull(sock, encoded.data(), chunkLen)) throw std::runtime_error("Failed reading tensor chunk");
+        decodeFloats(encoding, encoded.data(), tensor.dataPtr() + first, static_cast<size_t>(count));
+        if (onChunk) onChunk(tensor, first * sizeof(float), static_cast<size_t>(count) * sizeof(float));
+    });
+    return tensor;
+}
+
+void recvTensorStream(int sock, const StreamSink& sink, uint64_t maxTensorBytes) {
+    char prefix[8];
+    if (!readFull(sock, prefix, sizeof(prefix))) throw std::runtime_error("Failed reading length prefix");
+    uint64_t len = decodeLengthPrefix(prefix);
+    if (!(len & STREAM_FLAG)) throw std::runtime_error("Expected a streamed tensor frame");
+    len &= ~STREAM_FLAG;
+
+    std::vector<size_t> shape;
+    uint64_t nelems = 0;
+    BinaryFormat format;
+    if (readTensorHeader(sock, len, maxTensorBytes, shape, nelems, format) != len)
+        throw std::runtime_error("Tensor stream header mismatch");
+    if (sink.onHeader) sink.onHeader(shape, format.dtype);
+    const WireEncoding encoding = format.encoding;
+
+    std::vector<char> buffer;
+    std::vector<float> decoded;
+    readChunks(sock, format.dataBytes(nelems), [&](uint64_t offset, uint32_t chunkLen) {
+        uint64_t first = 0, count = 0;
+        if (encoding != WireEncoding::FLOAT32) chunkElems(encoding, nelems, offset, chunkLen, first, count);
+        if (buffer.size() < chunkLen) buffer.resize(chunkLen);
+        if (!readFull(sock, buffer.data(), chunkLen)) throw std::runtime_error("Failed reading tensor chunk");
+        if (!sink.onChunk) return;
+        if (encoding == WireEncoding::FLOAT32) {
+            sink.onChunk(offset, buffer.data(), chunkLen);
+            return;
+        }
+        if (decoded.size() < count) decoded.resize(static_cast<size_t>(count));
+        decodeFloats(encoding, buffer.data(), decoded.data(), static_cast<size_t>(count));
+        sink.onChunk(first * sizeof(float), reinterpret_cast<const char*>(decoded.data()),
+                     static_cast<size_t>(count) * sizeof(float));
+    });
+}
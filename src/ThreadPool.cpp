@@ -1,8 +1,22 @@
 #include "ThreadPool.h"
+#include <algorithm>
+#include <exception>
 
-ThreadPool::ThreadPool(size_t numThreads) : stop(false) {
+namespace {
+// Identifies the pool (and deque) owned by the current worker thread so that
+// nested submissions can go to the local deque in WORK_STEALING mode.
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+}
+
+ThreadPool::ThreadPool(size_t numThreads, PoolMode mode) : stop(false), poolMode(mode) {
+    if (poolMode == PoolMode::WORK_STEALING) {
+        for (size_t i = 0; i < numThreads; ++i) {
+            localQueues.emplace_back(new WorkerQueue());
+        }
+    }
     for (size_t i = 0; i < numThreads; ++i) {
-        workers.emplace_back([this] { this->workerThread(); });
+        workers.emplace_back([this, i] { this->workerThread(i); });
     }
 }
 
@@ -17,15 +31,172 @@ ThreadPool::~ThreadPool() {
     }
 }
 
+bool ThreadPool::isWorkerThread() const {
+    return currentPool == this;
+}
+
 void ThreadPool::enqueue(std::function<void()> task) {
+    if (poolMode == PoolMode::WORK_STEALING && currentPool == this) {
+        WorkerQueue& local = *localQueues[currentIndex];
+        {
+            std::lock_guard<std::mutex> lock(local.mutex);
+            local.tasks.push_back(std::move(task));
+        }
+        pending.fetch_add(1);
+        wakeOne();
+        return;
+    }
+
     {
         std::unique_lock<std::mutex> lock(queueMutex);
         tasks.push(std::move(task));
+        injected.fetch_add(1, std::memory_order_relaxed);
+        pending.fetch_add(1);
+    }
+    condition.notify_one();
+}
+
+size_t ThreadPool::chunkSize(size_t n, size_t grain) {
+    return std::max({grain, size_t(1), (n + MAX_CHUNKS - 1) / MAX_CHUNKS});
+}
+
+void ThreadPool::parallel_for(size_t first, size_t last, size_t grain,
+                              const std::function<void(size_t, size_t)>& body) {
+    if (last <= first) return;
+    const size_t chunk = chunkSize(last - first, grain);
+    runChunks((last - first + chunk - 1) / chunk, [&](size_t c) {
+        const size_t begin = first + c * chunk;
+        body(begin, last - begin < chunk ? last : begin + chunk);
+    });
+}
+
+void ThreadPool::runChunks(size_t count, const std::function<void(size_t)>& fn) {
+    if (workers.empty() || count <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
     }
+
+    struct State {
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+
+    // Work is claimed from a shared counter, so the caller finishes
+    // everything itself if the workers are busy. Late helpers see
+    // next >= count and return without touching fn.
+    auto work = [state, count, &fn]() {
+        while (true) {
+            const size_t i = state->next.fetch_add(1);
+            if (i >= count) return;
+            std::exception_ptr error;
+            try {
+                fn(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error) state->error = error;
+            if (++state->done == count) state->finished.notify_all();
+        }
+    };
+
+    const size_t helpers = std::min(workers.size(), count - 1);
+    for (size_t h = 0; h < helpers; ++h) enqueue(work);
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == count; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+void ThreadPool::wakeOne() {
+    if (idleWorkers.load() == 0) return;
+    // Taking the mutex orders this notify after a worker's predicate check,
+    // so a worker that just decided to sleep cannot miss it.
+    { std::lock_guard<std::mutex> lock(queueMutex); }
     condition.notify_one();
 }
 
-void ThreadPool::workerThread() {
+bool ThreadPool::popTask(size_t index, std::function<void()>& task) {
+    // 1. Own deque, newest first (cache-warm, depth-first)
+    {
+        WorkerQueue& local = *localQueues[index];
+        std::lock_guard<std::mutex> lock(local.mutex);
+        if (!local.tasks.empty()) {
+            task = std::move(local.tasks.back());
+            local.tasks.pop_back();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // 2. Shared injection queue for tasks submitted from outside the pool,
+    // locked only when it holds something. A push this read misses keeps
+    // pending above zero, so the worker comes back for it.
+    if (injected.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!tasks.empty()) {
+            task = std::move(tasks.front());
+            tasks.pop();
+            injected.fetch_sub(1, std::memory_order_relaxed);
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // 3. Steal the oldest task from another worker. Busy deques are skipped
+    // at first; if any were, a second pass waits for their locks, since
+    // the caller would otherwise see pending > 0 and spin straight back.
+    const size_t n = localQueues.size();
+    bool contended = false;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t k = 1; k < n; ++k) {
+            WorkerQueue& victim = *localQueues[(index + k) % n];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::defer_lock);
+            if (pass == 1) {
+                lock.lock();
+            } else if (!lock.try_lock()) {
+                contended = true;
+                continue;
+            }
+            if (victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending.fetch_sub(1);
+            return true;
+        }
+        if (!contended) break;
+    }
+    return false;
+}
+
+void ThreadPool::workerThread(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+
+    if (poolMode == PoolMode::WORK_STEALING) {
+        while (true) {
+            std::function<void()> task;
+            if (popTask(index, task)) {
+                try {
+                    task();
+                } catch (...) {
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(queueMutex);
+            idleWorkers.fetch_add(1);
+            condition.wait(lock, [this] { return stop || pending.load() > 0; });
+            idleWorkers.fetch_sub(1);
+            if (stop && pending.load() == 0) return;
+        }
+    }
+
     while (true) {
         std::function<void()> task;
         {
@@ -34,6 +205,8 @@ void ThreadPool::workerThread() {
             if (stop && tasks.empty()) return;
             task = std::move(tasks.front());
             tasks.pop();
+            injected.fetch_sub(1, std::memory_order_relaxed);
+            pending.fetch_sub(1);
         }
         try {
             task();
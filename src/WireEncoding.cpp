@@ -0,0 +1,60 @@
+#include "WireEncoding.h"
+#include "Kernels.h"
+#include <cstring>
+#include <stdexcept>
+
+const char* wireEncodingName(WireEncoding encoding) {
+    switch (encoding) {
+    case WireEncoding::FLOAT16: return "float16";
+    case WireEncoding::BFLOAT16: return "bfloat16";
+    case WireEncoding::QINT8: return "qint8";
+    default: return "float32";
+    }
+}
+
+WireEncoding parseWireEncoding(const std::string& name) {
+    if (name == "float32") return WireEncoding::FLOAT32;
+    if (name == "float16") return WireEncoding::FLOAT16;
+    if (name == "bfloat16") return WireEncoding::BFLOAT16;
+    if (name == "qint8") return WireEncoding::QINT8;
+    throw std::runtime_error("Unknown wire encoding: " + name);
+}
+
+bool isWireEncoding(uint8_t dtype) {
+    return dtype >= static_cast<uint8_t>(WireEncoding::FLOAT32) && dtype <= static_cast<uint8_t>(WireEncoding::QINT8);
+}
+
+uint64_t encodedBytes(WireEncoding encoding, uint64_t n) {
+    switch (encoding) {
+    case WireEncoding::FLOAT16:
+    case WireEncoding::BFLOAT16: return n * 2;
+    case WireEncoding::QINT8: return (n + kernels::Q8_BLOCK - 1) / kernels::Q8_BLOCK * kernels::Q8_BLOCK_BYTES;
+    default: return n * sizeof(float);
+    }
+}
+
+size_t encodingUnitElems(WireEncoding encoding) {
+    return encoding == WireEncoding::QINT8 ? kernels::Q8_BLOCK : 1;
+}
+
+size_t encodingUnitBytes(WireEncoding encoding) {
+    return static_cast<size_t>(encodedBytes(encoding, encodingUnitElems(encoding)));
+}
+
+void encodeFloats(WireEncoding encoding, const float* in, char* out, size_t n) {
+    switch (encoding) {
+    case WireEncoding::FLOAT16: kernels::floatToHalf(in, reinterpret_cast<uint16_t*>(out), n); break;
+    case WireEncoding::BFLOAT16: kernels::floatToBfloat16(in, reinterpret_cast<uint16_t*>(out), n); break;
+    case WireEncoding::QINT8: kernels::quantizeQ8(in, out, n); break;
+    default: if (n > 0) std::memcpy(out, in, n * sizeof(float)); break;
+    }
+}
+
+void decodeFloats(WireEncoding encoding, const char* in, float* out, size_t n) {
+    switch (encoding) {
+    case WireEncoding::FLOAT16: kernels::halfToFloat(reinterpret_cast<const uint16_t*>(in), out, n); break;
+    case WireEncoding::BFLOAT16: kernels::bfloat16ToFloat(reinterpret_cast<const uint16_t*>(in), out, n); break;
+    case WireEncoding::QINT8: kernels::dequantizeQ8(in, out, n); break;
+    default: if (n > 0) std::memcpy(out, in, n * sizeof(float)); break;
+    }
+}
@@ -3,6 +3,7 @@
 #include "Graph.h"
 #include "GraphNode.h"
 #include "ThreadPool.h"
+#include "TensorWire.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -16,8 +17,9 @@
 int main() {
     Tensor orig({2, 3});  // 2x3 tensor
 
+    float* origData = orig.dataPtr();
     for (size_t i = 0; i < orig.size(); i++) {
-        orig[i] = static_cast<float>(i);
+        origData[i] = static_cast<float>(i);
     }
 
     std::cout << "Tensor size: " << orig.size() << std::endl;
@@ -48,7 +50,7 @@ int main() {
     std::cout << std::endl;
 
     // Set up nodeA as the sender. Nodes B and C will be receivers (clients).
-    Node nodeA(5001, 4, 1);
+    Node nodeA(5001, 4, 1, "checkpoints/store.snap");
     nodeA.startServer();
 
     std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -74,35 +76,14 @@ int main() {
 
         // Create and send a tensor TO the server
         Tensor clientTensor({2, 3});
+        float* clientData = clientTensor.dataPtr();
         for (size_t i = 0; i < clientTensor.size(); i++) {
-            clientTensor[i] = static_cast<float>(i);
+            clientData[i] = static_cast<float>(i);
         }
 
-        std::vector<char> data = clientTensor.serializeBinary();
-        uint64_t len = data.size();
-
-        // Send length prefix (big-endian)
-        uint8_t lenbuf[8];
-        for (int i = 7; i >= 0; --i) {
-            lenbuf[i] = static_cast<uint8_t>(len & 0xFF);
-            len >>= 8;
-        }
-
-        size_t sent = 0;
-        while (sent < 8) {
-            ssize_t s = ::send(sock, lenbuf + sent, 8 - sent, 0);
-            if (s <= 0) break;
-            sent += static_cast<size_t>(s);
-        }
-
-        // Send payload
-        sent = 0;
-        const char* bytes = data.data();
-        size_t tosend = data.size();
-        while (sent < tosend) {
-            ssize_t s = ::send(sock, bytes + sent, tosend - sent, 0);
-            if (s <= 0) break;
-            sent += static_cast<size_t>(s);
+        // Length prefix + header from a stack buffer, data straight from the tensor
+        if (!sendTensor(sock, clientTensor)) {
+            std::cerr << "client send failed\n";
         }
 
         std::cout << "Client " << idx << " sent tensor to server" << std::endl;
@@ -114,8 +95,6 @@ int main() {
     std::thread r2(receiver, 2);
 
     // Wait for clients to send tensors
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-
     r1.join();
     r2.join();
 
@@ -127,22 +106,22 @@ int main() {
     std::cout << "\n=== Execution Graph Demo ===" << std::endl;
 
     // Create a thread pool for graph execution
-    ThreadPool pool(4);
+    ThreadPool pool(4, PoolMode::WORK_STEALING);
 
     auto nodeA_graph = std::make_shared<GraphNode>();
     nodeA_graph->name = "Input";
     nodeA_graph->tensor = Tensor({2,3});
-    for (size_t i=0; i<nodeA_graph->tensor.size(); i++) nodeA_graph->tensor[i] = i;
+    float* inputData = nodeA_graph->tensor.dataPtr();
+    for (size_t i=0; i<nodeA_graph->tensor.size(); i++) inputData[i] = i;
 
     auto nodeB_graph = std::make_shared<GraphNode>();
     nodeB_graph->name = "Double";
     nodeB_graph->inputs.push_back(nodeA_graph);
     nodeB_graph->tensor = Tensor({2,3});
-    nodeB_graph->operation = [nodeB_graph]() {
+    // Large inputs are split across the pool (the node's own worker joins in)
+    nodeB_graph->operation = [nodeB_graph, &pool]() {
         for (auto& input : nodeB_graph->inputs) {
-            for (size_t i=0; i<input->tensor.size(); i++) {
-                nodeB_graph->tensor[i] = input->tensor[i] * 2;
-            }
+            nodeB_graph->tensor = input->tensor.scale(2.0f, &pool);
         }
     };
 
@@ -150,14 +129,10 @@ int main() {
     graph.nodes.push_back(nodeA_graph);
     graph.nodes.push_back(nodeB_graph);
 
+    // Runs "Double" only after "Input" is ready and blocks until done
     graph.execute(&pool);
 
-    // Wait for graph tasks to complete
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-    float sum = 0;
-    for (size_t i=0; i<nodeB_graph->tensor.size(); i++) sum += nodeB_graph->tensor[i];
-    std::cout << "Graph output sum: " << sum << std::endl;
+    std::cout << "Graph output sum: " << nodeB_graph->tensor.sum(&pool) << std::endl;
 
     std::cout << "Press Enter to exit...\n";
     std::cin.get();
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BufferPool.h"
+#include "Tensor.h"
+#include "TestUtil.h"
+
+namespace {
+
+bool aligned(const void* p) {
+    return reinterpret_cast<uintptr_t>(p) % BufferPool::ALIGNMENT == 0;
+}
+
+} // namespace
+
+int main() {
+    BufferPool& pool = BufferPool::instance();
+
+    // Size classes cover the request with bounded waste
+    const size_t sizes[] = {1, 63, 64, 65, 1000, 1024, 1025, 4096, 5000, 1 << 20, (1 << 20) + 1, 123456789};
+    for (size_t n : sizes) {
+        size_t c = BufferPool::classBytes(n);
+        expect(c >= n && c % BufferPool::ALIGNMENT == 0, "class covers the request, 64-byte multiple");
+        expect(c <= n + n / 4 + BufferPool::ALIGNMENT, "class wastes at most a quarter");
+        void* p = pool.allocate(n);
+        expect(aligned(p), "buffer is 64-byte aligned");
+        pool.release(p, n);
+    }
+
+    // A released buffer serves the next request of its class
+    BufferPoolStats before = pool.stats();
+    void* first = pool.allocate(3000);
+    pool.release(first, 3000);
+    void* again = pool.allocate(2900); // same class as 3000
+    BufferPoolStats after = pool.stats();
+    expect(again == first, "same-class request reuses the buffer");
+    expect(after.hits >= before.hits + 1, "reuse counted as a hit");
+    expect(after.bytesInUse == before.bytesInUse + BufferPool::classBytes(3000), "bytes in use tracked");
+    pool.release(again, 2900);
+
+    // Tensors recycle their storage; repeated temporaries stop missing
+    {
+        Tensor warm({256, 256});
+    }
+    before = pool.stats();
+    for (int i = 0; i < 100; ++i) {
+        Tensor t({256, 256});
+        expect(t.sum() == 0.0f, "constructed tensors are zero-filled");
+        t[0] = 1.0f; // dirty the buffer for the next iteration
+    }
+    after = pool.stats();
+    expect(after.misses == before.misses, "recycled tensors do not allocate");
+    expect(after.hits >= before.hits + 100, "every recycled tensor is a hit");
+    Tensor raw = Tensor::uninitialized({1000}, DType::FLOAT64);
+    expect(raw.size() == 1000 && raw.nbytes() == 8000 && aligned(raw.rawData()), "uninitialized tensor allocated");
+
+    // Large buffers freed on another thread are reused here
+    void* big = pool.allocate(8 << 20);
+    std::thread([&] { pool.release(big, 8 << 20); }).join();
+    void* reused = pool.allocate(8 << 20);
+    expect(reused == big, "large buffers are shared across threads");
+    pool.release(reused, 8 << 20);
+
+    // trim() returns idle memory; a zero cap disables pooling
+    pool.trim();
+    expect(pool.stats().bytesHeld == 0, "trim frees idle buffers");
+
+    // ... including what other threads hold in their caches, once they next
+    // touch the pool
+    {
+        std::mutex m;
+        std::condition_variable cv;
+        int step = 0;
+        void* cached = nullptr;
+        void* afterTrim = nullptr;
+        std::thread worker([&] {
+            cached = pool.allocate(2048);
+            pool.release(cached, 2048);
+            std::unique_lock<std::mutex> lock(m);
+            step = 1;
+            cv.notify_all();
+            cv.wait(lock, [&] { return step == 2; });
+            afterTrim = pool.allocate(2048);
+            pool.release(afterTrim, 2048);
+        });
+        {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&] { return step == 1; });
+        }
+        expect(pool.stats().bytesHeld == BufferPool::classBytes(2048), "worker caches its buffer");
+        pool.trim();
+        const uint64_t misses = pool.stats().misses;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            step = 2;
+        }
+        cv.notify_all();
+        worker.join();
+        expect(pool.stats().misses == misses + 1, "worker's stale cache is not reused after trim");
+        pool.trim();
+        expect(pool.stats().bytesHeld == 0, "trim reaches an exited worker's buffers");
+    }
+    pool.setMaxHeldBytes(0);
+    void* p = pool.allocate(4096);
+    pool.release(p, 4096);
+    expect(pool.stats().bytesHeld == 0, "zero cap keeps nothing");
+    pool.setMaxHeldBytes(size_t(512) << 20);
+
+    if (failures) return 1;
+    std::cout << "BufferPool tests passed\n";
+    return 0;
+}
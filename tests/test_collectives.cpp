@@ -0,0 +1,116 @@
+#include <iostream>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "Communicator.h"
+#include "TestUtil.h"
+
+namespace {
+
+// Runs body(comm) on worldSize threads, one connected Communicator each
+void runGroup(int worldSize, int basePort, const CommOptions& options,
+              const std::function<void(Communicator&)>& body) {
+    std::vector<std::thread> ranks;
+    for (int r = 0; r < worldSize; ++r) {
+        ranks.emplace_back([=] {
+            try {
+                Communicator comm(r, worldSize, basePort, options);
+                comm.connect();
+                body(comm);
+            } catch (const std::exception& e) {
+                expect(false, std::string("rank threw: ") + e.what());
+            }
+        });
+    }
+    for (auto& t : ranks) t.join();
+}
+
+// Distinct per rank and element so misplaced segments show up
+float valueAt(int rank, size_t i) {
+    return static_cast<float>((rank + 1) * 1000 + i % 997);
+}
+
+} // namespace
+
+int main() {
+    // Spread test runs over ports so back-to-back runs don't collide; stay
+    // below the ephemeral range (32768+) used by outgoing connections
+    int basePort = 20000 + (getpid() % 1000) * 10;
+    CommOptions options;
+    options.chunkBytes = 4096; // many chunks per segment, even for small tensors
+
+    const size_t sizes[] = {1, 3, 1000, 100003};
+    for (int world = 1; world <= 5; ++world) {
+        for (size_t n : sizes) {
+            basePort += world;
+            runGroup(world, basePort, options, [&](Communicator& comm) {
+                const std::string tag = " (world " + std::to_string(world) + ", n " + std::to_string(n) + ")";
+                Tensor t({n});
+                for (size_t i = 0; i < n; ++i) t[i] = valueAt(comm.rank(), i);
+
+                // allReduce: every rank ends up with the elementwise sum
+                Tensor reduced = t;
+                comm.allReduce(reduced);
+                bool ok = true;
+                for (size_t i = 0; i < n; ++i) {
+                    float want = 0.0f;
+                    for (int r = 0; r < world; ++r) want += valueAt(r, i);
+                    if (reduced[i] != want) ok = false;
+                }
+                expect(ok, "allReduce" + tag);
+
+                // reduceScatter: our segment of the sum
+                Tensor mine = comm.reduceScatter(t);
+                auto range = comm.segment(n, comm.rank());
+                ok = mine.size() == range.second - range.first;
+                for (size_t i = 0; ok && i < mine.size(); ++i) ok = mine[i] == reduced[range.first + i];
+                expect(ok, "reduceScatter" + tag);
+
+                // allGather: every rank's tensor, stacked by rank
+                Tensor gathered = comm.allGather(t);
+                ok = gathered.getShape().size() == 2 && gathered.getShape()[0] == size_t(world) &&
+                     gathered.getShape()[1] == n;
+                for (int r = 0; ok && r < world; ++r)
+                    for (size_t i = 0; ok && i < n; ++i) ok = gathered[r * n + i] == valueAt(r, i);
+                expect(ok, "allGather" + tag);
+
+                // Tree broadcast and reduce from a non-zero root
+                const int root = world - 1;
+                Tensor b = comm.rank() == root ? t : Tensor({n});
+                comm.broadcast(b, root);
+                ok = true;
+                for (size_t i = 0; ok && i < n; ++i) ok = b[i] == valueAt(root, i);
+                expect(ok, "broadcast" + tag);
+
+                Tensor partial = t;
+                comm.reduce(partial, root);
+                if (comm.rank() == root) {
+                    ok = true;
+                    for (size_t i = 0; ok && i < n; ++i) ok = partial[i] == reduced[i];
+                    expect(ok, "reduce" + tag);
+                }
+            });
+        }
+    }
+
+    // A rank that never shows up makes connect() time out instead of hanging
+    basePort += 10;
+    CommOptions quick;
+    quick.connectTimeout = std::chrono::milliseconds(200);
+    Communicator lonely(1, 2, basePort, quick);
+    bool threw = false;
+    try {
+        lonely.connect();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    expect(threw, "connect times out without peers");
+
+    if (failures) return 1;
+    std::cout << "Collective tests passed\n";
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "KVStore.h"
+#include "Tensor.h"
+#include "TensorWire.h"
+#include "TestUtil.h"
+
+namespace {
+
+bool sameData(const Tensor& a, const Tensor& b) {
+    return a.dtype() == b.dtype() && a.getShape() == b.getShape() &&
+           (a.nbytes() == 0 || std::memcmp(a.rawData(), b.rawData(), a.nbytes()) == 0);
+}
+
+} // namespace
+
+int main() {
+    const DType all[] = {DType::FLOAT32, DType::FLOAT16, DType::BFLOAT16, DType::INT8, DType::INT32, DType::FLOAT64};
+
+    // Small integers survive every dtype and every pair of casts
+    Tensor ints({4, 300});
+    for (size_t i = 0; i < ints.size(); ++i) ints[i] = static_cast<float>(static_cast<int>(i % 201) - 100);
+    for (DType from : all) {
+        Tensor a = ints.cast(from);
+        expect(a.dtype() == from && a.nbytes() == ints.size() * dtypeSize(from), "cast sets dtype and size");
+        for (DType to : all) {
+            expect(sameData(a.cast(to).cast(DType::FLOAT32), ints), "integers round-trip between dtypes");
+        }
+    }
+
+    // Rounding and saturation into integers; NaN becomes 0
+    Tensor edge({6});
+    const float edgeValues[] = {2.5f, -3.5f, 1000.0f, -1000.0f, 3e9f, std::numeric_limits<float>::quiet_NaN()};
+    for (size_t i = 0; i < 6; ++i) edge[i] = edgeValues[i];
+    Tensor asInt8 = edge.cast(DType::INT8);
+    const int8_t* i8 = static_cast<const int8_t*>(asInt8.rawData());
+    expect(i8[0] == 2 && i8[1] == -4 && i8[2] == 127 && i8[3] == -128 && i8[5] == 0, "int8 rounds and saturates");
+    Tensor asInt32 = edge.cast(DType::INT32);
+    const int32_t* i32 = static_cast<const int32_t*>(asInt32.rawData());
+    expect(i32[2] == 1000 && i32[4] == std::numeric_limits<int32_t>::max(), "int32 saturates");
+
+    // float64 <-> int32 does not pass through float32
+    Tensor big({1}, DType::INT32);
+    static_cast<int32_t*>(big.rawData())[0] = 16777217; // not representable in float32
+    Tensor wide = big.cast(DType::FLOAT64);
+    expect(static_cast<const double*>(wide.rawData())[0] == 16777217.0, "int32 to float64 is exact");
+    expect(static_cast<const int32_t*>(wide.cast(DType::INT32).rawData())[0] == 16777217, "float64 to int32 is exact");
+
+    // Float accessors are float32 only
+    bool threw = false;
+    try {
+        Tensor({3}, DType::INT8)[0] = 1.0f;
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    expect(threw, "float access to an int8 tensor throws");
+
+    // Math on other dtypes matches float32 math rounded to the result dtype
+    Tensor x({3000});
+    Tensor y({3000});
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = static_cast<float>(std::sin(i * 0.01));
+        y[i] = static_cast<float>(std::cos(i * 0.02));
+    }
+    for (DType t : {DType::FLOAT16, DType::BFLOAT16, DType::FLOAT64}) {
+        Tensor xs = x.cast(t);
+        Tensor ys = y.cast(t);
+        Tensor want = xs.cast(DType::FLOAT32).add(ys.cast(DType::FLOAT32)).cast(t);
+        expect(sameData(xs.add(ys), want), "add on narrow dtypes");
+        expect(sameData(xs.add(y), xs.cast(DType::FLOAT32).add(y).cast(t)), "mixed-dtype add takes the left dtype");
+        expect(xs.relu().dtype() == t, "unary ops keep the dtype");
+        expect(std::fabs(xs.dot(ys) - x.dot(y)) < 0.05f * (1.0f + std::fabs(x.dot(y))), "dot on narrow dtypes");
+        expect(std::fabs(xs.sum() - xs.cast(DType::FLOAT32).sum()) < 1e-2f, "sum on narrow dtypes");
+        expect(xs.max() == xs.cast(DType::FLOAT32).max(), "max on narrow dtypes");
+    }
+    Tensor m({2, 2}, DType::INT8);
+    for (size_t i = 0; i < 4; ++i) static_cast<int8_t*>(m.rawData())[i] = static_cast<int8_t>(i + 1);
+    Tensor prod = m.matmul(m);
+    expect(prod.dtype() == DType::FLOAT32 && prod[0] == 7.0f && prod[3] == 22.0f, "matmul casts to float32");
+
+    // Binary form keeps the dtype; views point at the buffer in place
+    for (DType t : all) {
+        Tensor a = ints.cast(t);
+        std::vector<char> bytes = a.serializeBinary();
+        expect(bytes.size() == a.binaryHeaderSize() + a.nbytes(), "serialized size follows dtype");
+        expect(sameData(Tensor::deserializeBinary(bytes), a), "binary round-trip keeps dtype");
+        auto owner = std::make_shared<std::vector<char>>(bytes);
+        Tensor view = Tensor::viewBinary(owner, owner->data(), owner->size());
+        expect(view.isReadOnlyView() && sameData(view, a), "binary view keeps dtype");
+        // Wire encodings only apply to float32; other dtypes go out as is
+        expect(a.serializeBinary(WireEncoding::QINT8).size() ==
+                   (t == DType::FLOAT32 ? Tensor(ints).serializeBinary(WireEncoding::QINT8).size() : bytes.size()),
+               "encodings ignored for non-float32");
+    }
+
+    // Checkpoints store the dtype as is
+    {
+        KVStore store;
+        Tensor table = ints.cast(DType::BFLOAT16);
+        store.put("dtype_table", table);
+        expect(store.saveToDisk("dtype_table"), "save bfloat16 checkpoint");
+        for (LoadMode mode : {LoadMode::READ, LoadMode::MMAP}) {
+            KVStore loaded;
+            Tensor got;
+            expect(loaded.loadFromDisk("dtype_table", mode) && loaded.get("dtype_table", got) && sameData(got, table),
+                   "bfloat16 checkpoint round-trips");
+        }
+        std::remove("checkpoints/dtype_table.chk");
+    }
+
+    // Over the wire, plain and streamed
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return 1;
+    Tensor indices = ints.cast(DType::INT32);
+    Tensor halves = x.cast(DType::FLOAT16);
+    std::thread sender([&] {
+        sendTensor(fds[0], indices, WireEncoding::BFLOAT16); // encoding ignored
+        sendTensorStream(fds[0], indices, 1000);
+        sendTensorStream(fds[0], halves, 1000);
+    });
+    expect(sameData(recvTensor(fds[1]), indices), "int32 tensor over the wire");
+    expect(sameData(recvTensor(fds[1]), indices), "int32 tensor streamed");
+    expect(sameData(recvTensor(fds[1]), halves), "float16 tensor streamed");
+    sender.join();
+    close(fds[0]);
+    close(fds[1]);
+
+    if (failures) return 1;
+    std::cout << "DType tests passed\n";
+    return 0;
+}
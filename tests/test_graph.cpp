@@ -0,0 +1,342 @@
+#include <iostream>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include "Graph.h"
+#include "GraphNode.h"
+#include "ThreadPool.h"
+
+namespace {
+
+std::shared_ptr<GraphNode> makeNode(const std::string& name,
+                                    std::vector<std::shared_ptr<GraphNode>> inputs, size_t size = 4) {
+    auto node = std::make_shared<GraphNode>();
+    node->name = name;
+    node->tensor = Tensor({size});
+    node->inputs = std::move(inputs);
+    return node;
+}
+
+// Node computing inputs[0] * 2 + 1 into its own tensor
+std::shared_ptr<GraphNode> affineNode(const std::string& name, std::shared_ptr<GraphNode> input) {
+    auto node = makeNode(name, {input}, input->tensor.size());
+    GraphNode* self = node.get();
+    node->operation = [self] {
+        const Tensor& in = self->inputs[0]->tensor;
+        for (size_t i = 0; i < in.size(); ++i) self->tensor[i] = in[i] * 2 + 1;
+    };
+    return node;
+}
+
+bool planTests(ThreadPool& pool) {
+    const size_t n = 1024;
+    const size_t bytes = n * sizeof(float);
+
+    // A chain keeps two buffers alive at a time however long it is
+    auto input = makeNode("In", {}, n);
+    for (size_t i = 0; i < n; ++i) input->tensor[i] = static_cast<float>(i);
+    std::vector<std::shared_ptr<GraphNode>> chain = {input};
+    for (int i = 0; i < 6; ++i) chain.push_back(affineNode("C" + std::to_string(i), chain.back()));
+    Graph graph;
+    graph.nodes.assign(chain.rbegin(), chain.rend());
+    MemoryPlan plan = graph.planMemory();
+    if (plan.naiveBytes != 5 * bytes || plan.plannedBytes != 2 * bytes) {
+        std::cerr << "Chain plan: " << plan.report() << "\n";
+        return false;
+    }
+    for (int round = 0; round < 3; ++round) {
+        graph.execute(&pool, &plan);
+        const Tensor& out = chain.back()->tensor;
+        for (size_t i = 0; i < n; ++i) {
+            if (out[i] != static_cast<float>(i) * 64 + 63) {
+                std::cerr << "Planned chain computed a wrong result\n";
+                return false;
+            }
+        }
+        // Nodes were added consumer-first, so ordering edges point at nodes
+        // visited earlier; every intermediate must still give its buffer up
+        bool released = input->tensor.size() == n;
+        for (size_t c = 1; c + 1 < chain.size(); ++c) released = released && chain[c]->tensor.size() == 0;
+        if (!released) {
+            std::cerr << "Intermediates should be released, inputs kept\n";
+            return false;
+        }
+    }
+
+    // An in-place node takes over its input's buffer when it reads it last
+    auto scaled = affineNode("Scaled", input);
+    auto relu = makeNode("Relu", {scaled}, n);
+    relu->inPlace = true;
+    GraphNode* reluSelf = relu.get();
+    relu->operation = [reluSelf] {
+        for (size_t i = 0; i < reluSelf->tensor.size(); ++i) reluSelf->tensor[i] -= 100;
+    };
+    auto out = affineNode("Out", relu);
+    Graph inPlace;
+    inPlace.nodes = {input, scaled, relu, out};
+    plan = inPlace.planMemory();
+    if (!plan.inPlace[2] || plan.buffer[2] != plan.buffer[1] || plan.plannedBytes != bytes ||
+        plan.naiveBytes != 2 * bytes) {
+        std::cerr << "In-place plan: " << plan.report() << "\n";
+        return false;
+    }
+    inPlace.execute(&pool, &plan);
+    if (out->tensor[3] != ((3 * 2 + 1) - 100) * 2 + 1) {
+        std::cerr << "In-place node computed a wrong result\n";
+        return false;
+    }
+    // Without a plan the in-place node still sees its input, copy-on-write
+    scaled->tensor = Tensor({n});
+    relu->tensor = Tensor({n});
+    inPlace.execute(&pool);
+    if (out->tensor[3] != ((3 * 2 + 1) - 100) * 2 + 1 || scaled->tensor[3] != 7) {
+        std::cerr << "Unplanned in-place node changed its input\n";
+        return false;
+    }
+
+    // An in-place node that reads its input again (x * 2 + x, x * x) keeps
+    // a buffer of its own instead of emptying the input under itself
+    scaled->tensor = Tensor({n});
+    auto selfSum = makeNode("SelfSum", {scaled}, n);
+    selfSum->setElementwise({{ElementwiseOp::SCALE, 2.0f}, {ElementwiseOp::ADD, 0.0f, 0}});
+    selfSum->inPlace = true;
+    auto squared = makeNode("Squared", {selfSum, selfSum}, n);
+    squared->setElementwise({{ElementwiseOp::MUL, 0.0f, 1}});
+    squared->inPlace = true;
+    auto selfOut = affineNode("SelfOut", squared);
+    Graph selfRead;
+    selfRead.nodes = {input, scaled, selfSum, squared, selfOut};
+    plan = selfRead.planMemory();
+    if (plan.inPlace[2] || plan.inPlace[3]) {
+        std::cerr << "Self-reading plan: " << plan.report() << "\n";
+        return false;
+    }
+    selfRead.execute(&pool, &plan);
+    if (selfOut->tensor[3] != 21 * 21 * 2 + 1) {
+        std::cerr << "Self-reading in-place nodes computed a wrong result\n";
+        return false;
+    }
+
+    // Parallel branches that are alive together get their own buffers; the
+    // plan still runs them concurrently
+    auto left = affineNode("L", input);
+    auto right = affineNode("R", input);
+    auto join = makeNode("J", {left, right}, n);
+    GraphNode* joinSelf = join.get();
+    join->operation = [joinSelf] {
+        for (size_t i = 0; i < joinSelf->tensor.size(); ++i) {
+            joinSelf->tensor[i] = joinSelf->inputs[0]->tensor[i] + joinSelf->inputs[1]->tensor[i];
+        }
+    };
+    Graph diamond;
+    diamond.nodes = {join, right, left, input};
+    plan = diamond.planMemory();
+    if (plan.plannedBytes != 2 * bytes || plan.buffer[1] == plan.buffer[2]) {
+        std::cerr << "Diamond plan: " << plan.report() << "\n";
+        return false;
+    }
+    for (int round = 0; round < 20; ++round) {
+        diamond.execute(&pool, &plan);
+        if (join->tensor[5] != 2 * (5 * 2 + 1)) {
+            std::cerr << "Planned diamond computed a wrong result\n";
+            return false;
+        }
+    }
+
+    // A plan only fits the graph it was made for
+    try {
+        graph.execute(&pool, &plan);
+        std::cerr << "Expected a stale plan to be rejected\n";
+        return false;
+    } catch (const std::runtime_error&) {
+    }
+    return true;
+}
+
+bool close(const Tensor& a, const Tensor& b) {
+    if (a.getShape() != b.getShape()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::fabs(a[i] - b[i]) > 1e-5f * (1.0f + std::fabs(b[i]))) return false;
+    }
+    return true;
+}
+
+std::shared_ptr<GraphNode> stepNode(const std::string& name, std::vector<std::shared_ptr<GraphNode>> inputs,
+                                    ElementwiseStep step) {
+    auto node = makeNode(name, std::move(inputs));
+    node->setElementwise({step});
+    return node;
+}
+
+bool fusionTests(ThreadPool& pool) {
+    auto x = makeNode("X", {}, 0);
+    x->tensor = Tensor({256, 300});
+    for (size_t i = 0; i < x->tensor.size(); ++i) x->tensor[i] = static_cast<float>(static_cast<int>(i % 17) - 8);
+    auto bias = makeNode("Bias", {}, 300);
+    for (size_t i = 0; i < 300; ++i) bias->tensor[i] = static_cast<float>(i % 5) - 2.0f;
+    const Tensor want = x->tensor.scale(0.5f).add(bias->tensor).relu();
+
+    // scale -> add bias -> relu, run as written, then fused into one node
+    auto scaled = stepNode("Scale", {x}, {ElementwiseOp::SCALE, 0.5f});
+    auto biased = stepNode("Bias", {scaled, bias}, {ElementwiseOp::ADD, 0.0f, 1});
+    auto relu = stepNode("Relu", {biased}, {ElementwiseOp::RELU});
+    Graph graph;
+    graph.nodes = {x, bias, scaled, biased, relu};
+    graph.execute(&pool);
+    if (!close(relu->tensor, want)) {
+        std::cerr << "Unfused elementwise chain computed a wrong result\n";
+        return false;
+    }
+
+    relu->tensor = Tensor();
+    if (graph.fuseElementwise() != 2 || graph.nodes.size() != 3 || relu->elementwise.size() != 3 ||
+        relu->inputs.size() != 2 || relu->inputs[0] != x || relu->inputs[1] != bias) {
+        std::cerr << "Chain was not fused into one node\n";
+        return false;
+    }
+    graph.execute(&pool);
+    if (!close(relu->tensor, want)) {
+        std::cerr << "Fused elementwise chain computed a wrong result\n";
+        return false;
+    }
+
+    // A producer with another reader is kept
+    auto shared = stepNode("Shared", {x}, {ElementwiseOp::ADD_SCALAR, 1.0f});
+    auto first = stepNode("First", {shared}, {ElementwiseOp::GELU});
+    auto second = stepNode("Second", {shared, shared}, {ElementwiseOp::MUL, 0.0f, 1});
+    Graph branching;
+    branching.nodes = {x, shared, first, second};
+    if (branching.fuseElementwise() != 0) {
+        std::cerr << "Fused a producer with two readers\n";
+        return false;
+    }
+    branching.execute(&pool);
+    Tensor one({1});
+    one[0] = 1.0f;
+    const Tensor shiftedX = x->tensor.add(one);
+    if (!close(first->tensor, shiftedX.gelu()) || !close(second->tensor, shiftedX.mul(shiftedX))) {
+        std::cerr << "Branching elementwise graph computed a wrong result\n";
+        return false;
+    }
+
+    // runElementwise takes views, other dtypes and broadcast operands
+    const Tensor xt = x->tensor.transpose(0, 1);
+    Tensor rowBias({300, 1});
+    for (size_t i = 0; i < 300; ++i) rowBias[i] = static_cast<float>(i % 3);
+    const Tensor halfBias = rowBias.cast(DType::FLOAT16);
+    Tensor three({1});
+    three[0] = 3.0f;
+    Tensor out;
+    runElementwise({{ElementwiseOp::ADD, 0.0f, 0}, {ElementwiseOp::ADD_SCALAR, 3.0f}, {ElementwiseOp::GELU}}, xt,
+                   {&halfBias}, out);
+    if (!close(out, xt.add(rowBias).add(three).gelu())) {
+        std::cerr << "runElementwise over a view computed a wrong result\n";
+        return false;
+    }
+
+    // In place, copy-on-write like any other write
+    Tensor y = x->tensor;
+    runElementwise({{ElementwiseOp::SCALE, 2.0f}}, y, {}, y);
+    if (!close(y, x->tensor.scale(2.0f)) || x->tensor[1] != -7.0f) {
+        std::cerr << "In-place runElementwise computed a wrong result\n";
+        return false;
+    }
+    try {
+        runElementwise({{ElementwiseOp::MUL, 0.0f, 1}}, y, {&y}, out);
+        std::cerr << "Expected a missing operand to be rejected\n";
+        return false;
+    } catch (const std::runtime_error&) {
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    ThreadPool pool(4, PoolMode::WORK_STEALING);
+
+    // Diamond: input -> (left, right) -> join. Nodes are added in reverse so
+    // a naive in-order executor would run consumers before producers.
+    auto input = makeNode("Input", {});
+    for (size_t i = 0; i < input->tensor.size(); ++i) input->tensor[i] = static_cast<float>(i + 1);
+
+    auto left = makeNode("Left", {input});
+    left->operation = [left] {
+        const Tensor& in = left->inputs[0]->tensor;
+        for (size_t i = 0; i < in.size(); ++i) left->tensor[i] = in[i] * 2;
+    };
+
+    auto right = makeNode("Right", {input});
+    right->operation = [right] {
+        const Tensor& in = right->inputs[0]->tensor;
+        for (size_t i = 0; i < in.size(); ++i) right->tensor[i] = in[i] + 10;
+    };
+
+    auto join = makeNode("Join", {left, right});
+    join->operation = [join] {
+        for (size_t i = 0; i < join->tensor.size(); ++i) {
+            join->tensor[i] = join->inputs[0]->tensor[i] + join->inputs[1]->tensor[i];
+        }
+    };
+
+    Graph graph;
+    graph.nodes = {join, right, left, input};
+
+    for (int round = 0; round < 50; ++round) {
+        graph.execute(&pool);
+        for (size_t i = 0; i < join->tensor.size(); ++i) {
+            float x = static_cast<float>(i + 1);
+            if (join->tensor[i] != x * 2 + x + 10) {
+                std::cerr << "Join computed before its inputs were ready\n";
+                return 1;
+            }
+        }
+    }
+
+    // A failing node skips its dependents and surfaces the exception
+    std::atomic<bool> downstreamRan{false};
+    auto bad = makeNode("Bad", {input});
+    bad->operation = [] { throw std::runtime_error("bad op"); };
+    auto after = makeNode("After", {bad});
+    after->operation = [&downstreamRan] { downstreamRan = true; };
+
+    Graph failing;
+    failing.nodes = {input, bad, after};
+    try {
+        failing.execute(&pool);
+        std::cerr << "Expected exception from failing graph\n";
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+    if (downstreamRan) {
+        std::cerr << "Dependent of failed node was executed\n";
+        return 1;
+    }
+
+    // Cycles are rejected instead of hanging
+    auto a = makeNode("A", {});
+    auto b = makeNode("B", {a});
+    a->inputs.push_back(b);
+    a->operation = [] {};
+    b->operation = [] {};
+    Graph cyclic;
+    cyclic.nodes = {a, b};
+    bool rejected = false;
+    try {
+        cyclic.execute(&pool);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    a->inputs.clear(); // break the shared_ptr cycle
+    if (!rejected) {
+        std::cerr << "Cycle was not detected\n";
+        return 1;
+    }
+
+    if (!planTests(pool)) return 1;
+    if (!fusionTests(pool)) return 1;
+
+    std::cout << "Graph executor tests passed\n";
+    return 0;
+}
@@ -0,0 +1,268 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "Kernels.h"
+#include "Tensor.h"
+
+namespace {
+
+int failures = 0;
+
+void expectNear(double got, double want, double tol, const char* what, size_t n, kernels::SimdLevel level) {
+    if (std::fabs(got - want) > tol * (1.0 + std::fabs(want))) {
+        std::cerr << kernels::simdLevelName(level) << " " << what << " n=" << n
+                  << ": got " << got << " want " << want << "\n";
+        ++failures;
+    }
+}
+
+double geluRef(double x) {
+    return 0.5 * x * (1.0 + std::tanh(0.7978845608028654 * (x + 0.044715 * x * x * x)));
+}
+
+void checkLevel(kernels::SimdLevel level) {
+    // Sizes straddle every vector width so tails are exercised
+    const size_t sizes[] = {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 33, 64, 100, 1000};
+    for (size_t n : sizes) {
+        std::vector<float> a(n), b(n), c(n), out(n);
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = static_cast<float>((static_cast<int>(i * 37 % 101) - 50) * 0.13);
+            b[i] = static_cast<float>((static_cast<int>(i * 17 % 89) - 44) * 0.07);
+            c[i] = static_cast<float>(i % 5) - 2.0f;
+        }
+
+        kernels::add(a.data(), b.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) expectNear(out[i], a[i] + b[i], 1e-6, "add", n, level);
+
+        kernels::mul(a.data(), b.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) expectNear(out[i], a[i] * b[i], 1e-6, "mul", n, level);
+
+        kernels::scale(a.data(), 2.5f, out.data(), n);
+        for (size_t i = 0; i < n; ++i) expectNear(out[i], a[i] * 2.5f, 1e-6, "scale", n, level);
+
+        kernels::fma(a.data(), b.data(), c.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) expectNear(out[i], double(a[i]) * b[i] + c[i], 1e-5, "fma", n, level);
+
+        kernels::relu(a.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) expectNear(out[i], a[i] > 0 ? a[i] : 0.0f, 0, "relu", n, level);
+
+        kernels::gelu(a.data(), out.data(), n);
+        for (size_t i = 0; i < n; ++i) expectNear(out[i], geluRef(a[i]), 1e-5, "gelu", n, level);
+
+        double sum = 0, dot = 0, mx = -INFINITY;
+        for (size_t i = 0; i < n; ++i) {
+            sum += a[i];
+            dot += double(a[i]) * b[i];
+            mx = std::max<double>(mx, a[i]);
+        }
+        expectNear(kernels::sum(a.data(), n), sum, 1e-4, "sum", n, level);
+        expectNear(kernels::dot(a.data(), b.data(), n), dot, 1e-4, "dot", n, level);
+        if (n > 0) expectNear(kernels::max(a.data(), n), mx, 0, "max", n, level);
+        else if (!std::isinf(kernels::max(a.data(), n))) ++failures;
+    }
+
+    // In-place updates are allowed
+    std::vector<float> x = {-1.0f, 2.0f, -3.0f, 4.0f, 5.0f};
+    kernels::relu(x.data(), x.data(), x.size());
+    expectNear(x[0] + x[2], 0.0, 0, "relu in-place", x.size(), level);
+    expectNear(x[4], 5.0, 0, "relu in-place", x.size(), level);
+}
+
+// Encodings of one input at the scalar level, the reference every SIMD
+// level must reproduce bit for bit
+struct Encoded {
+    std::vector<uint16_t> half, bf16;
+    std::vector<char> q8;
+    std::vector<float> halfBack, bf16Back, q8Back;
+};
+
+std::vector<float> conversionInput() {
+    std::vector<float> in;
+    // Values that stress rounding: halfway cases, subnormals, overflow,
+    // signed zero, infinities and NaN, plus a spread of ordinary numbers
+    const float special[] = {0.0f, -0.0f, 1.0f, -2.5f, 65504.0f, 65519.0f, 65520.0f, 1e9f, 6.1e-5f,
+                             5.96e-8f, 2.98e-8f, 1e-10f, 1.00048828125f, 1.00146484375f, 3.0e38f,
+                             std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+                             std::numeric_limits<float>::quiet_NaN()};
+    in.assign(std::begin(special), std::end(special));
+    for (size_t i = 0; i < 1000; ++i) in.push_back(static_cast<float>(std::sin(i * 0.37) * std::pow(10.0, static_cast<int>(i % 7) - 3)));
+    return in;
+}
+
+Encoded encodeAll(const std::vector<float>& in, size_t n) {
+    Encoded e;
+    e.half.resize(n);
+    e.bf16.resize(n);
+    e.q8.resize(kernels::q8Bytes(n));
+    e.halfBack.resize(n);
+    e.bf16Back.resize(n);
+    e.q8Back.resize(n);
+    kernels::floatToHalf(in.data(), e.half.data(), n);
+    kernels::halfToFloat(e.half.data(), e.halfBack.data(), n);
+    kernels::floatToBfloat16(in.data(), e.bf16.data(), n);
+    kernels::bfloat16ToFloat(e.bf16.data(), e.bf16Back.data(), n);
+    kernels::quantizeQ8(in.data(), e.q8.data(), n);
+    kernels::dequantizeQ8(e.q8.data(), e.q8Back.data(), n);
+    return e;
+}
+
+bool sameBits(const std::vector<float>& a, const std::vector<float>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+}
+
+void checkConversions(kernels::SimdLevel level, const std::vector<Encoded>& reference) {
+    const std::vector<float> in = conversionInput();
+    const size_t sizes[] = {0, 7, 16, 33, 100, in.size()};
+    for (size_t k = 0; k < reference.size(); ++k) {
+        const size_t n = sizes[k];
+        Encoded e = encodeAll(in, n);
+        const Encoded& want = reference[k];
+        if (e.half != want.half || !sameBits(e.halfBack, want.halfBack) || e.bf16 != want.bf16 ||
+            !sameBits(e.bf16Back, want.bf16Back)) {
+            std::cerr << kernels::simdLevelName(level) << " half/bfloat16 conversion differs from scalar, n=" << n << "\n";
+            ++failures;
+        }
+        // Including the first block, which holds the infinities and NaN
+        if (e.q8 != want.q8) {
+            std::cerr << kernels::simdLevelName(level) << " qint8 conversion differs from scalar, n=" << n << "\n";
+            ++failures;
+        }
+    }
+}
+
+std::vector<Encoded> conversionReference() {
+    const std::vector<float> in = conversionInput();
+    const size_t sizes[] = {0, 7, 16, 33, 100, in.size()};
+    std::vector<Encoded> out;
+    for (size_t n : sizes) out.push_back(encodeAll(in, n));
+
+    // Known encodings and error bounds, checked once on the reference
+    const Encoded& e = out.back();
+    const uint16_t half[] = {0x0000, 0x8000, 0x3C00, 0xC100, 0x7BFF, 0x7BFF, 0x7C00, 0x7C00};
+    const uint16_t bf16[] = {0x0000, 0x8000, 0x3F80, 0xC020};
+    for (size_t i = 0; i < 8; ++i) {
+        if (e.half[i] != half[i]) {
+            std::cerr << "floatToHalf(" << in[i] << ") = " << e.half[i] << ", want " << half[i] << "\n";
+            ++failures;
+        }
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        if (e.bf16[i] != bf16[i]) {
+            std::cerr << "floatToBfloat16(" << in[i] << ") = " << e.bf16[i] << ", want " << bf16[i] << "\n";
+            ++failures;
+        }
+    }
+    // Ties go to even: 1 + 2^-11 rounds down, 1 + 3 * 2^-11 rounds up
+    if (e.half[12] != 0x3C00 || e.half[13] != 0x3C02) {
+        std::cerr << "floatToHalf does not round to nearest even\n";
+        ++failures;
+    }
+    if (!std::isnan(e.halfBack[17]) || !std::isnan(e.bf16Back[17]) || !std::isinf(e.bf16Back[15])) {
+        std::cerr << "Infinity/NaN not preserved\n";
+        ++failures;
+    }
+    for (size_t i = 18; i < in.size(); ++i) {
+        const double x = in[i];
+        if (std::fabs(x) >= 6.2e-5 && std::fabs(e.halfBack[i] - x) > std::fabs(x) * 0x1p-11) {
+            std::cerr << "half error too large at " << x << "\n";
+            ++failures;
+        }
+        if (std::fabs(e.bf16Back[i] - x) > std::fabs(x) * 0x1p-8) {
+            std::cerr << "bfloat16 error too large at " << x << "\n";
+            ++failures;
+        }
+    }
+    // Non-finite inputs: absmax ignores them, NaN -> 0, ±Inf -> ±127, or 0
+    // when nothing finite and nonzero sets the scale
+    {
+        const float inf = std::numeric_limits<float>::infinity(), nan = std::numeric_limits<float>::quiet_NaN();
+        std::vector<float> block(kernels::Q8_BLOCK, 0.0f);
+        block[0] = 2.0f;
+        block[1] = -1.0f;
+        block[2] = nan;
+        block[3] = inf;
+        block[4] = -inf;
+        std::vector<char> q(kernels::q8Bytes(block.size()));
+        for (size_t len : {block.size(), size_t(5)}) { // full block, then the scalar tail
+            kernels::quantizeQ8(block.data(), q.data(), len);
+            float scale;
+            std::memcpy(&scale, q.data(), sizeof(scale));
+            const int8_t* v = reinterpret_cast<const int8_t*>(q.data() + sizeof(scale));
+            if (scale != 2.0f / 127.0f || v[0] != 127 || v[1] != -64 || v[2] != 0 || v[3] != 127 || v[4] != -127) {
+                std::cerr << "qint8 non-finite handling wrong, n=" << len << "\n";
+                ++failures;
+            }
+        }
+        std::fill(block.begin(), block.end(), 0.0f);
+        block[7] = inf;
+        block[8] = nan;
+        kernels::quantizeQ8(block.data(), q.data(), block.size());
+        bool zeros = true;
+        for (size_t i = 0; i < q.size(); ++i) zeros = zeros && q[i] == 0;
+        if (!zeros) {
+            std::cerr << "qint8 block without a finite scale should be all zero\n";
+            ++failures;
+        }
+    }
+
+    // Every dequantized value is within half a step of its block's scale
+    for (size_t b = 1; b * kernels::Q8_BLOCK < in.size(); ++b) {
+        float scale;
+        std::memcpy(&scale, e.q8.data() + b * kernels::Q8_BLOCK_BYTES, sizeof(scale));
+        for (size_t i = b * kernels::Q8_BLOCK; i < std::min(in.size(), (b + 1) * kernels::Q8_BLOCK); ++i) {
+            if (std::fabs(e.q8Back[i] - in[i]) > scale * 0.5001f) {
+                std::cerr << "qint8 error too large at " << in[i] << "\n";
+                ++failures;
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+int main() {
+    const kernels::SimdLevel detected = kernels::detectedSimdLevel();
+    std::cout << "Detected SIMD level: " << kernels::simdLevelName(detected) << "\n";
+
+    const kernels::SimdLevel levels[] = {kernels::SimdLevel::SCALAR, kernels::SimdLevel::SSE,
+                                         kernels::SimdLevel::AVX2, kernels::SimdLevel::AVX512};
+    kernels::setSimdLevel(kernels::SimdLevel::SCALAR);
+    const std::vector<Encoded> reference = conversionReference();
+    for (kernels::SimdLevel level : levels) {
+        if (level > detected) break;
+        kernels::setSimdLevel(level);
+        checkLevel(level);
+        checkConversions(level, reference);
+    }
+    kernels::setSimdLevel(detected);
+
+    // Tensor-level wrappers
+    Tensor t({2, 3});
+    for (size_t i = 0; i < t.size(); ++i) t[i] = static_cast<float>(i);
+    Tensor doubled = t.scale(2.0f);
+    if (doubled.sum() != 30.0f || t.mean() != 2.5f || t.max() != 5.0f || t.dot(t) != 55.0f) {
+        std::cerr << "Tensor kernel wrappers returned wrong results\n";
+        ++failures;
+    }
+    bool threw = false;
+    try {
+        t.add(Tensor({4}));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) {
+        std::cerr << "Size mismatch was not rejected\n";
+        ++failures;
+    }
+
+    if (failures) {
+        std::cerr << failures << " kernel checks failed\n";
+        return 1;
+    }
+    std::cout << "Kernel tests passed\n";
+    return 0;
+}
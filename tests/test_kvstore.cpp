@@ -0,0 +1,372 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "KVStore.h"
+#include "Tensor.h"
+#include "ThreadPool.h"
+#include "TestUtil.h"
+
+int main() {
+    // KVStore writes relative to the working directory
+    char dirTemplate[] = "/tmp/kvstore_test_XXXXXX";
+    if (!mkdtemp(dirTemplate) || chdir(dirTemplate) != 0 || mkdir("checkpoints", 0755) != 0) {
+        std::cerr << "could not set up scratch directory\n";
+        return 1;
+    }
+
+    // Copies share storage until written
+    Tensor a({4});
+    for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<float>(i);
+    Tensor b = a;
+    expect(static_cast<const Tensor&>(b).dataPtr() == static_cast<const Tensor&>(a).dataPtr(),
+           "copy shares storage");
+    b[0] = 100.0f;
+    expect(a[0] == 0.0f && b[0] == 100.0f, "write to copy leaves original untouched");
+
+    KVStore store;
+    Tensor weights({64, 32});
+    for (size_t i = 0; i < weights.size(); ++i) weights[i] = static_cast<float>(i) * 0.5f;
+    store.put("weights", weights);
+    expect(store.saveToDisk("weights"), "saveToDisk");
+
+    KVStore readStore;
+    Tensor loaded;
+    expect(readStore.loadFromDisk("weights", LoadMode::READ), "loadFromDisk READ");
+    expect(readStore.get("weights", loaded) && !loaded.isReadOnlyView(), "READ mode owns its data");
+    expect(loaded.sum() == weights.sum(), "READ mode contents");
+
+    KVStore mapStore;
+    Tensor mapped;
+    expect(mapStore.loadFromDisk("weights", LoadMode::MMAP), "loadFromDisk MMAP");
+    expect(mapStore.get("weights", mapped) && mapped.isReadOnlyView(), "MMAP mode borrows mapped pages");
+    expect(mapped.getShape() == weights.getShape() && mapped.sum() == weights.sum(), "MMAP mode contents");
+
+    // Overwrite the checkpoint while it is mapped: rename keeps the old
+    // mapping valid and unchanged
+    Tensor replacement({8});
+    store.put("weights", replacement);
+    expect(store.saveToDisk("weights"), "saveToDisk over mapped file");
+    expect(mapped.sum() == weights.sum(), "mapping survives checkpoint replacement");
+
+    // First write copies out of the mapping
+    Tensor writable = mapped;
+    writable[0] = -1.0f;
+    expect(!writable.isReadOnlyView() && mapped.isReadOnlyView(), "write detaches from mapping");
+    expect(mapped[0] == 0.0f && writable[0] == -1.0f, "detached copy is private");
+
+    // Corrupt files are reported, not loaded
+    {
+        FILE* f = fopen("checkpoints/broken.chk", "wb");
+        fputs("not a tensor", f);
+        fclose(f);
+    }
+    expect(!mapStore.loadFromDisk("broken", LoadMode::MMAP), "corrupt checkpoint rejected");
+
+    // Handles are immutable snapshots that survive later puts
+    KVStore shared;
+    Tensor v1({1024});
+    for (size_t i = 0; i < v1.size(); ++i) v1[i] = 1.0f;
+    shared.put("hot", v1);
+    std::shared_ptr<const Tensor> handle = shared.get("hot");
+    expect(handle && shared.get("hot") == handle, "get returns the stored handle without copying");
+    shared.put("hot", Tensor({4}));
+    expect(handle->size() == 1024 && handle->sum() == 1024.0f, "old handle unchanged by put");
+    expect(!shared.get("missing"), "missing key returns null");
+
+    // Concurrent readers of one hot key alongside writers to others
+    std::atomic<bool> stop{false};
+    std::atomic<int> badReads{0};
+    std::vector<std::thread> threads;
+    for (int r = 0; r < 4; ++r) {
+        threads.emplace_back([&] {
+            while (!stop) {
+                std::shared_ptr<const Tensor> t = shared.get("hot");
+                if (!t || (t->size() != 4 && t->size() != 16)) ++badReads;
+            }
+        });
+    }
+    threads.emplace_back([&] {
+        for (int i = 0; i < 2000; ++i) {
+            shared.put("hot", Tensor({i % 2 ? size_t(4) : size_t(16)}));
+            shared.put("key" + std::to_string(i % 50), Tensor({2}));
+        }
+        stop = true;
+    });
+    for (auto& t : threads) t.join();
+    expect(badReads == 0, "concurrent readers always see a complete value");
+
+    // Write-behind: nothing hits disk until the interval or a flush, and
+    // repeated puts to one key are written once with the latest value
+    {
+        KVStore writer;
+        CheckpointConfig config;
+        config.flushInterval = std::chrono::milliseconds(60000);
+        config.durability = Durability::FILE_AND_DIR;
+        writer.startCheckpointing(config);
+        for (int i = 1; i <= 50; ++i) {
+            Tensor t({8});
+            for (size_t j = 0; j < t.size(); ++j) t[j] = static_cast<float>(i);
+            writer.put("behind", t);
+            writer.scheduleSave("behind");
+        }
+        expect(access("checkpoints/behind.chk", F_OK) != 0, "scheduled save is deferred");
+        expect(writer.flush(), "flush reports success");
+        KVStore reader;
+        expect(reader.loadFromDisk("behind") && reader.get("behind")->sum() == 400.0f,
+               "flush writes the latest value");
+
+        writer.put("behind", Tensor({3}));
+        writer.scheduleSave("behind");
+        writer.stopCheckpointing();
+        expect(reader.loadFromDisk("behind") && reader.get("behind")->size() == 3,
+               "stopping the writer flushes pending keys");
+
+        // Without a running writer scheduleSave falls back to a direct save
+        writer.put("direct", Tensor({5}));
+        writer.scheduleSave("direct");
+        expect(access("checkpoints/direct.chk", F_OK) == 0, "scheduleSave saves synchronously when stopped");
+    }
+
+    // Concurrent stops all wait for the writer to drain, and the writer can
+    // be started again afterwards
+    {
+        KVStore writer;
+        CheckpointConfig config;
+        config.flushInterval = std::chrono::milliseconds(60000);
+        config.durability = Durability::NONE;
+        writer.startCheckpointing(config);
+        const int keys = 64;
+        for (int i = 0; i < keys; ++i) {
+            std::remove(("checkpoints/stopped" + std::to_string(i) + ".chk").c_str());
+            const std::string key = "stopped" + std::to_string(i);
+            writer.put(key, Tensor({size_t(1) << 18}));
+            writer.scheduleSave(key);
+        }
+        std::atomic<bool> go{false};
+        std::atomic<int> drained{0};
+        std::vector<std::thread> stoppers;
+        for (int t = 0; t < 2; ++t) {
+            stoppers.emplace_back([&writer, &go, &drained] {
+                while (!go) std::this_thread::yield();
+                writer.stopCheckpointing();
+                bool all = true;
+                for (int i = 0; i < keys; ++i) {
+                    all = all && access(("checkpoints/stopped" + std::to_string(i) + ".chk").c_str(), F_OK) == 0;
+                }
+                if (all) ++drained;
+            });
+        }
+        go = true;
+        for (auto& t : stoppers) t.join();
+        expect(drained == 2, "every stopper returns after the writer drained");
+        std::remove("checkpoints/stopped0.chk");
+        writer.startCheckpointing(config);
+        writer.scheduleSave("stopped0");
+        writer.stopCheckpointing();
+        expect(access("checkpoints/stopped0.chk", F_OK) == 0, "writer restarts after a stop");
+    }
+
+    // Short intervals persist without an explicit flush
+    {
+        KVStore writer;
+        CheckpointConfig config;
+        config.flushInterval = std::chrono::milliseconds(5);
+        config.durability = Durability::NONE;
+        writer.startCheckpointing(config);
+        writer.put("timed", Tensor({7}));
+        writer.scheduleSave("timed");
+        bool written = false;
+        for (int i = 0; i < 200 && !written; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            written = access("checkpoints/timed.chk", F_OK) == 0;
+        }
+        expect(written, "writer persists after its interval");
+    }
+
+    // Whole-store snapshots: many keys, mixed dtypes and sizes (one big
+    // enough to be split into pieces), saved and restored in parallel
+    {
+        ThreadPool pool(4);
+        KVStore source;
+        for (int i = 0; i < 300; ++i) {
+            Tensor t({3, size_t(i % 7 + 1)});
+            for (size_t j = 0; j < t.size(); ++j) t[j] = static_cast<float>(i * 100 + j);
+            source.put("k" + std::to_string(i), t);
+        }
+        Tensor big({5u << 20});
+        for (size_t j = 0; j < big.size(); ++j) big[j] = static_cast<float>(j % 1000);
+        source.put("big", big);
+        source.put("half", big.slice(0, 0, 10).cast(DType::FLOAT16));
+        source.put("view", big.reshape({1024, 5120}).transpose(0, 1).slice(0, 0, 2));
+        source.put("empty", Tensor({0}));
+        expect(source.saveSnapshot("checkpoints/store.snap", &pool), "snapshot saved");
+
+        for (LoadMode mode : {LoadMode::READ, LoadMode::MMAP}) {
+            KVStore restored;
+            restored.put("other", Tensor({1}));
+            expect(restored.loadSnapshot("checkpoints/store.snap", mode, &pool), "snapshot loaded");
+            auto k = restored.get("k123");
+            expect(k && k->getShape() == std::vector<size_t>({3, 5}) && (*k)[11] == 12311.0f, "small tensor restored");
+            auto b = restored.get("big");
+            expect(b && b->size() == big.size() && b->sum() == big.sum(), "multi-piece tensor restored");
+            expect(reinterpret_cast<uintptr_t>(b->rawData()) % 4096 == 0 || mode == LoadMode::READ,
+                   "mapped data is page-aligned");
+            auto h = restored.get("half");
+            expect(h && h->dtype() == DType::FLOAT16 && h->cast(DType::FLOAT32)[9] == 9.0f, "float16 restored");
+            auto v = restored.get("view");
+            expect(v && v->getShape() == std::vector<size_t>({2, 1024}) && (*v)[1] == 120.0f, "view packed");
+            expect(restored.get("empty") && restored.get("empty")->size() == 0, "empty tensor restored");
+            expect(restored.get("other") != nullptr, "other keys kept");
+            expect(restored.bytes() == source.bytes() + 4, "every key restored");
+        }
+
+        // A corrupt index is rejected before anything is stored
+        FILE* f = fopen("checkpoints/store.snap", "r+b");
+        fseek(f, 40, SEEK_SET);
+        fputc('X', f);
+        fclose(f);
+        KVStore rejected;
+        expect(!rejected.loadSnapshot("checkpoints/store.snap") && rejected.bytes() == 0, "corrupt snapshot rejected");
+        expect(!rejected.loadSnapshot("checkpoints/missing.snap"), "missing snapshot");
+    }
+
+    // Incremental checkpoints write only changed chunks and restore as
+    // base plus deltas
+    {
+        auto fileSize = [](const std::string& path) {
+            struct stat st;
+            return stat(path.c_str(), &st) == 0 ? static_cast<long>(st.st_size) : -1L;
+        };
+        auto sameAs = [](const Tensor& a, const Tensor& b) {
+            if (a.getShape() != b.getShape()) return false;
+            for (size_t i = 0; i < a.size(); ++i) {
+                if (a[i] != b[i]) return false;
+            }
+            return true;
+        };
+        DeltaConfig config;
+        config.chunkBytes = 16 << 10;
+        config.maxDeltas = 3;
+
+        KVStore store;
+        Tensor model({1 << 16}); // 16 chunks
+        for (size_t i = 0; i < model.size(); ++i) model[i] = static_cast<float>(i % 500);
+        store.put("model", model);
+        expect(store.saveIncremental("model", config), "first incremental save");
+        expect(fileSize("checkpoints/model.chk") > (1 << 18) && access("checkpoints/model.manifest", F_OK) == 0,
+               "first save writes a full base");
+
+        model[5] = -1.0f;
+        store.put("model", model);
+        expect(store.saveIncremental("model", config), "delta saved");
+        expect(fileSize("checkpoints/model.delta.0") > (16 << 10) && fileSize("checkpoints/model.delta.0") < (17 << 10),
+               "delta holds one chunk");
+        expect(store.saveIncremental("model", config) && access("checkpoints/model.delta.1", F_OK) != 0,
+               "unchanged value writes nothing");
+        const Tensor afterFirst = model;
+        model[40000] = -2.0f;
+        model[60000] = -3.0f;
+        store.put("model", model);
+        expect(store.saveIncremental("model", config) && fileSize("checkpoints/model.delta.1") > (32 << 10),
+               "second delta holds two chunks");
+
+        for (LoadMode mode : {LoadMode::READ, LoadMode::MMAP}) {
+            KVStore restored;
+            expect(restored.loadFromDisk("model", mode) && sameAs(*restored.get("model"), model),
+                   "base and deltas replayed");
+            // Deltas patch the copy-on-write mapping instead of detaching it
+            expect(mode == LoadMode::READ || restored.get("model")->isReadOnlyView(), "mapped base stays mapped");
+        }
+
+        // A base with the same contents in a new file (say, a copied
+        // directory) is recognised by its hash
+        {
+            std::ifstream in("checkpoints/model.chk", std::ios::binary);
+            std::vector<char> copy((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            std::ofstream("checkpoints/model.copy", std::ios::binary).write(copy.data(), copy.size());
+            std::rename("checkpoints/model.copy", "checkpoints/model.chk");
+            KVStore restored;
+            expect(restored.loadFromDisk("model") && sameAs(*restored.get("model"), model), "copied base replayed");
+        }
+
+        // After a reload that replayed them, saves keep appending deltas
+        store.loadFromDisk("model");
+        model = *store.get("model");
+        model[0] = 7.0f;
+        store.put("model", model);
+        expect(store.saveIncremental("model", config) && access("checkpoints/model.delta.2", F_OK) == 0,
+               "replayed state continues with deltas");
+
+        // A damaged delta stops the replay at the one before
+        FILE* f = fopen("checkpoints/model.delta.1", "r+b");
+        fseek(f, 100, SEEK_SET);
+        fputc('X', f);
+        fclose(f);
+        {
+            KVStore restored;
+            expect(restored.loadFromDisk("model") && sameAs(*restored.get("model"), afterFirst),
+                   "replay stops before a damaged delta");
+        }
+
+        // maxDeltas reached: the next save compacts into a new base
+        model[1] = 9.0f;
+        store.put("model", model);
+        expect(store.saveIncremental("model", config), "compacting save");
+        expect(access("checkpoints/model.delta.0", F_OK) != 0 && access("checkpoints/model.delta.1", F_OK) != 0,
+               "compaction removes old deltas");
+        {
+            KVStore restored;
+            expect(restored.loadFromDisk("model") && sameAs(*restored.get("model"), model), "compacted base loads");
+        }
+
+        // A full save supersedes the manifest; its deltas are ignored
+        model[2] = 11.0f;
+        store.put("model", model);
+        expect(store.saveIncremental("model", config) && access("checkpoints/model.delta.3", F_OK) == 0,
+               "delta after compaction");
+        Tensor replaced({1 << 16});
+        store.put("model", replaced);
+        expect(store.saveToDisk("model"), "full save");
+        expect(access("checkpoints/model.manifest", F_OK) != 0 && access("checkpoints/model.delta.3", F_OK) != 0,
+               "full save removes the manifest and its deltas");
+        {
+            KVStore restored;
+            expect(restored.loadFromDisk("model") && restored.get("model")->sum() == 0.0f,
+                   "deltas of a replaced base ignored");
+        }
+
+        // The write-behind writer can checkpoint incrementally
+        KVStore writer;
+        CheckpointConfig behind;
+        behind.durability = Durability::NONE;
+        behind.incremental = true;
+        behind.delta = config;
+        writer.startCheckpointing(behind);
+        writer.put("behind_model", model);
+        writer.scheduleSave("behind_model");
+        writer.flush();
+        model[3] = 13.0f;
+        writer.put("behind_model", model);
+        writer.scheduleSave("behind_model");
+        expect(writer.flush() && access("checkpoints/behind_model.delta.0", F_OK) == 0, "writer writes deltas");
+        KVStore restored;
+        expect(restored.loadFromDisk("behind_model") && sameAs(*restored.get("behind_model"), model),
+               "writer's deltas replayed");
+    }
+
+    std::string cleanup = std::string("rm -rf ") + dirTemplate;
+    if (std::system(cleanup.c_str()) != 0) std::cerr << "cleanup failed\n";
+
+    if (failures) return 1;
+    std::cout << "KVStore tests passed\n";
+    return 0;
+}
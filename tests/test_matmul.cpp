@@ -0,0 +1,102 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "Kernels.h"
+#include "MatMul.h"
+#include "Tensor.h"
+#include "ThreadPool.h"
+
+namespace {
+
+int failures = 0;
+
+void fill(Tensor& t, int seed) {
+    for (size_t i = 0; i < t.size(); ++i) {
+        t[i] = static_cast<float>(static_cast<int>((i * 2654435761u + seed) % 17) - 8) * 0.25f;
+    }
+}
+
+// Naive reference in double precision
+bool matches(const Tensor& a, const Tensor& b, const Tensor& c, size_t batch, bool sharedB) {
+    const auto& as = a.getShape();
+    const size_t M = as[as.size() - 2], K = as[as.size() - 1];
+    const size_t N = c.getShape().back();
+    for (size_t bi = 0; bi < batch; ++bi) {
+        for (size_t i = 0; i < M; ++i) {
+            for (size_t j = 0; j < N; ++j) {
+                double want = 0;
+                for (size_t p = 0; p < K; ++p) {
+                    const size_t bIndex = (sharedB ? 0 : bi * K * N) + p * N + j;
+                    want += double(a[bi * M * K + i * K + p]) * b[bIndex];
+                }
+                const double got = c[bi * M * N + i * N + j];
+                if (std::fabs(got - want) > 1e-3 * (1.0 + std::fabs(want))) return false;
+            }
+        }
+    }
+    return true;
+}
+
+void check2d(size_t M, size_t N, size_t K, ThreadPool* pool) {
+    Tensor a({M, K}), b({K, N});
+    fill(a, 1);
+    fill(b, 7);
+    Tensor c = a.matmul(b, pool);
+    if (!matches(a, b, c, 1, false)) {
+        std::cerr << kernels::simdLevelName(kernels::activeSimdLevel()) << " matmul " << M << "x" << K
+                  << " * " << K << "x" << N << (pool ? " (pool)" : "") << " mismatch\n";
+        ++failures;
+    }
+}
+
+} // namespace
+
+int main() {
+    ThreadPool pool(3);
+
+    const kernels::SimdLevel detected = kernels::detectedSimdLevel();
+    const kernels::SimdLevel levels[] = {kernels::SimdLevel::SCALAR, kernels::SimdLevel::AVX2,
+                                         kernels::SimdLevel::AVX512};
+    for (kernels::SimdLevel level : levels) {
+        if (level > detected) continue;
+        kernels::setSimdLevel(level);
+        // Edge tiles in every direction, K spanning several KC blocks
+        check2d(1, 1, 1, nullptr);
+        check2d(5, 7, 3, nullptr);
+        check2d(13, 33, 17, nullptr);
+        check2d(97, 65, 300, nullptr);
+        check2d(130, 200, 600, &pool);
+        check2d(7, 2100, 40, &pool);
+        check2d(4, 4, 0, nullptr);
+    }
+    kernels::setSimdLevel(detected);
+
+    // Batched, with per-batch and shared right operands
+    Tensor a({3, 20, 30}), b({3, 30, 25}), shared({30, 25});
+    fill(a, 3);
+    fill(b, 5);
+    fill(shared, 11);
+    if (!matches(a, b, a.matmul(b, &pool), 3, false)) {
+        std::cerr << "batched matmul mismatch\n";
+        ++failures;
+    }
+    if (!matches(a, shared, a.matmul(shared), 3, true)) {
+        std::cerr << "batched matmul with shared operand mismatch\n";
+        ++failures;
+    }
+
+    bool threw = false;
+    try {
+        Tensor({2, 3}).matmul(Tensor({2, 3}));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) {
+        std::cerr << "shape mismatch was not rejected\n";
+        ++failures;
+    }
+
+    if (failures) return 1;
+    std::cout << "MatMul tests passed\n";
+    return 0;
+}
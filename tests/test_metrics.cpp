@@ -0,0 +1,125 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Metrics.h"
+#include "Scheduler.h"
+#include "TestUtil.h"
+
+namespace {
+
+// Within the histogram's ~3% bucket precision
+bool near(uint64_t got, uint64_t want) {
+    double diff = got > want ? double(got - want) : double(want - got);
+    return diff <= 0.04 * double(want);
+}
+
+bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+} // namespace
+
+int main() {
+    // Buckets cover every value and bound it within ~3%
+    {
+        bool bounded = true;
+        size_t last = 0;
+        for (uint64_t v : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, 1ull << 40, ~0ull}) {
+            size_t b = Histogram::bucketFor(v);
+            uint64_t upper = Histogram::bucketUpperBound(b);
+            bounded = bounded && b < Histogram::BUCKETS && b >= last && upper >= v && upper - v <= v / 32;
+            last = b;
+        }
+        expect(bounded, "bucket bounds");
+        expect(Histogram::bucketFor(~0ull) == Histogram::BUCKETS - 1, "largest value in the last bucket");
+    }
+
+    // Percentiles of 1..100000 ns
+    {
+        Histogram h;
+        expect(h.percentile(0.5) == 0 && h.summary().count == 0, "empty histogram");
+        for (uint64_t v = 1; v <= 100000; ++v) h.record(v);
+        HistogramSummary s = h.summary();
+        expect(s.count == 100000 && s.min == 1 && s.max == 100000, "count, min and max");
+        expect(near(s.p50, 50000) && near(s.p99, 99000) && near(s.p999, 99900), "p50, p99, p999");
+        expect(s.p50 == h.percentile(0.5) && s.p99 == h.percentile(0.99), "summary matches percentile()");
+        expect(s.mean > 49000 && s.mean < 51000, "mean");
+        expect(h.percentile(1.0) == 100000, "p100 is the max");
+    }
+
+    // Counters and histograms from many threads lose nothing
+    {
+        MetricsRegistry registry;
+        Counter& counter = registry.counter("hits");
+        Histogram& histogram = registry.histogram("latency");
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 10000; ++i) {
+                    counter.add();
+                    histogram.record(static_cast<uint64_t>(i));
+                }
+            });
+        }
+        for (std::thread& t : threads) t.join();
+        expect(counter.value() == 80000, "sharded counter total");
+        expect(histogram.count() == 80000, "concurrent histogram count");
+        expect(&registry.counter("hits") == &counter, "lookup returns the same metric");
+    }
+
+    // Snapshot and periodic dump
+    {
+        MetricsRegistry registry;
+        registry.counter("requests").add(3);
+        registry.gauge("depth").set(2.5);
+        std::atomic<int> sampled{7};
+        registry.gauge("sampled", [&sampled] { return double(sampled.load()); });
+        registry.histogram("stage").record(2000);
+        std::string json = registry.snapshot();
+        expect(contains(json, "\"counters\":{\"requests\":3}"), "counter in snapshot");
+        expect(contains(json, "\"depth\":2.5") && contains(json, "\"sampled\":7"), "gauges in snapshot");
+        expect(contains(json, "\"stage\":{\"count\":1,") && contains(json, "\"p99_us\":2"), "histogram in snapshot");
+
+        const std::string path = "metrics_test.json";
+        std::remove(path.c_str());
+        registry.startDump(path, std::chrono::milliseconds(10));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sampled = 9;
+        registry.stopDump();
+        std::ifstream in(path);
+        std::stringstream dumped;
+        dumped << in.rdbuf();
+        expect(contains(dumped.str(), "\"sampled\":9"), "final dump on stop");
+        std::remove(path.c_str());
+    }
+
+    // The Scheduler records queue wait and execution time per lane
+    {
+        MetricsRegistry registry;
+        {
+            SchedulerOptions options;
+            options.computeThreads = 1;
+            options.metrics = &registry;
+            Scheduler scheduler(options);
+            for (int i = 0; i < 5; ++i) {
+                Task task;
+                task.work = [](const Tensor&) { std::this_thread::sleep_for(std::chrono::milliseconds(2)); };
+                scheduler.submitTask(task);
+            }
+        }
+        HistogramSummary execute = registry.histogram("scheduler.compute.execute").summary();
+        expect(execute.count == 5 && execute.min >= 2000000, "execute time per task");
+        HistogramSummary wait = registry.histogram("scheduler.compute.queue_wait").summary();
+        expect(wait.count == 5 && wait.max >= 6000000, "queued tasks waited behind the running ones");
+    }
+
+    if (failures) return 1;
+    std::cout << "Metrics tests passed\n";
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "MicroBatcher.h"
+#include "Scheduler.h"
+#include "TestUtil.h"
+
+namespace {
+
+Tensor filled(const std::vector<size_t>& shape, float value) {
+    Tensor t(shape);
+    for (size_t i = 0; i < t.size(); ++i) t[i] = value;
+    return t;
+}
+
+// Records the leading-axis size of every batch it runs and doubles it
+struct Recorder {
+    std::mutex mutex;
+    std::vector<size_t> batchRows;
+
+    MicroBatcher::BatchWork work() {
+        return [this](const Tensor& batch, const std::vector<size_t>& rows) {
+            size_t total = 0;
+            for (size_t r : rows) total += r;
+            std::lock_guard<std::mutex> lock(mutex);
+            batchRows.push_back(total == batch.getShape()[0] ? total : 0);
+            return batch.scale(2.0f);
+        };
+    }
+};
+
+} // namespace
+
+int main() {
+    Scheduler scheduler(2);
+
+    // Requests fill batches up to maxBatchRows; the remainder goes out once
+    // the oldest has waited maxWait. Each gets its own rows back.
+    {
+        Recorder recorder;
+        BatchOptions options;
+        options.maxBatchRows = 4;
+        options.maxWait = std::chrono::milliseconds(50);
+        MicroBatcher batcher(scheduler, recorder.work(), options);
+
+        std::vector<std::future<Tensor>> results;
+        for (int i = 0; i < 10; ++i) results.push_back(batcher.submit(filled({1, 8}, static_cast<float>(i))));
+        bool correct = true;
+        for (int i = 0; i < 10; ++i) {
+            Tensor out = results[i].get();
+            correct = correct && out.getShape() == std::vector<size_t>({1, 8}) && out[0] == 2.0f * i && out[7] == 2.0f * i;
+        }
+        expect(correct, "every request gets its own rows of the result");
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        expect(recorder.batchRows.size() == 3, "ten requests run as three batches");
+        size_t full = 0, rest = 0;
+        for (size_t rows : recorder.batchRows) (rows == 4 ? full : rest) += 1;
+        expect(full == 2 && rest == 1, "two full batches and a timed-out remainder");
+        expect(batcher.stats().requests == 10 && batcher.stats().batches == 3, "stats count requests and batches");
+    }
+
+    // Only requests with the same dtype and trailing shape share a batch;
+    // requests of several rows keep them together
+    {
+        Recorder recorder;
+        BatchOptions options;
+        options.maxBatchRows = 100;
+        options.maxWait = std::chrono::milliseconds(20);
+        MicroBatcher batcher(scheduler, recorder.work(), options);
+        auto a = batcher.submit(filled({3, 4}, 1.0f));
+        auto b = batcher.submit(filled({2, 5}, 2.0f));
+        auto c = batcher.submit(filled({2, 4}, 3.0f));
+        auto d = batcher.submit(filled({2, 4}, 4.0f).cast(DType::FLOAT16));
+        Tensor ra = a.get(), rb = b.get(), rc = c.get(), rd = d.get();
+        expect(ra.getShape() == std::vector<size_t>({3, 4}) && ra[11] == 2.0f, "multi-row request");
+        expect(rb.getShape() == std::vector<size_t>({2, 5}) && rb[0] == 4.0f, "other trailing shape");
+        expect(rc.getShape() == std::vector<size_t>({2, 4}) && rc[0] == 6.0f, "second request of a batch");
+        expect(rd.dtype() == DType::FLOAT16 && rd.cast(DType::FLOAT32)[0] == 8.0f, "other dtype");
+        expect(batcher.stats().batches == 3, "shapes and dtypes batch separately");
+    }
+
+    // Rank-0 requests batch as one row and get a scalar back; a request
+    // that would take a batch past maxBatchRows starts the next one
+    {
+        Recorder recorder;
+        BatchOptions options;
+        options.maxBatchRows = 4;
+        options.maxWait = std::chrono::milliseconds(20);
+        MicroBatcher batcher(scheduler, recorder.work(), options);
+        auto scalar = batcher.submit(filled({}, 5.0f));
+        auto vector = batcher.submit(filled({2}, 1.0f));
+        auto overflow = batcher.submit(filled({3}, 3.0f));
+        Tensor rs = scalar.get(), rv = vector.get(), ro = overflow.get();
+        expect(rs.getShape().empty() && rs[0] == 10.0f, "scalar request gets a scalar");
+        expect(rv.getShape() == std::vector<size_t>({2}) && rv[1] == 2.0f, "1-D request batched with a scalar");
+        expect(ro.getShape() == std::vector<size_t>({3}) && ro[2] == 6.0f, "overflowing request");
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        expect(recorder.batchRows == std::vector<size_t>({3, 3}), "batches stay within maxBatchRows");
+    }
+
+    // A lone request waits no longer than maxWait (plus scheduling slack)
+    {
+        Recorder recorder;
+        BatchOptions options;
+        options.maxWait = std::chrono::milliseconds(5);
+        MicroBatcher batcher(scheduler, recorder.work(), options);
+        auto start = std::chrono::steady_clock::now();
+        Tensor out = batcher.submit(filled({4}, 1.0f)).get();
+        auto waited = std::chrono::steady_clock::now() - start;
+        expect(out.size() == 4 && out[3] == 2.0f, "lone request result");
+        expect(waited < std::chrono::milliseconds(500), "lone request dispatched after maxWait");
+    }
+
+    // Failing work, or a result of the wrong size, fails every request in
+    // the batch
+    {
+        BatchOptions options;
+        options.maxBatchRows = 2;
+        MicroBatcher throwing(scheduler, [](const Tensor&, const std::vector<size_t>&) -> Tensor {
+            throw std::runtime_error("model failed");
+        }, options);
+        auto x = throwing.submit(filled({1}, 1.0f));
+        auto y = throwing.submit(filled({1}, 1.0f));
+        int failed = 0;
+        for (auto* f : {&x, &y}) {
+            try {
+                f->get();
+            } catch (const std::runtime_error&) {
+                ++failed;
+            }
+        }
+        expect(failed == 2, "work exception reaches every request");
+
+        MicroBatcher shrinking(scheduler, [](const Tensor&, const std::vector<size_t>&) { return Tensor({1}); },
+                               options);
+        auto z = shrinking.submit(filled({2}, 1.0f));
+        bool rejected = false;
+        try {
+            z.get();
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        expect(rejected, "result without one row per input row is rejected");
+    }
+
+    // Destroying the batcher dispatches what is still waiting
+    {
+        Recorder recorder;
+        BatchOptions options;
+        options.maxWait = std::chrono::seconds(60);
+        std::future<Tensor> pending;
+        {
+            MicroBatcher batcher(scheduler, recorder.work(), options);
+            pending = batcher.submit(filled({2}, 5.0f));
+        }
+        expect(pending.wait_for(std::chrono::seconds(5)) == std::future_status::ready && pending.get()[1] == 10.0f,
+               "pending batch dispatched on destruction");
+    }
+
+    if (failures) return 1;
+    std::cout << "MicroBatcher tests passed\n";
+    return 0;
+}
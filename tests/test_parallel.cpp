@@ -0,0 +1,120 @@
+#include <iostream>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Tensor.h"
+#include "ThreadPool.h"
+#include "TestUtil.h"
+
+namespace {
+
+bool equal(const Tensor& a, const Tensor& b) {
+    if (a.getShape() != b.getShape() || a.dtype() != b.dtype()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    ThreadPool pool(4);
+    ThreadPool stealing(3, PoolMode::WORK_STEALING);
+
+    // Chunks cover the range exactly once, never below the grain
+    {
+        std::vector<std::atomic<int>> hits(100003);
+        std::atomic<size_t> smallest{~size_t(0)};
+        std::atomic<int> chunks{0};
+        pool.parallel_for(3, hits.size(), 1000, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) ++hits[i];
+            if (end != hits.size()) {
+                size_t seen = smallest.load();
+                while (end - begin < seen && !smallest.compare_exchange_weak(seen, end - begin)) {
+                }
+            }
+            ++chunks;
+        });
+        bool once = hits[0] == 0 && hits[2] == 0;
+        for (size_t i = 3; i < hits.size(); ++i) once = once && hits[i] == 1;
+        expect(once, "every index visited once");
+        expect(smallest >= 1000 && chunks <= int(ThreadPool::MAX_CHUNKS), "grain and chunk count respected");
+
+        int calls = 0;
+        pool.parallel_for(5, 5, 1, [&](size_t, size_t) { ++calls; });
+        expect(calls == 0, "empty range runs nothing");
+    }
+
+    // Exceptions reach the caller after the loop finishes
+    {
+        bool caught = false;
+        try {
+            pool.parallel_for(0, 1000, 1, [](size_t begin, size_t) {
+                if (begin == 500) throw std::runtime_error("chunk failed");
+            });
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        expect(caught, "exception rethrown");
+    }
+
+    // Nested from inside a worker: the caller claims chunks, so a pool whose
+    // workers are all busy still completes
+    {
+        std::vector<std::future<long>> outer;
+        for (int i = 0; i < 8; ++i) {
+            outer.push_back(stealing.submit([&stealing] {
+                return stealing.parallel_reduce(size_t(0), size_t(10000), 10, 0L,
+                                                [](size_t b, size_t e) {
+                                                    long s = 0;
+                                                    for (size_t k = b; k < e; ++k) s += long(k);
+                                                    return s;
+                                                },
+                                                [](long x, long y) { return x + y; });
+            }));
+        }
+        bool right = true;
+        for (auto& f : outer) right = right && f.get() == 49995000L;
+        expect(right, "nested parallel_reduce inside workers");
+    }
+
+    // Float reductions are identical whatever the pool size
+    {
+        Tensor t({1 << 20});
+        for (size_t i = 0; i < t.size(); ++i) t[i] = std::sin(static_cast<float>(i)) * 1000.0f;
+        ThreadPool none(0), two(2);
+        const float s = t.sum(&pool);
+        expect(s == t.sum(&none) && s == t.sum(&two) && s == t.sum(&stealing), "sum deterministic across pools");
+        bool repeatable = true;
+        for (int i = 0; i < 10; ++i) repeatable = repeatable && t.sum(&pool) == s;
+        expect(repeatable, "sum deterministic across runs");
+        expect(std::fabs(s - t.sum()) <= 1e-3f * std::fabs(t.sum()) + 1.0f, "parallel sum matches serial");
+        expect(t.max(&pool) == t.max() && t.dot(t, &two) == t.dot(t, &pool), "max and dot");
+    }
+
+    // Elementwise ops match the serial result, including views and other
+    // dtypes that go through the gather path
+    {
+        Tensor x({512, 300});
+        for (size_t i = 0; i < x.size(); ++i) x[i] = static_cast<float>(i % 97) - 48.0f;
+        Tensor bias({300});
+        for (size_t i = 0; i < bias.size(); ++i) bias[i] = 0.5f * static_cast<float>(i);
+        expect(equal(x.scale(2.0f, &pool), x.scale(2.0f)), "scale");
+        expect(equal(x.add(bias, &pool), x.add(bias)), "add with broadcast");
+        expect(equal(x.fma(x, bias, &pool), x.fma(x, bias)), "fma");
+        expect(equal(x.relu(&pool), x.relu()) && equal(x.gelu(&pool), x.gelu()), "relu and gelu");
+        const Tensor xt = x.transpose(0, 1);
+        expect(equal(xt.mul(xt, &pool), xt.mul(xt)), "mul over a view");
+        const Tensor half = x.cast(DType::FLOAT16);
+        expect(equal(half.scale(0.5f, &pool).cast(DType::FLOAT32), half.scale(0.5f).cast(DType::FLOAT32)), "float16");
+        expect(x.slice(0, 0, 1).scale(3.0f, &pool)[299] == x[299] * 3.0f, "small tensors run inline");
+    }
+
+    if (failures) return 1;
+    std::cout << "Parallel tests passed\n";
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "PeerPool.h"
+#include "Reactor.h"
+#include "TestUtil.h"
+
+namespace {
+
+// A receiving peer: counts connections and the floats it was sent
+struct Receiver {
+    int listenFd = -1;
+    int port = 0;
+    std::atomic<int> connections{0};
+    std::atomic<int> frames{0};
+    std::atomic<float> lastSum{0.0f};
+    std::atomic<int> lastDtype{0};
+    std::unique_ptr<Reactor> reactor;
+
+    bool start(int wantPort) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(wantPort);
+        socklen_t len = sizeof(addr);
+        if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 64) < 0 ||
+            getsockname(listenFd, (sockaddr*)&addr, &len) < 0) {
+            return false;
+        }
+        port = ntohs(addr.sin_port);
+        reactor.reset(new Reactor(
+            ServerOptions(),
+            [this](int, std::shared_ptr<std::vector<char>> payload) {
+                lastSum = Tensor::deserializeBinary(*payload).sum();
+                lastDtype = (*payload)[5];
+                ++frames;
+            },
+            [this](int, bool open) { if (open) ++connections; }));
+        return reactor->start(listenFd);
+    }
+
+    void stop() {
+        reactor.reset();
+        close(listenFd);
+    }
+};
+
+} // namespace
+
+int main() {
+    if (!Reactor::supported()) {
+        std::cout << "Reactor not supported on this platform, skipping\n";
+        return 0;
+    }
+
+    Receiver peers[3];
+    std::vector<int> ports;
+    for (Receiver& r : peers) {
+        if (!r.start(0)) {
+            std::cerr << "could not start receiver\n";
+            return 1;
+        }
+        ports.push_back(r.port);
+    }
+
+    PeerOptions options;
+    options.initialBackoff = std::chrono::milliseconds(50);
+    PeerPool pool(options);
+
+    // Repeated broadcasts reuse one connection per peer
+    Tensor t({64, 1024});
+    for (size_t i = 0; i < t.size(); ++i) t[i] = 1.0f;
+    const int rounds = 20;
+    for (int i = 0; i < rounds; ++i) {
+        expect(pool.broadcast(encodeWireHeader(t), t, ports).empty(), "broadcast reaches every peer");
+    }
+    for (Receiver& r : peers) {
+        expect(waitFor([&] { return r.frames == rounds; }), "every frame delivered");
+        expect(r.connections == 1, "connection reused across broadcasts");
+        expect(r.lastSum == 65536.0f, "payload intact");
+    }
+    expect(pool.connectedCount() == 3, "one open connection per peer");
+
+    // Tensors over the threshold are streamed in chunks; receivers see the
+    // same tensor
+    {
+        PeerOptions streaming;
+        streaming.streamThresholdBytes = 1;
+        streaming.streamChunkBytes = 4096;
+        PeerPool streamPool(streaming);
+        expect(streamPool.broadcast(encodeWireHeader(t), t, ports).empty(), "streamed broadcast reaches every peer");
+        for (Receiver& r : peers) {
+            expect(waitFor([&] { return r.frames == rounds + 1; }), "streamed frame delivered");
+            expect(r.lastSum == 65536.0f, "streamed payload intact");
+        }
+    }
+    for (Receiver& r : peers) r.frames -= 1;
+
+    // The encoding comes from the call unless a peer has its own; plain and
+    // streamed frames both carry it
+    for (int streamed = 0; streamed < 2; ++streamed) {
+        PeerOptions encodedOptions;
+        encodedOptions.streamThresholdBytes = streamed ? 1 : 0;
+        encodedOptions.streamChunkBytes = 1000;
+        PeerPool encodedPool(encodedOptions);
+        encodedPool.setEncoding(ports[1], WireEncoding::BFLOAT16);
+        expect(encodedPool.broadcast(encodeWireHeader(t, WireEncoding::FLOAT16), t, ports).empty(),
+               "encoded broadcast reaches every peer");
+        for (Receiver& r : peers) {
+            expect(waitFor([&] { return r.frames == rounds + 1; }), "encoded frame delivered");
+            expect(r.lastSum == 65536.0f, "encoded payload decodes");
+            r.frames -= 1;
+        }
+        expect(peers[0].lastDtype == int(WireEncoding::FLOAT16), "call encoding used");
+        expect(peers[1].lastDtype == int(WireEncoding::BFLOAT16), "peer encoding overrides the call");
+    }
+
+    // Duplicate ports are sent to once
+    expect(pool.broadcast(encodeWireHeader(t), t, {ports[0], ports[0]}).empty(), "duplicate port accepted");
+    expect(waitFor([&] { return peers[0].frames == rounds + 1; }), "duplicate port sent once");
+
+    // A peer that stops reading is given up on once it has taken nothing
+    // for the stall timeout; the pool keeps serving the others
+    {
+        int silentFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        bool listening = bind(silentFd, (sockaddr*)&addr, sizeof(addr)) == 0 && listen(silentFd, 4) == 0 &&
+                         getsockname(silentFd, (sockaddr*)&addr, &len) == 0;
+        expect(listening, "silent peer listens");
+        int silentPort = ntohs(addr.sin_port);
+
+        PeerOptions bounded;
+        bounded.sendBufferBytes = 64 << 10;
+        bounded.stallTimeout = std::chrono::milliseconds(200);
+        PeerPool boundedPool(bounded);
+        Tensor big({size_t(16) << 20});
+        auto start = std::chrono::steady_clock::now();
+        std::vector<int> stuck = boundedPool.broadcast(encodeWireHeader(big), big, {silentPort});
+        auto took = std::chrono::steady_clock::now() - start;
+        expect(stuck.size() == 1 && stuck[0] == silentPort, "stalled peer reported");
+        expect(took < std::chrono::seconds(5), "broadcast bounded by the stall timeout");
+        expect(boundedPool.connectedCount() == 0, "stalled peer's connection dropped");
+
+        int before = peers[0].frames;
+        stuck = boundedPool.broadcast(encodeWireHeader(t), t, {silentPort, ports[0]});
+        expect(stuck.size() == 1 && stuck[0] == silentPort, "stalled peer backed off");
+        expect(waitFor([&] { return peers[0].frames == before + 1; }), "healthy peer still served");
+        close(silentFd);
+    }
+
+    // A peer that goes away is reported, then backed off
+    int downPort = peers[2].port;
+    peers[2].stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<int> failed = pool.broadcast(encodeWireHeader(t), t, ports);
+    expect(failed.size() == 1 && failed[0] == downPort, "closed peer reported");
+    expect(pool.connectedCount() == 2, "closed peer's connection dropped");
+    failed = pool.broadcast(encodeWireHeader(t), t, {downPort});
+    expect(failed.size() == 1, "peer in backoff is skipped");
+
+    // Once it is back and the backoff has passed, the pool reconnects
+    Receiver restarted;
+    expect(restarted.start(downPort), "peer restarts on the same port");
+    bool delivered = waitFor([&] { return pool.broadcast(encodeWireHeader(t), t, {downPort}).empty(); });
+    expect(delivered, "reconnects after backoff");
+    expect(waitFor([&] { return restarted.frames >= 1; }), "frame reaches restarted peer");
+
+    restarted.stop();
+    for (int i = 0; i < 2; ++i) peers[i].stop();
+
+    if (failures) return 1;
+    std::cout << "PeerPool tests passed\n";
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Reactor.h"
+#include "TensorWire.h"
+#include "TestUtil.h"
+
+namespace {
+
+int listenOnEphemeralPort(int& port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (sock < 0 || bind(sock, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 1024) < 0 ||
+        getsockname(sock, (sockaddr*)&addr, &len) < 0) {
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return sock;
+}
+
+int connectTo(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+} // namespace
+
+int main() {
+    if (!Reactor::supported()) {
+        std::cout << "Reactor not supported on this platform, skipping\n";
+        return 0;
+    }
+
+    int port = 0;
+    int listenFd = listenOnEphemeralPort(port);
+    if (listenFd < 0) {
+        std::cerr << "could not open listening socket\n";
+        return 1;
+    }
+
+    std::mutex mutex;
+    std::multiset<std::string> frames;
+    std::atomic<int> opened{0}, closed{0};
+
+    ServerOptions options;
+    options.ioThreads = 2;
+    options.maxFrameBytes = 1 << 20;
+    Reactor reactor(
+        options,
+        [&](int, std::shared_ptr<std::vector<char>> payload) {
+            std::lock_guard<std::mutex> lock(mutex);
+            frames.insert(std::string(payload->begin(), payload->end()));
+        },
+        [&](int, bool open) { ++(open ? opened : closed); });
+    expect(reactor.start(listenFd), "reactor starts");
+
+    // Many concurrent connections, each sending several frames
+    const int clients = 200;
+    const int perClient = 3;
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([c, port] {
+            int sock = connectTo(port);
+            if (sock < 0) return;
+            for (int f = 0; f < perClient; ++f) {
+                std::string msg = "client" + std::to_string(c) + "-frame" + std::to_string(f);
+                sendFrame(sock, msg.data(), msg.size());
+            }
+            close(sock);
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    expect(waitFor([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return frames.size() == size_t(clients * perClient);
+    }), "every frame from every client arrives");
+    expect(frames.count("client17-frame2") == 1, "frame payload intact");
+    expect(waitFor([&] { return closed == clients; }) && opened == clients, "connections tracked and reclaimed");
+
+    // A frame dribbled in one byte at a time, including an empty frame
+    {
+        int sock = connectTo(port);
+        char prefix[8];
+        encodeLengthPrefix(5, prefix);
+        std::string wire(prefix, 8);
+        wire += "slow!";
+        encodeLengthPrefix(0, prefix);
+        wire.append(prefix, 8);
+        for (char ch : wire) {
+            sendAll(sock, &ch, 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        expect(waitFor([&] {
+            std::lock_guard<std::mutex> lock(mutex);
+            return frames.count("slow!") == 1 && frames.count("") == 1;
+        }), "partial reads are reassembled");
+        close(sock);
+        expect(waitFor([&] { return closed == clients + 1; }), "slow connection reclaimed");
+    }
+
+    // Streamed tensors arrive as one contiguous TENS payload
+    {
+        Tensor t({1000});
+        for (size_t i = 0; i < t.size(); ++i) t[i] = static_cast<float>(i);
+        std::vector<char> bytes = t.serializeBinary();
+        const std::string expected(bytes.begin(), bytes.end());
+        int sock = connectTo(port);
+        sendTensorStream(sock, t, 256);
+        expect(waitFor([&] {
+            std::lock_guard<std::mutex> lock(mutex);
+            return frames.count(expected) == 1;
+        }), "streamed tensor reassembled");
+        close(sock);
+        expect(waitFor([&] { return closed == clients + 2; }), "stream connection reclaimed");
+    }
+
+    // Oversized frames close the connection without allocating
+    {
+        int before = closed;
+        int streamSock = connectTo(port);
+        sendTensorStream(streamSock, Tensor({size_t(1) << 20}), 1 << 16); // 4 MiB > limit
+        char streamByte;
+        expect(read(streamSock, &streamByte, 1) <= 0, "oversized stream closes the connection");
+        close(streamSock);
+        expect(waitFor([&] { return closed == before + 1; }), "oversized stream reclaimed");
+        before = closed;
+
+        int sock = connectTo(port);
+        char prefix[8];
+        encodeLengthPrefix(uint64_t(1) << 40, prefix);
+        sendAll(sock, prefix, sizeof(prefix));
+        char byte;
+        expect(read(sock, &byte, 1) == 0, "oversized frame closes the connection");
+        expect(waitFor([&] { return closed == before + 1; }), "oversized connection reclaimed");
+        close(sock);
+    }
+
+    // stop() returns promptly even with an idle connection open
+    int idle = connectTo(port);
+    expect(waitFor([&] { return opened == clients + 5; }), "idle connection accepted");
+    auto start = std::chrono::steady_clock::now();
+    reactor.stop();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    expect(elapsed < std::chrono::seconds(1), "stop wakes the event loops");
+    char byte;
+    expect(read(idle, &byte, 1) == 0, "stop closes open connections");
+    close(idle);
+    close(listenFd);
+
+    // Frame buffers follow the bytes received, not the announced length,
+    // and all connections share one cap
+    {
+        int bufferedPort = 0;
+        int bufferedFd = listenOnEphemeralPort(bufferedPort);
+        ServerOptions capped;
+        capped.maxFrameBytes = 64 << 20;
+        capped.maxBufferedBytes = 4 << 20;
+        std::atomic<int> delivered{0}, dropped{0};
+        Reactor bounded(
+            capped, [&](int, std::shared_ptr<std::vector<char>>) { ++delivered; },
+            [&](int, bool open) { if (!open) ++dropped; });
+        expect(bounded.start(bufferedFd), "capped reactor starts");
+
+        char prefix[8];
+        encodeLengthPrefix(32 << 20, prefix);
+        std::vector<int> announced;
+        for (int i = 0; i < 16; ++i) {
+            int sock = connectTo(bufferedPort);
+            sendAll(sock, prefix, sizeof(prefix));
+            sendAll(sock, "partial", 7);
+            announced.push_back(sock);
+        }
+        // Streamed tensors, too, grow with their chunks rather than the
+        // size in their header
+        WireHeader streamHeader = encodeWireHeader(Tensor({size_t(8) << 20}));
+        encodeLengthPrefix(STREAM_FLAG | (streamHeader.size - 8), streamHeader.bytes);
+        for (int i = 0; i < 4; ++i) {
+            int sock = connectTo(bufferedPort);
+            sendAll(sock, streamHeader.bytes, streamHeader.size);
+            announced.push_back(sock);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        expect(dropped == 0, "announced lengths are not allocated up front");
+
+        int greedy = connectTo(bufferedPort);
+        sendAll(greedy, prefix, sizeof(prefix));
+        std::vector<char> filler(1 << 20);
+        for (int i = 0; i < 8 && dropped == 0; ++i) sendAll(greedy, filler.data(), filler.size());
+        expect(waitFor([&] { return dropped == 1; }), "connection over the shared cap closed");
+        close(greedy);
+        for (int sock : announced) close(sock);
+        expect(waitFor([&] { return dropped == 21; }), "partial frames reclaimed");
+
+        // Their buffers were released, so a frame near the cap still fits
+        int sock = connectTo(bufferedPort);
+        std::vector<char> frame(3 << 20, 'x');
+        sendFrame(sock, frame.data(), frame.size());
+        expect(waitFor([&] { return delivered == 1; }), "cap released after close");
+        close(sock);
+        bounded.stop();
+        close(bufferedFd);
+    }
+
+    if (failures) return 1;
+    std::cout << "Reactor tests passed\n";
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Scheduler.h"
+#include "TestUtil.h"
+
+namespace {
+
+Task makeTask(TaskType type, std::function<void()> body, TaskPriority priority = TaskPriority::NORMAL) {
+    Task task;
+    task.type = type;
+    task.name = "test";
+    task.priority = priority;
+    task.work = [body](const Tensor&) { body(); };
+    return task;
+}
+
+// Occupies a lane's only worker until open() is called
+struct Gate {
+    std::promise<void> release;
+    std::shared_future<void> opened = release.get_future().share();
+    std::promise<void> started;
+
+    Task task(TaskType type) {
+        std::shared_future<void> wait = opened;
+        auto running = std::make_shared<std::promise<void>>(std::move(started));
+        return makeTask(type, [wait, running] {
+            running->set_value();
+            wait.wait();
+        });
+    }
+    void open() { release.set_value(); }
+};
+
+SchedulerOptions singleThreaded() {
+    SchedulerOptions options;
+    options.computeThreads = 1;
+    options.ioThreads = 1;
+    return options;
+}
+
+} // namespace
+
+int main() {
+    // Blocking IO does not hold up compute
+    {
+        Scheduler scheduler(singleThreaded());
+        Gate disk;
+        std::future<void> diskStarted = disk.started.get_future();
+        expect(scheduler.submitTask(disk.task(TaskType::IO)), "io task accepted");
+        diskStarted.wait();
+        std::atomic<bool> computed{false};
+        scheduler.submitTask(makeTask(TaskType::COMPUTE, [&computed] { computed = true; }));
+        expect(waitFor([&] { return computed.load(); }), "compute runs while io is blocked");
+        disk.open();
+    }
+
+    // Priority, then earliest deadline, then submission order
+    {
+        Scheduler scheduler(singleThreaded());
+        Gate gate;
+        std::future<void> started = gate.started.get_future();
+        scheduler.submitTask(gate.task(TaskType::COMPUTE));
+        started.wait();
+
+        std::mutex mutex;
+        std::string order;
+        auto record = [&](char c) {
+            return [&mutex, &order, c] {
+                std::lock_guard<std::mutex> lock(mutex);
+                order += c;
+            };
+        };
+        const auto now = std::chrono::steady_clock::now();
+        scheduler.submitTask(makeTask(TaskType::COMPUTE, record('l'), TaskPriority::LOW));
+        scheduler.submitTask(makeTask(TaskType::COMPUTE, record('a'), TaskPriority::NORMAL));
+        scheduler.submitTask(makeTask(TaskType::COMPUTE, record('b'), TaskPriority::NORMAL));
+        Task soon = makeTask(TaskType::COMPUTE, record('d'), TaskPriority::NORMAL);
+        soon.deadline = now + std::chrono::seconds(60);
+        scheduler.submitTask(soon);
+        scheduler.submitTask(makeTask(TaskType::COMPUTE, record('h'), TaskPriority::HIGH));
+        scheduler.submitTask(makeTask(TaskType::COMPUTE, record('i'), TaskPriority::INTERACTIVE));
+        gate.open();
+        expect(waitFor([&] {
+                   std::lock_guard<std::mutex> lock(mutex);
+                   return order.size() == 6;
+               }), "every task ran");
+        std::lock_guard<std::mutex> lock(mutex);
+        expect(order == "ihdabl", "priority, deadline and FIFO order");
+    }
+
+    // A task whose deadline passes in the queue is dropped
+    {
+        Scheduler scheduler(singleThreaded());
+        Gate gate;
+        std::future<void> started = gate.started.get_future();
+        scheduler.submitTask(gate.task(TaskType::COMPUTE));
+        started.wait();
+
+        std::atomic<bool> ran{false}, dropped{false};
+        Task late = makeTask(TaskType::COMPUTE, [&ran] { ran = true; });
+        late.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        late.onExpired = [&dropped] { dropped = true; };
+        scheduler.submitTask(late);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        gate.open();
+        expect(waitFor([&] { return dropped.load(); }) && !ran, "expired task dropped");
+        expect(waitFor([&] { return scheduler.stats(TaskType::COMPUTE).expired == 1; }), "expiry counted");
+    }
+
+    // Expired tasks are reported before anything else, whatever their
+    // priority, and give their slot back to a full lane
+    {
+        SchedulerOptions options = singleThreaded();
+        options.maxQueuedCompute = 2;
+        Scheduler scheduler(options);
+        Gate gate;
+        std::future<void> started = gate.started.get_future();
+        scheduler.submitTask(gate.task(TaskType::COMPUTE));
+        started.wait();
+
+        std::mutex orderMutex;
+        std::string order;
+        auto record = [&orderMutex, &order](char c) {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order += c;
+        };
+        Task low = makeTask(TaskType::COMPUTE, [&record] { record('l'); }, TaskPriority::LOW);
+        low.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        low.onExpired = [&record] { record('x'); };
+        expect(scheduler.submitTask(low), "expiring task queued");
+        expect(scheduler.submitTask(makeTask(TaskType::COMPUTE, [&record] { record('h'); }, TaskPriority::HIGH)),
+               "second task queued");
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        expect(scheduler.submitTask(makeTask(TaskType::COMPUTE, [&record] { record('h'); }, TaskPriority::HIGH)),
+               "expired task frees its slot");
+        gate.open();
+        scheduler.drain();
+        expect(order == "xhh", "expired task reported first");
+        SchedulerStats stats = scheduler.stats(TaskType::COMPUTE);
+        expect(stats.expired == 1 && stats.rejected == 0 && stats.completed == 3, "purge counted");
+    }
+    {
+        SchedulerOptions options = singleThreaded();
+        options.maxQueuedCompute = 1;
+        options.blockWhenFull = true;
+        Scheduler scheduler(options);
+        Gate gate;
+        std::future<void> started = gate.started.get_future();
+        scheduler.submitTask(gate.task(TaskType::COMPUTE));
+        started.wait();
+        Task late = makeTask(TaskType::COMPUTE, [] {});
+        late.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+        scheduler.submitTask(late);
+
+        std::atomic<bool> submitted{false};
+        std::thread producer([&] { submitted = scheduler.submitTask(makeTask(TaskType::COMPUTE, [] {})); });
+        expect(waitFor([&] { return submitted.load(); }), "blocked submit takes an expired task's slot");
+        gate.open();
+        producer.join();
+    }
+
+    // Full lanes reject, or block the submitter until there is room
+    {
+        SchedulerOptions options = singleThreaded();
+        options.maxQueuedIo = 2;
+        Scheduler scheduler(options);
+        Gate gate;
+        std::future<void> started = gate.started.get_future();
+        scheduler.submitTask(gate.task(TaskType::IO));
+        started.wait();
+        expect(scheduler.submitTask(makeTask(TaskType::IO, [] {})), "first queued");
+        expect(scheduler.submitTask(makeTask(TaskType::IO, [] {})), "second queued");
+        expect(!scheduler.submitTask(makeTask(TaskType::IO, [] {})), "full lane rejects");
+        expect(scheduler.submitTask(makeTask(TaskType::COMPUTE, [] {})), "other lane unaffected");
+        SchedulerStats stats = scheduler.stats(TaskType::IO);
+        expect(stats.rejected == 1 && stats.queued == 2, "rejection counted");
+        gate.open();
+    }
+    {
+        SchedulerOptions options = singleThreaded();
+        options.maxQueuedCompute = 1;
+        options.blockWhenFull = true;
+        Scheduler scheduler(options);
+        Gate gate;
+        std::future<void> started = gate.started.get_future();
+        scheduler.submitTask(gate.task(TaskType::COMPUTE));
+        started.wait();
+        scheduler.submitTask(makeTask(TaskType::COMPUTE, [] {}));
+
+        std::atomic<bool> submitted{false};
+        std::thread producer([&] { submitted = scheduler.submitTask(makeTask(TaskType::COMPUTE, [] {})); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        expect(!submitted, "submitter waits for room");
+        gate.open();
+        producer.join();
+        expect(submitted, "blocked submit accepted once there is room");
+    }
+
+    // Shutdown runs what is still queued
+    {
+        std::atomic<int> ran{0};
+        {
+            Scheduler scheduler(singleThreaded());
+            for (int i = 0; i < 20; ++i) {
+                scheduler.submitTask(makeTask(i % 2 ? TaskType::IO : TaskType::COMPUTE, [&ran] { ++ran; }));
+            }
+        }
+        expect(ran == 20, "queued tasks drained on shutdown");
+    }
+
+    // drain() waits for queued work, including work submitted across lanes
+    {
+        Scheduler scheduler(singleThreaded());
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 10; ++i) {
+            scheduler.submitTask(makeTask(TaskType::COMPUTE, [&scheduler, &ran] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                scheduler.submitTask(makeTask(TaskType::IO, [&ran] {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    ++ran;
+                }));
+                ++ran;
+            }));
+        }
+        scheduler.drain();
+        expect(ran == 20, "drain waits for both lanes");
+        const SchedulerStats io = scheduler.stats(TaskType::IO);
+        expect(io.queued == 0 && io.running == 0, "idle after drain");
+        scheduler.drain();
+        expect(scheduler.submitTask(makeTask(TaskType::IO, [] {})), "submitting works after drain");
+    }
+
+    if (failures) return 1;
+    std::cout << "Scheduler tests passed\n";
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Tensor.h"
+#include "TensorWire.h"
+
+int main() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        std::cerr << "socketpair failed\n";
+        return 1;
+    }
+
+    // Large enough that the sender must block until the reader drains it
+    Tensor big({3, 512, 700});
+    for (size_t i = 0; i < big.size(); ++i) big[i] = static_cast<float>(i % 1000) * 0.5f;
+    Tensor small({2, 3});
+    for (size_t i = 0; i < small.size(); ++i) small[i] = static_cast<float>(i);
+
+    std::thread sender([&] {
+        WireHeader header = encodeWireHeader(big);
+        sendTensor(fds[0], header, big);
+        sendTensor(fds[0], header, big); // header reused for a second copy
+        sendTensor(fds[0], small);
+        sendTensor(fds[0], Tensor({0}));
+    });
+
+    for (int round = 0; round < 2; ++round) {
+        Tensor got = recvTensor(fds[1]);
+        if (got.getShape() != big.getShape() || got.dot(got) != big.dot(big) || got[12345] != big[12345]) {
+            std::cerr << "large tensor did not round-trip\n";
+            return 1;
+        }
+    }
+    Tensor gotSmall = recvTensor(fds[1]);
+    if (gotSmall.getShape() != small.getShape() || gotSmall.sum() != 15.0f) {
+        std::cerr << "small tensor did not round-trip\n";
+        return 1;
+    }
+    if (recvTensor(fds[1]).size() != 0) {
+        std::cerr << "empty tensor did not round-trip\n";
+        return 1;
+    }
+    sender.join();
+
+    // serializeBinary/deserializeBinary stay byte-compatible with the wire payload
+    std::vector<char> bytes = small.serializeBinary();
+    WireHeader header = encodeWireHeader(small);
+    if (header.payloadSize != bytes.size()) {
+        std::cerr << "wire payload size differs from serializeBinary\n";
+        return 1;
+    }
+
+    // A length prefix that disagrees with the header is rejected before
+    // anything is allocated for the payload
+    char bogus[8];
+    encodeLengthPrefix(bytes.size() + (1u << 30), bogus);
+    sendAll(fds[0], bogus, sizeof(bogus));
+    sendAll(fds[0], bytes.data(), bytes.size());
+    bool rejected = false;
+    try {
+        recvTensor(fds[1]);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    if (!rejected) {
+        std::cerr << "mismatched frame length was accepted\n";
+        return 1;
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+
+    // Streamed frames: chunks land in place and are visible to the sink in
+    // order while the sender is still writing
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        std::cerr << "socketpair failed\n";
+        return 1;
+    }
+    double bigSum = 0.0;
+    for (size_t i = 0; i < big.size(); ++i) bigSum += big[i];
+    std::thread streamer([&] {
+        sendTensorStream(fds[0], big, 64 * 1024);
+        sendTensorStream(fds[0], big, 100 * 1024 + 4); // last chunk is short
+        sendTensorStream(fds[0], Tensor({0}));
+        sendTensor(fds[0], small); // plain and streamed frames mix freely
+        sendTensorStream(fds[0], big, 64 * 1024);
+    });
+
+    uint64_t expectOffset = 0;
+    size_t chunks = 0;
+    double inFlightSum = 0.0;
+    Tensor streamed = recvTensor(fds[1], DEFAULT_MAX_TENSOR_BYTES, [&](const Tensor& dest, uint64_t offset, size_t len) {
+        if (offset != expectOffset) throw std::runtime_error("chunk out of order");
+        const float* p = dest.dataPtr() + offset / sizeof(float);
+        for (size_t i = 0; i < len / sizeof(float); ++i) inFlightSum += p[i];
+        expectOffset += len;
+        ++chunks;
+    });
+    if (streamed.getShape() != big.getShape() || streamed[12345] != big[12345] ||
+        chunks != (big.size() * sizeof(float) + 65535) / 65536 || inFlightSum != bigSum) {
+        std::cerr << "streamed tensor did not round-trip\n";
+        return 1;
+    }
+    if (recvTensor(fds[1]).dot(big) != big.dot(big) || recvTensor(fds[1]).size() != 0 ||
+        recvTensor(fds[1]).sum() != 15.0f) {
+        std::cerr << "streamed frames did not interleave with plain ones\n";
+        return 1;
+    }
+
+    // Consuming a stream without materializing the tensor
+    size_t biggestChunk = 0;
+    uint64_t consumed = 0;
+    std::vector<size_t> streamShape;
+    StreamSink sink;
+    DType streamDtype = DType::INT8;
+    sink.onHeader = [&](const std::vector<size_t>& shape, DType dtype) {
+        streamShape = shape;
+        streamDtype = dtype;
+    };
+    sink.onChunk = [&](uint64_t offset, const char*, size_t len) {
+        if (offset == consumed) consumed += len;
+        biggestChunk = std::max(biggestChunk, len);
+    };
+    recvTensorStream(fds[1], sink);
+    streamer.join();
+    if (streamShape != big.getShape() || streamDtype != DType::FLOAT32 || consumed != big.size() * sizeof(float) ||
+        biggestChunk != 64 * 1024) {
+        std::cerr << "bounded stream consumption failed\n";
+        return 1;
+    }
+
+    // Oversized tensors are rejected from the header alone
+    std::thread oversized([&] { sendTensorStream(fds[0], small); });
+    rejected = false;
+    try {
+        recvTensor(fds[1], 16);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    oversized.join();
+    if (!rejected) {
+        std::cerr << "tensor over the size limit was accepted\n";
+        return 1;
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    // Chunks must arrive in order
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return 1;
+    char frame[MAX_WIRE_HEADER];
+    size_t tensHeader = small.writeBinaryHeader(frame + 8);
+    encodeLengthPrefix(STREAM_FLAG | tensHeader, frame);
+    char chunk[CHUNK_HEADER_SIZE];
+    encodeChunkHeader(8, 8, chunk); // skips the first 8 bytes
+    sendAll(fds[0], frame, 8 + tensHeader);
+    sendAll(fds[0], chunk, sizeof(chunk));
+    rejected = false;
+    try {
+        recvTensor(fds[1]);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    if (!rejected) {
+        std::cerr << "out-of-order chunk was accepted\n";
+        return 1;
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    // Reduced-precision encodings: plain and streamed frames decode to the
+    // same float32 values as deserializeBinary, within each encoding's error
+    Tensor wave({10007}); // not a multiple of the int8 block
+    for (size_t i = 0; i < wave.size(); ++i) wave[i] = static_cast<float>(std::sin(i * 0.01) * 100.0);
+    const WireEncoding encodings[] = {WireEncoding::FLOAT16, WireEncoding::BFLOAT16, WireEncoding::QINT8};
+    const float tolerance[] = {0.05f, 0.4f, 0.4f};
+    for (int e = 0; e < 3; ++e) {
+        const WireEncoding encoding = encodings[e];
+        std::vector<char> encoded = wave.serializeBinary(encoding);
+        Tensor reference = Tensor::deserializeBinary(encoded);
+        if (encodeWireHeader(wave, encoding).payloadSize != encoded.size() ||
+            encoded.size() * 2 > wave.serializeBinary().size() + 64) {
+            std::cerr << wireEncodingName(encoding) << " payload size wrong\n";
+            return 1;
+        }
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return 1;
+        std::thread encodedSender([&] {
+            sendTensor(fds[0], wave, encoding);
+            sendTensorStream(fds[0], wave, 1000, encoding);
+            sendTensorStream(fds[0], wave, 1000, encoding);
+        });
+        Tensor plain = recvTensor(fds[1]);
+        uint64_t landed = 0;
+        Tensor streamed = recvTensor(fds[1], DEFAULT_MAX_TENSOR_BYTES,
+                                     [&](const Tensor&, uint64_t offset, size_t len) {
+                                         if (offset == landed) landed += len;
+                                     });
+        std::vector<float> consumedFloats(wave.size());
+        StreamSink floats;
+        floats.onChunk = [&](uint64_t offset, const char* data, size_t len) {
+            std::memcpy(reinterpret_cast<char*>(consumedFloats.data()) + offset, data, len);
+        };
+        recvTensorStream(fds[1], floats);
+        encodedSender.join();
+        close(fds[0]);
+        close(fds[1]);
+
+        float worst = 0.0f;
+        for (size_t i = 0; i < wave.size(); ++i) worst = std::max(worst, std::fabs(plain[i] - wave[i]));
+        const size_t dataBytes = wave.size() * sizeof(float);
+        if (plain.getShape() != wave.getShape() || worst > tolerance[e] ||
+            std::memcmp(plain.dataPtr(), reference.dataPtr(), dataBytes) != 0 ||
+            std::memcmp(streamed.dataPtr(), reference.dataPtr(), dataBytes) != 0 ||
+            std::memcmp(consumedFloats.data(), reference.dataPtr(), dataBytes) != 0 || landed != dataBytes) {
+            std::cerr << wireEncodingName(encoding) << " tensor did not round-trip (max error " << worst << ")\n";
+            return 1;
+        }
+    }
+
+    // Other dtypes stream as raw dtype bytes; the sink learns the dtype
+    // from onHeader
+    {
+        Tensor half({3000});
+        for (size_t i = 0; i < half.size(); ++i) half[i] = static_cast<float>(i % 200) * 0.25f;
+        half = half.cast(DType::FLOAT16);
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return 1;
+        std::thread halfSender([&] { sendTensorStream(fds[0], half, 1000, WireEncoding::QINT8); });
+        DType halfDtype = DType::FLOAT32;
+        std::vector<char> halfBytes(half.nbytes());
+        StreamSink raw;
+        raw.onHeader = [&](const std::vector<size_t>&, DType dtype) { halfDtype = dtype; };
+        raw.onChunk = [&](uint64_t offset, const char* data, size_t len) {
+            std::memcpy(halfBytes.data() + offset, data, len);
+        };
+        recvTensorStream(fds[1], raw);
+        halfSender.join();
+        close(fds[0]);
+        close(fds[1]);
+        if (halfDtype != DType::FLOAT16 || std::memcmp(halfBytes.data(), half.rawData(), half.nbytes()) != 0) {
+            std::cerr << "float16 stream did not round-trip\n";
+            return 1;
+        }
+    }
+
+    // Unknown dtypes are rejected
+    std::vector<char> unknown = small.serializeBinary();
+    unknown[5] = 9;
+    rejected = false;
+    try {
+        Tensor::deserializeBinary(unknown);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    if (!rejected) {
+        std::cerr << "unknown dtype was accepted\n";
+        return 1;
+    }
+
+    std::cout << "Tensor wire tests passed\n";
+    return 0;
+}
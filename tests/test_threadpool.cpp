@@ -4,6 +4,8 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
+#include <future>
 #include "ThreadPool.h"
 
 int main() {
@@ -26,5 +28,38 @@ int main() {
     cv.wait(lock, [&] { return completed.load() >= total; });
 
     std::cout << "All tasks completed\n";
+
+    // submit() returns results through futures
+    std::future<int> answer = pool.submit([] { return 6 * 7; });
+    if (answer.get() != 42) {
+        std::cerr << "submit returned wrong value\n";
+        return 1;
+    }
+
+    // Work-stealing mode: tasks spawned from inside workers land on the
+    // local deque and must still all run (stolen by idle workers)
+    ThreadPool stealing(4, PoolMode::WORK_STEALING);
+    const int outer = 16, inner = 64;
+    std::atomic<int> ran{0};
+    std::vector<std::future<void>> spawned;
+    for (int i = 0; i < outer; ++i) {
+        spawned.push_back(stealing.submit([&stealing, &ran] {
+            for (int j = 0; j < inner; ++j) {
+                stealing.enqueue([&ran] { ++ran; });
+            }
+        }));
+    }
+    for (auto& f : spawned) f.get();
+    while (ran.load() < outer * inner) std::this_thread::yield();
+
+    std::future<void> failing = stealing.submit([] { throw std::runtime_error("boom"); });
+    try {
+        failing.get();
+        std::cerr << "exception was not propagated\n";
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+
+    std::cout << "Work-stealing tasks completed: " << ran.load() << "\n";
     return 0;
 }
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "Tensor.h"
+#include "TestUtil.h"
+
+namespace {
+
+template <typename Fn>
+bool throws(Fn fn) {
+    try {
+        fn();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+// t[i] = i, so every element names its own position
+Tensor iota(const std::vector<size_t>& shape) {
+    Tensor t(shape);
+    for (size_t i = 0; i < t.size(); ++i) t[i] = static_cast<float>(i);
+    return t;
+}
+
+bool sameValues(const Tensor& view, const std::vector<float>& want) {
+    if (view.size() != want.size()) return false;
+    for (size_t i = 0; i < want.size(); ++i) {
+        if (view[i] != want[i]) return false;
+    }
+    return true;
+}
+
+bool equal(const Tensor& a, const Tensor& b) {
+    if (a.getShape() != b.getShape()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    const Tensor t = iota({2, 3, 4});
+    const void* data = t.rawData();
+
+    // Views share storage and index in row-major order of their own shape
+    const Tensor r = t.reshape({6, 4});
+    expect(r.isContiguous() && r.rawData() == data, "reshape of a contiguous tensor is a view");
+    expect(r.getStrides() == std::vector<size_t>({4, 1}), "reshape strides");
+    expect(throws([&] { t.reshape({5, 5}); }), "reshape checks the element count");
+
+    const Tensor rows = t.slice(1, 1, 3);
+    expect(!rows.isContiguous() && rows.getShape() == std::vector<size_t>({2, 2, 4}), "slice on a middle axis");
+    expect(sameValues(rows, {4, 5, 6, 7, 8, 9, 10, 11, 16, 17, 18, 19, 20, 21, 22, 23}), "slice values");
+    const Tensor first = t.slice(0, 0, 1);
+    expect(first.isContiguous() && first.rawData() == data, "leading slice stays contiguous");
+    const Tensor second = t.slice(0, 1, 2);
+    expect(second.isContiguous() && second[0] == 12.0f, "offset slice starts at its first element");
+    const Tensor stepped = t.slice(2, 1, 4, 2);
+    expect(stepped.getShape() == std::vector<size_t>({2, 3, 2}) && stepped[0] == 1.0f && stepped[1] == 3.0f &&
+           stepped[2] == 5.0f, "stepped slice");
+    expect(t.slice(2, 2, 2).size() == 0, "empty slice");
+    expect(throws([&] { t.slice(3, 0, 1); }) && throws([&] { t.slice(0, 1, 3); }), "slice checks its range");
+
+    const Tensor tr = t.transpose(0, 2);
+    expect(tr.getShape() == std::vector<size_t>({4, 3, 2}) && !tr.isContiguous(), "transpose shape");
+    expect(tr[1] == 12.0f && tr[2] == 4.0f && tr[6] == 1.0f, "transpose values");
+    const Tensor p = t.permute({1, 2, 0});
+    expect(p.getShape() == std::vector<size_t>({3, 4, 2}) && p[1] == 12.0f && p[2] == 1.0f, "permute values");
+    expect(p.permute({2, 0, 1}).isContiguous(), "inverse permutation is contiguous again");
+    expect(throws([&] { t.permute({0, 0, 1}); }), "permute rejects a repeated axis");
+
+    Tensor bias = iota({4});
+    const Tensor b = bias.broadcastTo({3, 4});
+    expect(b.getStrides() == std::vector<size_t>({0, 1}), "broadcast axis has stride 0");
+    expect(sameValues(b, {0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3}), "broadcast values");
+    const Tensor col = iota({3, 1}).broadcastTo({2, 3, 4});
+    expect(col[4] == 1.0f && col[13] == 0.0f && col[23] == 2.0f, "size-1 axes broadcast");
+    expect(throws([&] { bias.broadcastTo({3, 5}); }), "incompatible broadcast throws");
+
+    // Packing: contiguous() copies, reshape of a view copies, the const
+    // pointers refuse non-contiguous views
+    const Tensor packedT = tr.contiguous();
+    expect(packedT.isContiguous() && packedT.rawData() != data, "contiguous packs a view");
+    expect(equal(packedT, tr), "packed values follow the view");
+    expect(tr.reshape({24}).isContiguous(), "reshape of a view copies");
+    expect(throws([&] { tr.dataPtr(); }), "const pointer to a view throws");
+
+    // Writing (or non-const access) through a view packs it privately; the
+    // source is untouched
+    Tensor w = t.transpose(0, 1);
+    w[0] = 100.0f;
+    expect(w.isContiguous() && w[0] == 100.0f && t[0] == 0.0f, "write packs the view privately");
+
+    // Kernels take views: gathered blocks match the packed result, with
+    // enough elements to cross several blocks
+    Tensor big = iota({64, 96});
+    const Tensor bigT = big.transpose(0, 1);
+    expect(bigT.sum() == big.sum(), "sum over a transposed view");
+    Tensor doubled = bigT.add(bigT);
+    expect(doubled.isContiguous() && doubled.getShape() == std::vector<size_t>({96, 64}), "result is contiguous");
+    expect(equal(doubled, bigT.contiguous().scale(2.0f)), "add over views");
+    const float dot = bigT.contiguous().dot(bigT.contiguous());
+    expect(std::fabs(bigT.dot(bigT) - dot) <= 1e-5f * dot, "dot over views");
+    expect(bigT.max() == 6143.0f && bigT.slice(1, 0, 32).relu().size() == 96 * 32, "unary kernels over views");
+
+    // Binary ops broadcast operands of another shape
+    Tensor x = iota({3, 4});
+    Tensor y = x.add(bias);
+    expect(sameValues(y, {0, 2, 4, 6, 4, 6, 8, 10, 8, 10, 12, 14}), "add broadcasts");
+    Tensor z = x.fma(iota({3, 1}), bias);
+    expect(z[5] == 5.0f * 1.0f + 1.0f && z[11] == 11.0f * 2.0f + 3.0f, "fma broadcasts");
+    expect(throws([&] { x.mul(iota({5})); }), "unbroadcastable operand throws");
+
+    // Other dtypes go through the same gather
+    const Tensor halves = t.cast(DType::FLOAT16).transpose(0, 2);
+    Tensor back = halves.cast(DType::FLOAT32);
+    expect(back.isContiguous() && back[1] == 12.0f && back[6] == 1.0f, "cast of a view");
+    expect(halves.sum() == t.sum(), "sum of a non-float view");
+
+    // matmul reads unit-stride views in place and packs the rest
+    Tensor a = iota({6, 8});
+    Tensor m = iota({8, 5});
+    expect(equal(a.slice(0, 1, 5).matmul(m), a.slice(0, 1, 5).contiguous().matmul(m)), "matmul of a row slice");
+    expect(equal(a.slice(1, 2, 6).matmul(m.slice(0, 2, 6)),
+                 a.slice(1, 2, 6).contiguous().matmul(m.slice(0, 2, 6).contiguous())),
+           "matmul of column slices");
+    Tensor mt = m.transpose(0, 1).contiguous().transpose(0, 1);
+    expect(equal(a.matmul(mt), a.matmul(m)), "matmul of a transposed view");
+    expect(equal(iota({3, 6, 8}).matmul(m.broadcastTo({3, 8, 5})), iota({3, 6, 8}).matmul(m)),
+           "matmul with a broadcast batch");
+
+    // Serialization packs first
+    Tensor round = Tensor::deserializeBinary(tr.serializeBinary());
+    expect(round.getShape() == tr.getShape() && round[1] == 12.0f && round[6] == 1.0f, "binary round trip of a view");
+    expect(Tensor::deserialize(tr.serialize())[1] == 12.0f, "text round trip of a view");
+
+    if (failures) return 1;
+    std::cout << "View tests passed\n";
+    return 0;
+}